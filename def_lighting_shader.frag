@@ -1,44 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-
-in vec2 TexCoords;
-
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
-uniform sampler2D gAlbedo;
-uniform sampler2D ssao;
-
-struct Light {
-    vec3 Position;
-    vec3 Color;
-};
-
-uniform Light light;
-
-void main()
-{             
-    // obtener parametros del gBuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
-    vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
-    float AmbientOcclusion = texture(ssao, TexCoords).r;
-    
-    // calcular iluminacion como siempre
-    // ambient (hardcodeada)
-    vec3 ambient = vec3(0.3 * Diffuse);
-
-    // diffuse
-    vec3 lightDir = normalize(light.Position - FragPos);
-    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * light.Color;
-    
-    // specular
-    vec3 viewDir  = normalize(-FragPos);
-    vec3 halfwayDir = normalize(lightDir + viewDir);  // blinn
-    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 60.0);
-    vec3 specular = light.Color * spec;
-
-    
-    vec3 lighting  = ambient + diffuse + specular;
-
-    FragColor = vec4(lighting, 1.0);
-}
\ No newline at end of file
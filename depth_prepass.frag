@@ -0,0 +1,6 @@
+#version 330 core
+
+// solo profundidad: sin salidas de color
+void main()
+{
+}
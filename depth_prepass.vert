@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// por instancia (ver InstanceData en utils/mesh.h)
+layout (location = 7) in mat4 aModel;
+
+// misma cuenta que gbuffer.vert: la profundidad tiene que coincidir bit a bit para el GL_EQUAL
+invariant gl_Position;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec4 viewPos = view * aModel * vec4(aPos, 1.0);
+    // las instancias que descarta el occlusion culling llegan con la matriz nula: quedan fuera del clip volume
+    gl_Position = aModel[3][3] == 0.0 ? vec4(2.0, 2.0, 2.0, 1.0) : projection * viewPos;
+}
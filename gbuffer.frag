@@ -1,18 +1,23 @@
 #version 330 core
 layout (location = 0) out vec3 gPosition;
 layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec3 gAlbedo;
+layout (location = 2) out vec4 gAlbedo;    // rgb: color, a: AO horneada
 
 in vec2 TexCoords;
 in vec3 FragPos;
 in vec3 Normal;
+in float BakedAO;
+
+#include "normal_encoding.glsl"
 
 void main()
 {    
     // store the fragment position vector in the first gbuffer texture
     gPosition = FragPos;
     // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
+    gNormal = encodeNormal(normalize(Normal));
     // and the diffuse per-fragment color
     gAlbedo.rgb = vec3(0.95);
+    // and the baked ambient occlusion
+    gAlbedo.a = BakedAO;
 }
\ No newline at end of file
@@ -2,25 +2,60 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// AO horneada por vertice (1.0 si el modelo no tiene bake, ver utils/ao_baker.h)
+layout (location = 14) in float aBakedAO;
+// por instancia (ver InstanceData en utils/mesh.h)
+layout (location = 7) in mat4 aModel;
+layout (location = 11) in mat3 aNormalMatrix;
+
+#ifdef MULTIVIEW
+// vistas en lote (utils/multi_view.h): cada instancia de la escena se dibuja viewCount veces seguidas, la
+// vista sale de gl_InstanceID y multiview_gbuffer.geom reenvia las salidas a su capa con los nombres de siempre
+#ifndef MAX_VIEWS
+#define MAX_VIEWS 32
+#endif
+layout (std140) uniform Views
+{
+    mat4 viewMatrices[MAX_VIEWS];
+    mat4 projectionMatrices[MAX_VIEWS];
+};
+uniform int viewCount = 1;
+#define view viewMatrices[gl_InstanceID % viewCount]
+#define projection projectionMatrices[gl_InstanceID % viewCount]
+#define FragPos vFragPos
+#define TexCoords vTexCoords
+#define Normal vNormal
+#define BakedAO vBakedAO
+flat out int vView;
+#else
+uniform mat4 view;
+uniform mat4 projection;
+#endif
 
 out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normal;
+out float BakedAO;
 
-uniform bool invertedNormals;
+// el depth pre-pass hace la misma cuenta: la profundidad tiene que coincidir bit a bit para el GL_EQUAL
+invariant gl_Position;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool invertedNormals;
 
 void main()
 {
-    vec4 viewPos = view * model * vec4(aPos, 1.0);
+    vec4 viewPos = view * aModel * vec4(aPos, 1.0);
     FragPos = viewPos.xyz; 
     TexCoords = aTexCoords;
+    BakedAO = aBakedAO;
+#ifdef MULTIVIEW
+    vView = gl_InstanceID % viewCount;
+#endif
     
-    mat3 normalMatrix = transpose(inverse(mat3(view * model)));
+    // la view es rigida, asi que su matriz normal es mat3(view); la del modelo viene precalculada
+    mat3 normalMatrix = mat3(view) * aNormalMatrix;
     Normal = normalMatrix * (invertedNormals ? -aNormal : aNormal);
     
-    gl_Position = projection * viewPos;
-}
\ No newline at end of file
+    // las instancias que descarta el occlusion culling llegan con la matriz nula: quedan fuera del clip volume
+    gl_Position = aModel[3][3] == 0.0 ? vec4(2.0, 2.0, 2.0, 1.0) : projection * viewPos;
+}
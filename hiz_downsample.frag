@@ -0,0 +1,32 @@
+#version 330 core
+// un nivel del Hi-Z: cada texel guarda la profundidad mas lejana del bloque de 2x2 que cubre en el nivel
+// anterior (el nivel 0 sale directo del gDepth). Con un lado impar el ultimo texel tambien toma la fila o
+// columna que sobra, asi ningun pixel queda afuera y la prueba sigue siendo conservadora
+out float Depth;
+
+uniform sampler2D source;
+uniform int sourceLevel;
+
+ivec2 size;
+
+float fetch(ivec2 p)
+{
+    return texelFetch(source, min(p, size - 1), sourceLevel).r;
+}
+
+void main()
+{
+    size = textureSize(source, sourceLevel);
+    ivec2 p = ivec2(gl_FragCoord.xy) * 2;
+    float depth = max(max(fetch(p), fetch(p + ivec2(1, 0))), max(fetch(p + ivec2(0, 1)), fetch(p + ivec2(1, 1))));
+
+    bool extraX = (size.x & 1) != 0 && p.x == size.x - 3;
+    bool extraY = (size.y & 1) != 0 && p.y == size.y - 3;
+    if (extraX)
+        depth = max(depth, max(fetch(p + ivec2(2, 0)), fetch(p + ivec2(2, 1))));
+    if (extraY)
+        depth = max(depth, max(fetch(p + ivec2(0, 2)), fetch(p + ivec2(1, 2))));
+    if (extraX && extraY)
+        depth = max(depth, fetch(p + ivec2(2, 2)));
+    Depth = depth;
+}
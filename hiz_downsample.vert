@@ -0,0 +1,8 @@
+#version 330 core
+// triangulo que cubre todo el viewport, sin buffers (ver utils/occlusion_culling.h)
+
+void main()
+{
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,118 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// Lighting pass y vistas de debug en un solo fuente. Permutaciones:
+//  DEBUG_VIEW  0 = iluminacion, 1 = gPosition, 2 = gNormal, 3 = gAlbedo, 4 = oclusion
+//  USE_SSAO    el ambiente se multiplica por la oclusion
+//  BAKED_AO    la oclusion sale del bake por vertice (gAlbedo.a) en vez del pase de SSAO
+//  NORMAL_OCT  normales octaedricas en el g-buffer (normal_encoding.glsl)
+//  MULTIVIEW   todas las vistas de un lote en un draw (multiview.glsl); solo la luz principal, porque los
+//              clusters se arman para una vista
+#ifndef DEBUG_VIEW
+#define DEBUG_VIEW 0
+#endif
+
+#include "multiview.glsl"
+
+uniform GBUFFER_SAMPLER gPosition;
+uniform GBUFFER_SAMPLER gNormal;
+uniform GBUFFER_SAMPLER gAlbedo;  // rgb: color, a: AO horneada
+uniform GBUFFER_SAMPLER ssao;     // oclusion (del pase de SSAO o del blur)
+
+#include "normal_encoding.glsl"
+
+// luces (clustered shading, ver utils/lights.h)
+uniform samplerBuffer lightData;        // 2 texels por luz: (posicion view-space, radio), (color, 0)
+uniform usampler3D clusterGrid;         // (offset, cantidad) en lightIndices por cluster
+uniform usamplerBuffer lightIndices;
+uniform int clusterTileSize = 32;
+uniform int clusterSlices = 16;
+uniform float clusterNear = 0.1;
+uniform float clusterLogFactor = 1.0;
+
+// MULTIVIEW: la luz principal en world-space (cada vista la pasa a su view-space)
+uniform vec4 mainLight = vec4(-1.0, 1.0, 4.0, 1000.0);     // posicion, radio
+uniform vec3 mainLightColor = vec3(1.0);
+
+// difusa + especular de una luz (posicion view-space y radio)
+vec3 shadeLight(vec3 FragPos, vec3 Normal, vec3 Diffuse, vec4 posRadius, vec3 color)
+{
+    vec3 toLight = posRadius.xyz - FragPos;
+    float dist = max(length(toLight), 1e-4);
+    // atenuacion con ventana: 1 cerca de la luz, 0 exacto en el radio
+    float falloff = clamp(1.0 - pow(dist / posRadius.w, 4.0), 0.0, 1.0);
+    float attenuation = falloff * falloff;
+
+    // diffuse
+    vec3 lightDir = toLight / dist;
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * color;
+
+    // specular
+    vec3 viewDir = normalize(-FragPos);
+    vec3 halfwayDir = normalize(lightDir + viewDir);  // blinn
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 60.0);
+    vec3 specular = color * spec;
+
+    return (diffuse + specular) * attenuation;
+}
+
+// difusa + especular de las luces del cluster del fragmento
+vec3 shadeLights(vec3 FragPos, vec3 Normal, vec3 Diffuse)
+{
+#ifdef MULTIVIEW
+    vec3 lightPos = (viewMatrices[Layer] * vec4(mainLight.xyz, 1.0)).xyz;
+    return shadeLight(FragPos, Normal, Diffuse, vec4(lightPos, mainLight.w), mainLightColor);
+#else
+    ivec2 tile = ivec2(gl_FragCoord.xy) / clusterTileSize;
+    int slice = clamp(int(floor(log(max(-FragPos.z, clusterNear) / clusterNear) * clusterLogFactor)), 0, clusterSlices - 1);
+    uvec2 cluster = texelFetch(clusterGrid, ivec3(tile, slice), 0).rg;
+
+    vec3 lighting = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; ++i)
+    {
+        int index = int(texelFetch(lightIndices, int(cluster.x + i)).r);
+        lighting += shadeLight(FragPos, Normal, Diffuse, texelFetch(lightData, index * 2), texelFetch(lightData, index * 2 + 1).rgb);
+    }
+    return lighting;
+#endif
+}
+
+float ambientOcclusion()
+{
+#ifdef BAKED_AO
+    return gbufferTexture(gAlbedo, TexCoords).a;
+#else
+    return gbufferTexture(ssao, TexCoords).r;
+#endif
+}
+
+void main()
+{             
+#if DEBUG_VIEW == 1
+    FragColor = vec4(gbufferTexture(gPosition, TexCoords).rgb, 1.0);
+#elif DEBUG_VIEW == 2
+    FragColor = vec4(decodeNormal(gbufferTexture(gNormal, TexCoords).rgb), 1.0);
+#elif DEBUG_VIEW == 3
+    FragColor = vec4(gbufferTexture(gAlbedo, TexCoords).rgb, 1.0);
+#elif DEBUG_VIEW == 4
+    FragColor = vec4(vec3(ambientOcclusion()), 1.0);
+#else
+    // obtener parametros del gBuffer
+    vec3 FragPos = gbufferTexture(gPosition, TexCoords).rgb;
+    vec3 Normal = decodeNormal(gbufferTexture(gNormal, TexCoords).rgb);
+    vec3 Diffuse = gbufferTexture(gAlbedo, TexCoords).rgb;
+    
+    // ambient (hardcodeada)
+    vec3 ambient = vec3(0.3 * Diffuse);
+#if defined(USE_SSAO) || defined(BAKED_AO)
+    ambient *= ambientOcclusion();  // <-- aplicamos AO
+#endif
+
+    // diffuse + specular de cada luz que toca el cluster
+    vec3 lighting  = ambient + shadeLights(FragPos, Normal, Diffuse);
+
+    FragColor = vec4(lighting, 1.0);
+#endif
+}
@@ -16,32 +16,97 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "utils/shader.h"
+#include "utils/shader_permutations.h"
 #include "utils/camera.h"
 #include "utils/model.h"
 #include "utils/filesystem.h"
+#include "utils/frame_graph.h"
+#include "utils/frame_cache.h"
+#include "utils/gpu_timer.h"
+#include "utils/dynamic_resolution.h"
+#include "utils/scene.h"
+#include "utils/occlusion_culling.h"
+#include "utils/lights.h"
+#include "utils/depth_prepass.h"
+#include "utils/ao_baker.h"
+#include "utils/frame_capture.h"
+#include "utils/sample_sets.h"
+#include "utils/session_recorder.h"
+#include "utils/triple_buffer.h"
+#include "utils/ui_frame.h"
+#include "utils/multi_view.h"
+#include "utils/render_service.h"
+#include "utils/render_shards.h"
+#include "utils/cpu_rasterizer.h"
+#include "utils/gbuffer_snapshot.h"
+#define ALLOC_STATS_IMPLEMENTATION
+#include "utils/alloc_stats.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "imgui.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <random>
+#include <thread>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-void renderQuad();
+void renderQuad(int instances = 1);
 
 // ventana settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+int scrWidth = SCR_WIDTH, scrHeight = SCR_HEIGHT;    // dimensiones actuales del framebuffer de la ventana
+
+// resolucion dinamica (el controlador y el timer son del hilo de render; la interfaz toca estos dos)
+DynamicResolution dynamicResolution;
+GpuTimer frameTimer;
+bool dynamicResolutionEnabled = false; float dynamicResolutionTarget = 16.6f;
+
+// depth pre-pass (off / on / auto por modelo segun lo medido)
+DepthPrepassAdvisor depthPrepass;
+GpuTimer geometryTimer;
+int depthPrepassMode = DepthPrepassAdvisor::OFF;
+unsigned long long frameCount = 0;
 
 // SSAO
 bool SSAO = false, zPressed = false, ssaoSmooth = true, kPressed = false;
 int samplesNum = 16; float ssaoRadius = 0.5; float ssaoBias = 0.01; float ssaoIntensity = 1.0;
-std::vector<glm::vec3> GenerateSamples(int n = 64);
-std::vector<glm::vec3> GenerateRotationNoise();
+bool ssaoAdaptive = false; int ssaoMinSamples = 8;     // SSAO adaptativo: muestras por tile segun su complejidad
+bool bakedAO = false;       // AO horneada por vertice (modelos estaticos): no corre el pase de SSAO
+const int SSAO_TILE = 8;    // lado en pixeles de los tiles del SSAO adaptativo (igual que en ssao.frag)
+const float GBUFFER_BACKGROUND[] = { 0.0f, 0.0f, 1.0f, 0.0f };     // gPosition sin geometria: z > 0, detras de la camara (igual que en ssao_tiles.frag)
+const float UNOCCLUDED[] = { 1.0f, 1.0f, 1.0f, 1.0f };     // clear de la oclusion: el fondo sin oclusion (el blur lo promedia con los bordes)
+bool ssaoBlur = false;      // box filter de 4x4 sobre la oclusion en el lighting pass
+bool normalOct = false;     // normales octaedricas en el g-buffer (RG16F en vez de RGBA16F)
+bool stencilCoverage = true;    // el geometry pass marca en el stencil los pixeles con geometria; SSAO, blur y lighting corren solo ahi
+bool incrementalRendering = true;   // g-buffer, oclusion e iluminacion se guardan y solo se rehacen si cambio lo que los afecta
+int kernelDistribution = SampleSets::HALTON;   // RANDOM (el kernel original), HALTON o POISSON
+bool blueNoise = true; int noiseSize = 64;      // ruido de rotacion: blue noise de noiseSize x noiseSize o blanco de 4x4
+std::vector<glm::vec3> GenerateSamples(int n, int distribution);
+std::vector<glm::vec3> GenerateRotationNoise(bool blue, int size);
+int BlurSize(int noiseSide);
+
+// captura asincronica (PBOs + hilo codificador) del frame final, la oclusion o un target del g-buffer
+int captureSource = 0;      // 0 frame, 1 oclusion, 2 gPosition, 3 gNormal, 4 gAlbedo
+int captureEncoding = 0;    // FrameCapture::Encoding
+bool captureRecord = false, captureOnce = false;
+int captureIndex = 0;       // captureOnce y captureIndex los usa solo el hilo de render
+bool snapshotOnce = false, gPressed = false;   // instantanea del g-buffer para --ssao-bench (tecla G)
+int snapshotIndex = 0;      // snapshotOnce y snapshotIndex tambien son del hilo de render
+
+// grabacion / replay de sesiones (camara, giro del modelo y parametros, con paso fijo al reproducir)
+SessionRecorder session;
+std::string sessionPath = "session.ses";
+bool replayExit = false;    // --replay: cerrar al terminar el trace
 
 // DEBUG shader flags
 bool DEBUG_Pos = false, unoPressed = false, DEBUG_Normal = false, dosPressed = false, DEBUG_SSAO = false, tresPressed = false, DEBUG_Color = false, cuatroPressed = false;
@@ -54,8 +119,23 @@ bool firstMouse = true;
 
 // models setting
 int currentModel = 0; bool oPressed = false;
+bool keepMeshData = false;      // copias en RAM de vertices/indices: se liberan al subirlas salvo --keep-mesh-data
 std::vector<std::string> models = { "suzanne", "backpack", "deforme", "superficie", "superficie2" };
+std::vector<float> modelScales = { 0.5f, 0.5f, 0.07f, 0.1f, 0.1f };     // escala base de cada modelo en la escena
+ModelImporter defaultImporter = ModelImporter::Auto;        // --importer auto|assimp|obj
+std::map<std::string, ModelImporter> modelImporters;        // --importer <modelo>=auto|assimp|obj
+ModelImporter importerFor(const std::string& model);
+bool parseImporter(const std::string& arg);
+std::vector<std::string> meshCacheModels;                   // --mesh-cache <modelo>: la cache solo para esos
+bool meshCacheFor(const std::string& model);                // --mesh-cache sin modelo: para todos (Model::UseMeshCache)
 bool rotateModel = true; float modelAngle = 0.f; bool rPressed = false;
+int sceneGrid = 1;      // la escena es una grilla de sceneGrid x sceneGrid instancias del modelo actual
+void BuildScene(Scene& scene, int model, int grid);
+void OrbitCamera(const glm::vec3& center, float radius, float fov, float aspect, float yaw, float pitch, glm::mat4& view, glm::mat4& projection);
+
+// luces: la luz principal + extraLights luces puntuales de colores repartidas sobre la escena
+int extraLights = 0;
+void BuildLights(std::vector<PointLight>& lights, int extra, float extent);
 
 // imgui
 bool Combo(const char* label, int* current_item, const std::vector<std::string>& items);
@@ -64,8 +144,214 @@ bool Combo(const char* label, int* current_item, const std::vector<std::string>&
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+// ---------- hilos de update y render ----------
+// El hilo principal (update) atiende los eventos de GLFW y la entrada, mueve la camara, graba o reproduce la
+// sesion, hace el culling de la escena y arma la interfaz; todo lo que el render necesita de ese frame queda
+// en un FramePacket. El hilo de render es el dueno del contexto de GL: toma el ultimo paquete y hace los pases.
+// Los paquetes pasan por un triple buffer sin locks, asi el update del frame N+1 se solapa con el render del N
+// y el frame tarda max(update, render) en vez de la suma. El update no se adelanta mas de un paquete.
+struct FramePacket
+{
+    unsigned long long Frame = 0;
+    int Width = 0, Height = 0;              // framebuffer de la ventana
+    glm::mat4 View = glm::mat4(1.0f), Projection = glm::mat4(1.0f);
+    // copias de los parametros que toca la interfaz
+    int Model = 0, Grid = 1, ExtraLights = 0, DepthPrepass = 0;
+    float ModelAngle = 0.0f;
+    bool SSAO = false, BakedAO = false, Smooth = true, Blur = false, NormalOct = false, Adaptive = false, BlueNoise = true;
+    int Samples = 16, MinSamples = 8, Kernel = 0, NoiseSize = 64, DebugView = 0;
+    float Radius = 0.5f, Bias = 0.01f, Intensity = 1.0f;
+    bool OcclusionCulling = false, Coverage = true, Incremental = true;
+    bool DynamicResolution = false; float TargetMs = 16.6f;
+    float ReplayScale = 0.0f, ReplaySampleScale = 0.0f;     // > 0: escalas del trace que se reproduce
+    int CaptureSource = 0, CaptureEncoding = 0; bool CaptureRecord = false;
+    bool MemoryReport = false;              // la interfaz muestra la memoria: el render la junta
+    Scene::DrawList Draws;
+    UiFrame Ui;
+};
+
+// lo que el render devuelve para la interfaz y la sesion (por otro triple buffer, en sentido contrario)
+struct RenderStats
+{
+    float GpuMs = 0.0f, CpuMs = 0.0f;       // GPU del frame (de hace 1-3 frames) y CPU del hilo de render
+    float RenderScale = 1.0f, SampleScale = 1.0f;
+    int RenderWidth = 0, RenderHeight = 0, Samples = 0;
+    int Passes = 0, CulledPasses = 0, VirtualTextures = 0, PhysicalTextures = 0;
+    size_t PhysicalBytes = 0, PoolBytes = 0;
+    size_t LightIndices = 0; unsigned int MaxLightsPerCluster = 0;
+    bool PrepassMeasured = false, PrepassFaster = false; float PrepassMs[2] = { 0.0f, 0.0f };
+    unsigned int OcclusionVisible = 0, OcclusionTested = 0;
+    unsigned long long CapturesWritten = 0, CapturesDropped = 0; size_t CapturesPending = 0;
+    unsigned long long GlIssued = 0, GlFiltered = 0;
+    size_t ShaderPermutations = 0;
+    bool StageRan[FrameCache::STAGES] = { true, true, true };  // etapas que se rehicieron (render incremental)
+    std::vector<char> BakedModels;          // que modelos tienen AO horneada
+    MemoryReport Memory;                    // solo si el paquete lo pidio
+};
+
+TripleBuffer<FramePacket> framePackets;
+TripleBuffer<RenderStats> renderStats;
+float updateMs = 0.0f;      // CPU del hilo de update en el ultimo frame
+
+// traspaso: el render espera un paquete nuevo y el update espera a que el render tome el anterior
+std::mutex handoffMutex;
+std::condition_variable handoff;
+std::atomic<unsigned long long> acquiredFrame{ 0 };    // paquetes que el render ya tomo (Frame + 1 del ultimo)
+std::atomic<bool> renderQuit{ false };
+void NotifyHandoff();
+
+// lo que la interfaz pide y necesita GL (bakes, liberar o restaurar copias, capturas) se encola para el render
+std::mutex renderCommandsMutex;
+std::vector<std::function<void()>> renderCommands;
+void RunOnRender(const std::function<void()>& command);
+
+// ---------- programas de los pases ----------
+// un fuente por pase; cada combinacion de features (#defines) se compila la primera vez que se pide y el programa
+// linkeado queda en la cache de disco (shader_cache/). Los usan el hilo de render y --ssao-bench
+struct PassPrograms
 {
+    std::vector<glm::vec3> Samples;     // kernel que cargan los programas de SSAO
+    int Kernel = -1;                    // distribucion de Samples (SampleSets); -1 si vino de una instantanea
+    ShaderPermutations GeometryPasses, SSAOPasses, SSAOTilePasses, LightingPasses;
+    Shader SSAOBlur;
+
+    PassPrograms(int kernel);
+    void SetKernel(const std::vector<glm::vec3>& samples, int kernel);     // y lo carga en los programas ya compilados
+    void Precompile(bool octahedral);                                      // los modos que se alternan desde la interfaz
+    size_t Count() const;
+};
+ShaderDefines GBufferDefines(bool octahedral);
+ShaderDefines SSAODefines(bool octahedral, int kernelSize, bool smooth, bool adaptive);
+ShaderDefines TileDefines(bool octahedral, int kernelSize);
+ShaderDefines LightingDefines(bool octahedral, int debugView, bool ssao, bool baked);
+
+// ---------- estado del hilo de render ----------
+// Lo que usa solo el render (ademas de los globales marcados como suyos arriba); main lo prepara antes de lanzar el
+// hilo. La escena es compartida: el update arma, cullea y empaqueta las instancias, y el render sube la DrawList
+// del paquete y dibuja
+struct RenderResources
+{
+    PassPrograms& Programs;
+    Shader DepthPrepass;
+    Scene& World;
+    OcclusionCulling Occlusion;     // occlusion culling en dos fases contra el Hi-Z del gDepth (opcional)
+    AOBaker Baker;                  // los bakes de la interfaz (y los de --bake-ao, antes de lanzar el hilo)
+    FrameGraph Graph;               // g-buffer, SSAO y demas targets: los pide cada pase, que los toma de un pool
+    FrameCache Cache;               // firmas del render incremental
+    FrameCapture Capture;
+    unsigned int NoiseTexture = 0;
+    int BuiltNoise = 0;             // lado de la textura de ruido actual (se sube en el primer frame, y de nuevo si cambia)
+    std::vector<PointLight> Lights;
+    LightClusters Clusters;
+    int BuiltLights = -1; float BuiltLightsExtent = 0.f;
+    int PrepassGrid = 1;            // grilla de las mediciones del depth pre-pass
+
+    RenderResources(PassPrograms& programs, Scene& world, int grid);
+};
+
+// lo que decide SetupFrame antes de armar los pases y leen todos: tamanios, permutaciones y recursos del frame graph
+struct FrameSetup
+{
+    int Width = 0, Height = 0;              // la ventana de este paquete (el callback cambia los globales)
+    glm::ivec2 RenderSize = glm::ivec2(0);  // resolucion interna
+    glm::vec2 UVScale = glm::vec2(1.0f);
+    int Samples = 0, KernelSize = 8, DebugView = 0;
+    bool UseSSAO = false, Coverage = true, Incremental = true, Upscale = false;
+    float LightsExtent = 0.0f;
+    Shader* GeometryPass = nullptr; Shader* SSAOPass = nullptr; Shader* SSAOTiles = nullptr; Shader* LightingPass = nullptr;
+    FrameGraph::Resource GPosition = -1, GNormal = -1, GAlbedo = -1, GDepth = -1, TileBudget = -1, SSAORaw = -1, SSAOBlurred = -1,
+        SceneColor = -1, Noise = -1, Backbuffer = -1, Occlusion = -1;
+};
+
+void BakeModel(AOBaker& baker, Model& model);
+MemoryReport QueryMemory(RenderResources& r);
+void RenderLoop(GLFWwindow* window, RenderResources& r);
+void RenderFrame(RenderResources& r, FramePacket& frame);
+FrameSetup SetupFrame(RenderResources& r, const FramePacket& frame);
+void UploadScene(RenderResources& r, const FramePacket& frame);
+// un pase del frame graph cada uno: las lambdas del pase capturan solo lo que reciben
+void AddGeometryPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f);
+void AddSSAOTilesPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f);
+void AddSSAOPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f);
+void AddBlurPass(RenderResources& r, const FrameSetup& f);
+void AddLightingPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f);
+void AddUpscalePass(RenderResources& r, const FrameSetup& f);
+void AddCapturePass(RenderResources& r, const FramePacket& frame, const FrameSetup& f);
+void AddSnapshotPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f);
+void TestCoverage(bool coverage);
+void PublishStats(RenderResources& r, const FramePacket& frame, const FrameSetup& f, double renderStart);
+
+// ---------- modos por lotes ----------
+// main los despacha segun los argumentos y sale con lo que devuelven
+int RunImportBench(int repetitions);
+int RunCpuGBuffer(int index, int size);
+int RunShardCoordinator(RenderShards& shards, int argc, char** argv);
+int RunSSAOBench(PassPrograms& programs, const std::string& path, int iterations);
+int RunBatch(Scene& scene, const std::vector<glm::vec3>& samples, int turntableViews, int turntableSize, const std::string& servicePath);
+
+int main(int argc, char** argv)
+{
+    // --import-bench [N]: compara Assimp con el cargador de OBJ propio sobre los modelos y sale (no abre ventana)
+    for (int i = 1; i < argc; ++i)
+        if (std::string(argv[i]) == "--import-bench")
+            return RunImportBench(i + 1 < argc && std::atoi(argv[i + 1]) > 0 ? std::atoi(argv[i + 1]) : 10);
+
+    // argumentos que se necesitan antes de crear la ventana: los modos sin GL salen antes de tocarla
+    int cpuGBufferSize = 0;
+    RenderShards shards;
+    int shardWorkers = 0;
+    std::string benchPath;
+    int benchIterations = 100;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--model" && i + 1 < argc) {
+            auto found = std::find(models.begin(), models.end(), std::string(argv[++i]));
+            if (found != models.end())
+                currentModel = (int)(found - models.begin());
+            else
+                std::cout << "Unknown model " << argv[i] << std::endl;
+        }
+        else if (arg == "--importer" && i + 1 < argc && !parseImporter(argv[++i]))
+            std::cout << "Unknown importer " << argv[i] << " (auto, assimp, obj)" << std::endl;
+        // cache binaria de las mallas, mapeada (utils/mesh_cache.h)
+        else if (arg == "--mesh-cache") {
+            if (i + 1 < argc && std::find(models.begin(), models.end(), std::string(argv[i + 1])) != models.end())
+                meshCacheModels.push_back(argv[++i]);
+            else
+                Model::UseMeshCache = true;
+        }
+        else if (arg == "--shard" && i + 3 < argc) {
+            shardWorkers = std::max(std::atoi(argv[++i]), 1);
+            shards.Frames = std::max(std::atoi(argv[++i]), 1);
+            shards.Directory = argv[++i];
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                shards.Base.Width = shards.Base.Height = std::atoi(argv[++i]);
+        }
+        else if (arg == "--sweep" && i + 3 < argc) {
+            shards.SweepParam = argv[++i];
+            shards.SweepFrom = (float)std::atof(argv[++i]);
+            shards.SweepTo = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--cpu-gbuffer") {
+            cpuGBufferSize = 512;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                cpuGBufferSize = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ssao-bench" && i + 1 < argc) {
+            benchPath = argv[++i];
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                benchIterations = std::atoi(argv[++i]);
+        }
+    }
+
+    // --cpu-gbuffer [lado] y --shard <workers> <frames> <dir> [lado]: los modos sin GL, antes de la ventana
+    if (cpuGBufferSize > 0)
+        return RunCpuGBuffer(currentModel, cpuGBufferSize);
+    if (shardWorkers > 0) {
+        shards.Workers = shardWorkers;
+        return RunShardCoordinator(shards, argc, argv);
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -76,6 +362,10 @@ int main()
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    // los modos por lotes no muestran nada: la ventana solo esta para tener el contexto de GL
+    for (int i = 1; i < argc; ++i)
+        if (std::string(argv[i]) == "--turntable" || std::string(argv[i]) == "--serve" || std::string(argv[i]) == "--ssao-bench")
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // window
     // --------------------
@@ -87,6 +377,7 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
@@ -110,175 +401,153 @@ int main()
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
 
-    // cargar shaders
-    Shader shaderGeometryPass("gbuffer.vert", "gbuffer.frag");
-    Shader shaderLightingPass("def_lighting_shader.vert", "def_lighting_shader.frag");
-    Shader shaderSSAOPass("ssao_lighting_shader.vert", "ssao_lighting_shader.frag");
-    Shader shaderSSAO("ssao_shader.vert", "ssao_shader.frag");
-    Shader shaderPos("gPos_shader.vert", "gPos_shader.frag");
-    Shader shaderNormal("gNormal_shader.vert", "gNormal_shader.frag");
-    Shader shaderColor("gColor_shader.vert", "gColor_shader.frag");
-    Shader shaderSSAOViewer("ssaoViewer_shader.vert", "ssaoViewer_shader.frag");
-
-    // load models (Assimp es bastante lento)
+    // programas de los pases, con el kernel de muestras de la interfaz
+    PassPrograms programs(kernelDistribution);
+
+    // --ssao-bench <archivo|dir> [iteraciones]: los pases de SSAO sobre instantaneas del g-buffer. Corre antes de
+    // cargar los modelos y sin precompilar nada
+    if (!benchPath.empty()) {
+        int result = RunSSAOBench(programs, benchPath, benchIterations);
+        glfwTerminate();
+        return result;
+    }
+
+    // los modos que se alternan desde la interfaz se compilan (o se leen de la cache) al arrancar
+    programs.Precompile(normalOct);
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--keep-mesh-data")
+            keepMeshData = true;
+    }
+
+    // load models (los .obj con el cargador propio salvo --importer assimp; Assimp es bastante lento). Por modelo se informan las reservas del heap y el pico de memoria
     std::cout << "Loading models..." << std::endl;
-    Model suzanne(FileSystem::getPath("models/suzanne/suzanne.obj"));
+    AllocScope importStats;
+    Model suzanne(FileSystem::getPath("models/suzanne/suzanne.obj"), false, keepMeshData, importerFor("suzanne"), meshCacheFor("suzanne"));
+    importStats.Report(std::cout, "suzanne");
     std::cout << "Loading backpack..." << std::endl;
-    Model backpack(FileSystem::getPath("models/backpack/backpack.obj"));
+    Model backpack(FileSystem::getPath("models/backpack/backpack.obj"), false, keepMeshData, importerFor("backpack"), meshCacheFor("backpack"));
+    importStats.Report(std::cout, "backpack");
     std::cout << "Loading deforme..." << std::endl;
-    Model deforme(FileSystem::getPath("models/deforme/deforme.obj"));
+    Model deforme(FileSystem::getPath("models/deforme/deforme.obj"), false, keepMeshData, importerFor("deforme"), meshCacheFor("deforme"));
+    importStats.Report(std::cout, "deforme");
     std::cout << "Loading superficie..." << std::endl;
-    Model superficie(FileSystem::getPath("models/superficie/superficie.obj"));
+    Model superficie(FileSystem::getPath("models/superficie/superficie.obj"), false, keepMeshData, importerFor("superficie"), meshCacheFor("superficie"));
+    importStats.Report(std::cout, "superficie");
     std::cout << "Loading superficie2..." << std::endl;
-    Model superficie2(FileSystem::getPath("models/superficie2/superficie2.obj"));
+    Model superficie2(FileSystem::getPath("models/superficie2/superficie2.obj"), false, keepMeshData, importerFor("superficie2"), meshCacheFor("superficie2"));
+    importStats.Report(std::cout, "superficie2");
     std::cout << "Models loaded." << std::endl;
 
-    // model matrix
-    glm::vec3 objectPosition(0.0, 0.0, 0.0);
-    glm::mat4 model = glm::mat4(1.0f);
-    shaderGeometryPass.use();
-    model = glm::mat4(1.0f);
-    model = glm::scale(model, glm::vec3(0.1f));
-    model = glm::translate(model, objectPosition);
-    shaderGeometryPass.setMat4("model", model);
-
-    // g-buffer
-    unsigned int gBuffer;
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedo;
-
-        // position buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-        // normal buffer
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-   
-        // color + specular color buffer (en caso del modelo tener una textura para la especular)
-    glGenTextures(1, &gAlbedo);
-    glBindTexture(GL_TEXTURE_2D, gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedo, 0);
-   
-        // decimos como vamos a enlazar los color-buffer para renderizar. Para este framebuffer
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-    
-        // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    //                ----->    SSAO BUFFER    <-----
-    // -----------------------------------------------------
-    unsigned int ssaoFBO;
-    glGenFramebuffers(1, &ssaoFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-
-    unsigned int ssaoColorBuffer;
-        // SSAO buffer
-    glGenTextures(1, &ssaoColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Framebuffer not complete!" << std::endl;
-
-    
-        // muestras (samples)
-    std::vector<glm::vec3> samples = GenerateSamples(64);
-        // vectores rotacion y textura
-    std::vector<glm::vec3> rotationNoise = GenerateRotationNoise();
-    unsigned int noiseTexture; glGenTextures(1, &noiseTexture);
-    glBindTexture(GL_TEXTURE_2D, noiseTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 4, 4, 0, GL_RGB, GL_FLOAT, &rotationNoise[0]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // escena: cada modelo con su escala base, mismo orden que 'models'
+    Scene scene;
+    scene.AddModel(&suzanne, modelScales[0]);
+    scene.AddModel(&backpack, modelScales[1]);
+    scene.AddModel(&deforme, modelScales[2]);
+    scene.AddModel(&superficie, modelScales[3]);
+    scene.AddModel(&superficie2, modelScales[4]);
+    int builtModel = -1, builtGrid = 0;
+    bool useOcclusionCulling = false;
+
+    // lo que usa el hilo de render; hasta que arranca lo usa este
+    RenderResources render(programs, scene, sceneGrid);
+
+    // parametros que graba / reproduce la sesion (por nombre: agregar al final no rompe traces viejos)
+    session.Bind("model", &currentModel);
+    session.Bind("rotate", &rotateModel);
+    session.Bind("grid", &sceneGrid);
+    session.Bind("extraLights", &extraLights);
+    session.Bind("depthPrepass", &depthPrepassMode);
+    session.Bind("meshletCulling", &scene.MeshletCulling);
+    session.Bind("occlusionCulling", &useOcclusionCulling);
+    session.Bind("ssao", &SSAO);
+    session.Bind("bakedAO", &bakedAO);
+    session.Bind("smooth", &ssaoSmooth);
+    session.Bind("blur", &ssaoBlur);
+    session.Bind("normalOct", &normalOct);
+    session.Bind("stencilCoverage", &stencilCoverage);
+    session.Bind("incremental", &incrementalRendering);
+    session.Bind("intensity", &ssaoIntensity);
+    session.Bind("radius", &ssaoRadius);
+    session.Bind("bias", &ssaoBias);
+    session.Bind("samples", &samplesNum);
+    session.Bind("kernel", &kernelDistribution);
+    session.Bind("blueNoise", &blueNoise);
+    session.Bind("noiseSize", &noiseSize);
+    session.Bind("adaptive", &ssaoAdaptive);
+    session.Bind("minSamples", &ssaoMinSamples);
+    session.Bind("dynamicResolution", &dynamicResolutionEnabled);
+    session.Bind("targetMs", &dynamicResolutionTarget);
+    session.Bind("debugPos", &DEBUG_Pos);
+    session.Bind("debugNormal", &DEBUG_Normal);
+    session.Bind("debugColor", &DEBUG_Color);
+    session.Bind("debugSSAO", &DEBUG_SSAO);
+
+    // bake de AO: "--bake-ao [rayos]" hornea todos los modelos antes de arrancar; desde la interfaz, el actual
+    bool memoryReport = false;
+    int turntableViews = 0, turntableSize = 256;
+    std::string servicePath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bake-ao") {
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                render.Baker.Rays = std::atoi(argv[++i]);
+            for (Model* model : scene.Models)
+                BakeModel(render.Baker, *model);
+        }
+        else if (arg == "--memory-report") {
+            memoryReport = true;
+        }
+        else if ((arg == "--record" || arg == "--replay") && i + 1 < argc) {
+            sessionPath = argv[++i];
+            bool started = arg == "--record" ? session.StartRecording(sessionPath) : session.StartReplay(sessionPath);
+            if (!started)
+                std::cout << "Could not open session " << sessionPath << std::endl;
+            replayExit = session.Replaying();
+        }
+        else if (arg == "--turntable") {
+            turntableViews = 16;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                turntableViews = std::min(std::atoi(argv[++i]), MultiViewTargets::MAX_VIEWS);
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                turntableSize = std::atoi(argv[++i]);
+        }
+        else if (arg == "--serve" && i + 1 < argc) {
+            servicePath = argv[++i];
+        }
+    }
 
-    //  ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-    // -----------------------------------------------------
+    glClearColor(0.35f, 0.35f, 0.55f, 1.0f);
 
-    // lighting info
-    // -------------
-    const unsigned int NR_LIGHTS = 1;
-    glm::vec3 lightPosition(-1.f,1.f,4.f);
-    glm::vec3 lightColor(1.f,1.f,1.f);
+    // --turntable [vistas] [lado] y --serve <dir>: modos por lotes con la ventana oculta, salen al terminar
+    if (turntableViews > 0 || !servicePath.empty()) {
+        int result = RunBatch(scene, programs.Samples, turntableViews, turntableSize, servicePath);
+        glfwTerminate();
+        return result;
+    }
 
-    // shader configuration
-    // --------------------
-    
-    shaderLightingPass.use();
-    shaderLightingPass.setInt("gPosition", 0);
-    shaderLightingPass.setInt("gNormal", 1);
-    shaderLightingPass.setInt("gAlbedo", 2);
-    shaderLightingPass.setInt("ssao", 3);
-
-    shaderSSAO.use();
-    shaderSSAO.setInt("gPosition", 0);
-    shaderSSAO.setInt("gNormal", 1);
-    shaderSSAO.setInt("gAlbedo", 2);
-    shaderSSAO.setInt("ssao", 3);
-
-    shaderSSAOPass.use();
-    shaderSSAOPass.setInt("gPosition", 0);
-    shaderSSAOPass.setInt("gNormal", 1);
-    shaderSSAOPass.setInt("texNoise", 2);
-
-            // DEBUG gPos, gNormal y SSAOviewer shaders
-    shaderPos.use();
-    shaderPos.setInt("gPosition", 0);
-    shaderPos.setInt("gNormal", 1);
-    shaderPos.setInt("gAlbedo", 2);
-
-    shaderNormal.use();
-    shaderNormal.setInt("gPosition", 0);
-    shaderNormal.setInt("gNormal", 1);
-    shaderNormal.setInt("gAlbedo", 2);
-
-    shaderColor.use();
-    shaderColor.setInt("gPosition", 0);
-    shaderColor.setInt("gNormal", 1);
-    shaderColor.setInt("gAlbedo", 2);
-
-    shaderSSAOViewer.use();
-    shaderSSAOViewer.setInt("gPosition", 0);
-    shaderSSAOViewer.setInt("gNormal", 1);
-    shaderSSAOViewer.setInt("gAlbedo", 2);
+    // --memory-report: la memoria de cada recurso al arrancar
+    if (memoryReport) {
+        MemoryReport report = QueryMemory(render);
+        report.Add("Scene", "instances", scene.Memory());
+        report.Print(std::cout);
+    }
+    int bakeRays = render.Baker.Rays;    // el slider de la interfaz; el baker es del hilo de render
 
-    // ----------      ----------
+    // ImGui crea sus texturas y shaders en el primer NewFrame del backend de GL: se hace aca, con el contexto
+    // todavia en este hilo (despues el render solo dibuja lo que arma el update)
+    ImGui_ImplOpenGL3_NewFrame();
 
-    glClearColor(0.35f, 0.35f, 0.55f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
+    // desde aca el contexto y 'render' son del hilo de render
+    glfwMakeContextCurrent(NULL);
+    std::thread renderThread(RenderLoop, window, std::ref(render));
 
-    // render loop
-    // -----------
+    // ---------- hilo de update ----------
     while (!glfwWindowShouldClose(window))
     {
+        double updateStart = glfwGetTime();
+
         // per-frame time logic
         // --------------------
         auto currentFrame = static_cast<float>(glfwGetTime());
@@ -288,172 +557,266 @@ int main()
         // input
         processInput(window);
 
-        // parametros para SSAO
-        shaderSSAOPass.use();
-        shaderSSAOPass.setInt("samplesNum", samplesNum);
-        shaderSSAOPass.setFloat("radius", ssaoRadius);
-        shaderSSAOPass.setFloat("bias", ssaoBias);
-        shaderSSAOPass.setFloat("intensity", ssaoIntensity);
-        shaderSSAOPass.setBool("ssaoSmooth", ssaoSmooth);
-
-        // render
-        // ------
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // 1. geometry pass: render scene's geometry/color data into gbuffer
-        // -----------------------------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 50.0f);
-            glm::mat4 view = camera.GetViewMatrix();
-            glm::mat4 model = glm::mat4(1.0f);
-            shaderGeometryPass.use();
-            shaderGeometryPass.setMat4("projection", projection);
-            shaderGeometryPass.setMat4("view", view);
-        
-            model = glm::rotate(glm::mat4(1.f), .2f*glm::radians(modelAngle), glm::vec3{ 0.f,1.f,0.f });
-            shaderGeometryPass.setMat4("model", model);
-
-            // model
-            if (currentModel == 0) {
-                model = glm::scale(model, glm::vec3(0.5f));
-                shaderGeometryPass.setMat4("model", model);
-                suzanne.Draw(shaderGeometryPass);
-            }
-            else if (currentModel == 1) {
-                model = glm::scale(model, glm::vec3(0.5f));
-                shaderGeometryPass.setMat4("model", model);
-                backpack.Draw(shaderGeometryPass);
-            }
-            else if ( currentModel == 2 ){
-                model = glm::scale(model, glm::vec3(0.07f));
-                shaderGeometryPass.setMat4("model", model);
-                deforme.Draw(shaderGeometryPass);
-            }
-            else if ( currentModel == 3 ){
-                model = glm::scale(model, glm::vec3(0.1f));
-                shaderGeometryPass.setMat4("model", model);
-                superficie.Draw(shaderGeometryPass);
-            }
-            else if ( currentModel == 4 ){
-                model = glm::scale(model, glm::vec3(0.1f));
-                shaderGeometryPass.setMat4("model", model);
-                superficie2.Draw(shaderGeometryPass);
-            }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        
-        // ---------- SSAO ----------
-        // mandar la informacion del gBuffer al SSAO framebuffer para calcular la oclusion
-        glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderSSAOPass.use();
-            // Send samples
-            for (unsigned int i = 0; i < 64; ++i)
-                shaderSSAOPass.setVec3("samples[" + std::to_string(i) + "]", samples[i]);
-            shaderSSAOPass.setMat4("projection", projection);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, gNormal);
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, noiseTexture);
-            renderQuad();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // ----------      ----------
+        // ventana minimizada: no hay nada que renderizar
+        if (scrWidth == 0 || scrHeight == 0) {
+            glfwWaitEvents();
+            continue;
+        }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // lo ultimo que devolvio el render: sigue en Read() hasta el proximo Acquire
+        renderStats.Acquire();
+        const RenderStats& stats = renderStats.Read();
+
+        // sesion: grabar el estado de este frame o reemplazarlo por el grabado (la escala grabada es la que
+        // uso el render mas reciente)
+        SessionRecorder::State sessionState;
+        sessionState.DeltaTime = deltaTime;
+        sessionState.Position = camera.Position;
+        sessionState.Yaw = camera.Yaw;
+        sessionState.Pitch = camera.Pitch;
+        sessionState.Zoom = camera.Zoom;
+        sessionState.ModelAngle = modelAngle;
+        sessionState.RenderScale = stats.RenderScale;
+        sessionState.SampleScale = stats.SampleScale;
+        if (!session.Frame(sessionState) && replayExit)
+            glfwSetWindowShouldClose(window, true);
+        float replayScale = 0.0f, replaySampleScale = 0.0f;
+        if (session.Replaying()) {
+            deltaTime = sessionState.DeltaTime;
+            camera.Position = sessionState.Position;
+            camera.SetOrientation(sessionState.Yaw, sessionState.Pitch);
+            camera.Zoom = sessionState.Zoom;
+            modelAngle = sessionState.ModelAngle;
+            replayScale = sessionState.RenderScale;
+            replaySampleScale = sessionState.SampleScale;
+        }
 
-        // 2. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content.
-        // -----------------------------------------------------------------------------------------------------------------------
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // camara (la resolucion interna conserva la proporcion de la ventana)
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)scrWidth / (float)scrHeight, 0.1f, 50.0f);
+        glm::mat4 view = camera.GetViewMatrix();
 
-            // send light relevant uniforms
-        glm::vec3 lightPosView = glm::vec3(camera.GetViewMatrix() * glm::vec4(lightPosition, 1.0));
-
-        if (SSAO) {
-            shaderSSAO.use();
-            shaderSSAO.setVec3("light.Position", lightPosView);
-            shaderSSAO.setVec3("light.Color", lightColor);
-        }else if (DEBUG_Pos) {
-            shaderPos.use();
-            shaderPos.setVec3("light.Position", lightPosView);
-            shaderPos.setVec3("light.Color", lightColor);
-        }else if (DEBUG_Normal) {
-            shaderNormal.use();
-            shaderNormal.setVec3("light.Position", lightPosView);
-            shaderNormal.setVec3("light.Color", lightColor);
-        }else if (DEBUG_Color) {
-            shaderColor.use();
-            shaderColor.setVec3("light.Position", lightPosView);
-            shaderColor.setVec3("light.Color", lightColor);
-        }
-        else if (DEBUG_SSAO) {
-            shaderSSAOViewer.use();
-            shaderSSAOViewer.setVec3("light.Position", lightPosView);
-            shaderSSAOViewer.setVec3("light.Color", lightColor);
-        }else {
-            shaderLightingPass.use();                   // shaderlightingpass es igual a shaderSSAO pero no usa la oclusion
-            shaderLightingPass.setVec3("light.Position", lightPosView);
-            shaderLightingPass.setVec3("light.Color", lightColor);
+        // escena: se rearma solo si cambio el modelo o la grilla; el giro se actualiza cada frame
+        if (builtModel != currentModel || builtGrid != sceneGrid) {
+            BuildScene(scene, currentModel, sceneGrid);
+            builtModel = currentModel;
+            builtGrid = sceneGrid;
         }
-            // activar las texturas del gbuffer + ssao-buffer
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gAlbedo);
-        glActiveTexture(GL_TEXTURE3); // add extra SSAO texture to lighting pass
-        glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-        renderQuad();
-        
-        // FINALMENTE renderizar el quad
-        renderQuad();
+        std::fill(scene.Yaw.begin(), scene.Yaw.end(), .2f * glm::radians(modelAngle));
+        scene.UpdateTransforms();
+        scene.Cull(projection * view, camera.Position);
+
+        // paquete del frame: la DrawList y una copia de los parametros
+        FramePacket& packet = framePackets.Write();
+        scene.Pack(packet.Draws);
+        packet.Frame = frameCount;
+        packet.Width = scrWidth;
+        packet.Height = scrHeight;
+        packet.View = view;
+        packet.Projection = projection;
+        packet.Model = currentModel;
+        packet.Grid = sceneGrid;
+        packet.ModelAngle = modelAngle;
+        packet.ExtraLights = extraLights;
+        packet.DepthPrepass = depthPrepassMode;
+        packet.SSAO = SSAO;
+        packet.BakedAO = bakedAO;
+        packet.Smooth = ssaoSmooth;
+        packet.Blur = ssaoBlur;
+        packet.NormalOct = normalOct;
+        packet.Adaptive = ssaoAdaptive;
+        packet.BlueNoise = blueNoise;
+        packet.Samples = samplesNum;
+        packet.MinSamples = ssaoMinSamples;
+        packet.Kernel = kernelDistribution;
+        packet.NoiseSize = noiseSize;
+        packet.DebugView = SSAO ? 0 : DEBUG_Pos ? 1 : DEBUG_Normal ? 2 : DEBUG_Color ? 3 : DEBUG_SSAO ? 4 : 0;
+        packet.Radius = ssaoRadius;
+        packet.Bias = ssaoBias;
+        packet.Intensity = ssaoIntensity;
+        packet.OcclusionCulling = useOcclusionCulling;
+        packet.Coverage = stencilCoverage;
+        packet.Incremental = incrementalRendering;
+        packet.DynamicResolution = dynamicResolutionEnabled;
+        packet.TargetMs = dynamicResolutionTarget;
+        packet.ReplayScale = replayScale;
+        packet.ReplaySampleScale = replaySampleScale;
+        packet.CaptureSource = captureSource;
+        packet.CaptureEncoding = captureEncoding;
+        packet.CaptureRecord = captureRecord;
 
         // ---------- ImGui ----------
+        // se arma aca (los eventos llegan a este hilo) y se dibuja en el render con las listas copiadas al paquete
         ImGui::SetCurrentContext(imgui_context);
-        ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
         ImGui::Begin("SSAO");
 
         Combo(".obj (O)", &currentModel, models);
         ImGui::Checkbox("Rotate (R)", &rotateModel);
+        ImGui::SliderInt("Grid", &sceneGrid, 1, 100);
+        ImGui::Text("Instances: %d visible / %d", (int)scene.VisibleCount, (int)scene.InstanceCount());
+        ImGui::Checkbox("Meshlet culling", &scene.MeshletCulling);
+        if (scene.MeshletCulling && scene.VisibleCount > scene.MeshletMaxInstances)
+            ImGui::Text("Meshlets: off above %d visible instances", (int)scene.MeshletMaxInstances);
+        else if (scene.MeshletCulling)
+            ImGui::Text("Meshlets: %d visible / %d (%d draw ranges)", (int)scene.MeshletsVisible, (int)scene.MeshletsTested, (int)scene.MeshletDraws);
+        ImGui::Checkbox("Occlusion culling (Hi-Z)", &useOcclusionCulling);
+        if (useOcclusionCulling)
+            ImGui::Text("Occlusion: %d visible / %d tested", (int)stats.OcclusionVisible, (int)stats.OcclusionTested);
+        ImGui::SliderInt("Extra lights", &extraLights, 0, 1024);
+        ImGui::Combo("Depth pre-pass", &depthPrepassMode, "Off\0On\0Auto\0");
+        if (stats.PrepassMeasured) {
+            ImGui::Text("Geometry pass: %.2f ms without / %.2f ms with pre-pass -> %s", stats.PrepassMs[0], stats.PrepassMs[1],
+                stats.PrepassFaster ? "pre-pass pays off" : "no pre-pass");
+        }
+        ImGui::Text("Light indices: %d (max %d per cluster)", (int)stats.LightIndices, (int)stats.MaxLightsPerCluster);
         ImGui::Checkbox("gPositions shading (1)", &DEBUG_Pos);
         ImGui::Checkbox("gNormals shading (2)", &DEBUG_Normal);
         ImGui::Checkbox("gColor shading (3)", &DEBUG_Color);
-        //ImGui::Checkbox("occlusion shading (4)", &DEBUG_SSAO);    No muestra la escala de grises esperaria, no encuentro el error
+        ImGui::Checkbox("occlusion shading (4)", &DEBUG_SSAO);
         ImGui::Checkbox("SSAO (Z)", &SSAO);
+        ImGui::Checkbox("Baked AO (static models, no SSAO pass)", &bakedAO);
+        ImGui::SliderInt("Bake rays", &bakeRays, 16, 1024);
+        if (ImGui::Button("Bake AO")) {
+            int model = currentModel, rays = bakeRays;
+            RunOnRender([&render, model, rays]() {
+                render.Baker.Rays = rays;
+                BakeModel(render.Baker, *render.World.Models[model]);
+                render.Cache.Invalidate();    // el g-buffer guardado tiene la AO horneada anterior
+            });
+        }
+        if (bakedAO && currentModel < (int)stats.BakedModels.size() && !stats.BakedModels[currentModel])
+            ImGui::TextDisabled("no bake for this model (press Bake AO or run with --bake-ao)");
         ImGui::Checkbox("Smooth (K)", &ssaoSmooth);
+        ImGui::Checkbox("Blur SSAO", &ssaoBlur);
+        ImGui::Checkbox("Octahedral normals", &normalOct);
+        ImGui::Checkbox("Skip background (stencil)", &stencilCoverage);
+        ImGui::Checkbox("Reuse unchanged passes", &incrementalRendering);
+        if (incrementalRendering)
+            ImGui::Text("Rerun: g-buffer %s | AO %s | lighting %s", stats.StageRan[FrameCache::GEOMETRY] ? "yes" : "no",
+                stats.StageRan[FrameCache::AO] ? "yes" : "no", stats.StageRan[FrameCache::LIGHTING] ? "yes" : "no");
         ImGui::SliderFloat("SSAO intensity", &ssaoIntensity, 0.1f, 9.f);
         ImGui::SliderFloat("SSAO radius", &ssaoRadius, 0.1f, 5.f);
         ImGui::SliderFloat("SSAO bias", &ssaoBias, 0.0f, 1.f);
         ImGui::SliderInt("SSAO samples", &samplesNum, 1, 64);
+        ImGui::Combo("SSAO kernel", &kernelDistribution, "Random\0Halton\0Poisson disk\0");
+        int noiseIndex = 0;
+        while ((4 << noiseIndex) < noiseSize)
+            ++noiseIndex;
+        ImGui::Checkbox("Blue noise", &blueNoise);
+        if (ImGui::Combo("Noise size", &noiseIndex, "4\08\016\032\064\0128\0"))
+            noiseSize = 4 << noiseIndex;
+        ImGui::Checkbox("Adaptive samples", &ssaoAdaptive);
+        ImGui::SliderInt("Adaptive min samples", &ssaoMinSamples, 1, 32);
+        ImGui::Checkbox("Dynamic resolution", &dynamicResolutionEnabled);
+        ImGui::SliderFloat("Target GPU ms", &dynamicResolutionTarget, 2.f, 50.f);
+        ImGui::Text("Frame graph: %d passes (%d culled) | %d textures -> %d physical | %.1f MB (pool %.1f MB)",
+            stats.Passes, stats.CulledPasses, stats.VirtualTextures, stats.PhysicalTextures,
+            stats.PhysicalBytes / 1048576.0, stats.PoolBytes / 1048576.0);
+        ImGui::Combo("Capture", &captureSource, "Frame\0Occlusion\0gPosition\0gNormal\0gAlbedo\0");
+        ImGui::Combo("Capture format", &captureEncoding, "PNG\0PFM (float)\0Raw\0");
+        if (ImGui::Button("Screenshot"))
+            RunOnRender([]() { captureOnce = true; });
+        ImGui::SameLine();
+        ImGui::Checkbox("Record sequence", &captureRecord);
+        ImGui::SameLine();
+        if (ImGui::Button("G-buffer snapshot"))
+            RunOnRender([]() { snapshotOnce = true; });
+        ImGui::Text("Captures: %llu written / %llu dropped | %d in flight", stats.CapturesWritten, stats.CapturesDropped, (int)stats.CapturesPending);
+        packet.MemoryReport = false;
+        if (ImGui::CollapsingHeader("Memory")) {
+            packet.MemoryReport = true;
+            if (ImGui::Checkbox("Keep mesh CPU copies", &keepMeshData)) {
+                bool keep = keepMeshData;
+                RunOnRender([&scene, keep]() {
+                    for (Model* model : scene.Models)
+                        keep ? model->RestoreCpuData() : model->ReleaseCpuData();
+                });
+            }
+            // lo del render (de un frame anterior) mas lo del update
+            MemoryReport memory = stats.Memory;
+            memory.Add("Scene", "instances", scene.Memory());
+            memory.Add("Scene", "draw lists (3 packets)", MemoryUsage(3 * packet.Draws.MemoryBytes(), 0));
+            for (const std::string& category : memory.Categories()) {
+                MemoryUsage usage = memory.Total(category);
+                if (ImGui::TreeNode(category.c_str(), "%s: %.2f MB CPU / %.2f MB GPU", category.c_str(), usage.Cpu / 1048576.0, usage.Gpu / 1048576.0)) {
+                    for (const MemoryReport::Entry& e : memory.Entries)
+                        if (e.Category == category)
+                            ImGui::BulletText("%s: %.2f MB CPU / %.2f MB GPU", e.Name.c_str(), e.Usage.Cpu / 1048576.0, e.Usage.Gpu / 1048576.0);
+                    ImGui::TreePop();
+                }
+            }
+            MemoryUsage total = memory.Total();
+            ImGui::Text("Total: %.2f MB CPU / %.2f MB GPU", total.Cpu / 1048576.0, total.Gpu / 1048576.0);
+        }
+        if (!session.Recording() && !session.Replaying()) {
+            if (ImGui::Button("Record session"))
+                session.StartRecording(sessionPath);
+            ImGui::SameLine();
+            if (ImGui::Button("Replay session"))
+                session.StartReplay(sessionPath);
+        }
+        else {
+            ImGui::Text("%s %s: frame %d", session.Recording() ? "Recording" : "Replaying", sessionPath.c_str(), (int)session.FrameIndex);
+            ImGui::SameLine();
+            if (ImGui::Button("Stop"))
+                session.Stop();
+        }
+        ImGui::Text("GL state calls: %llu issued / %llu filtered", stats.GlIssued, stats.GlFiltered);
+        ImGui::Text("Shader permutations: %d", (int)stats.ShaderPermutations);
+        ImGui::Text("GPU %.2f ms | %dx%d (%.0f%%) | %d samples", stats.GpuMs, stats.RenderWidth, stats.RenderHeight,
+            100.f * stats.RenderScale, stats.Samples);
+        ImGui::Text("CPU: update %.2f ms | render %.2f ms", updateMs, stats.CpuMs);
         ImGui::End();
         ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        packet.Ui.Capture(ImGui::GetDrawData());
 
         // ---------- ImGui ----------
 
+        // traspaso: se publica cuando el render ya tomo el paquete anterior (no mas de un frame de adelanto)
+        updateMs = 1000.0f * (float)(glfwGetTime() - updateStart);
+        {
+            std::unique_lock<std::mutex> lock(handoffMutex);
+            handoff.wait(lock, [&packet] { return acquiredFrame.load() >= packet.Frame; });
+        }
+        framePackets.Publish();
+        NotifyHandoff();
+
         // rotacion del modelo
         if (rotateModel) modelAngle += 1.f + deltaTime;
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        ++frameCount;
+
+        // glfw: poll IO events (keys pressed/released, mouse moved etc.)
+        // ---------------------------------------------------------------
+        // quieto (el render reuso todo y nada anima): se espera un evento en vez de girar, asi el visor ocioso casi
+        // no gasta CPU ni GPU
+        bool idle = incrementalRendering && !rotateModel && !captureRecord && !session.Recording() && !session.Replaying();
+        for (int stage = 0; stage < FrameCache::STAGES; ++stage)
+            idle = idle && !stats.StageRan[stage];
+        if (idle)
+            glfwWaitEventsTimeout(0.5);
+        else
+            glfwPollEvents();
     }
 
+    // el render termina el paquete que tenga y suelta el contexto
+    renderQuit = true;
+    NotifyHandoff();
+    renderThread.join();
+    glfwMakeContextCurrent(window);
+
+    session.Stop();
+    render.Capture.Clear();
+    render.Graph.Clear();
     glfwTerminate();
     return 0;
 }
 
-// renderQuad() renders a 1x1 XY quad in NDC
+// renderQuad() renders a 1x1 XY quad in NDC ('instances' copies: one per layer in the multi-view passes)
 // -----------------------------------------
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
-void renderQuad()
+void renderQuad(int instances)
 {
     if (quadVAO == 0)
     {
@@ -467,7 +830,7 @@ void renderQuad()
         // setup plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        GLState::Get().BindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -475,9 +838,11 @@ void renderQuad()
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    GLState::Get().BindVertexArray(quadVAO);
+    if (instances > 1)
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances);
+    else
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
 // inputs
@@ -486,6 +851,9 @@ void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    // durante un replay la camara y los parametros salen del trace
+    if (session.Replaying())
+        return;
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         camera.ProcessKeyboard(FORWARD, deltaTime);
@@ -544,15 +912,22 @@ void processInput(GLFWwindow* window)
         ssaoSmooth = !ssaoSmooth;
         kPressed = false;
     }
+    if (!gPressed && glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS)                   // instantanea del g-buffer
+        gPressed = true;
+    if (gPressed && glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) {
+        RunOnRender([]() { snapshotOnce = true; });
+        gPressed = false;
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    // make sure the viewport matches the new window dimensions; note that width and 
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    // note that width and height will be significantly larger than specified on retina displays.
+    // el tamanio viaja en el proximo paquete: el render ajusta el viewport y el frame graph pide los targets
+    scrWidth = width;
+    scrHeight = height;
 }
 
 bool mouseButtonPressed = false;
@@ -573,7 +948,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
-    if (mouseButtonPressed) {
+    if (mouseButtonPressed && !session.Replaying()) {
         float xpos = static_cast<float>(xposIn);
         float ypos = static_cast<float>(yposIn);
         if (firstMouse)
@@ -597,7 +972,35 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    if (!session.Replaying())
+        camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+// arma una grilla de grid x grid instancias del modelo, centrada en el origen y separada segun su tamanio
+void BuildScene(Scene& scene, int model, int grid) {
+    scene.ClearInstances();
+    float spacing = 2.5f * scene.Models[model]->BoundsRadius() * scene.ModelScale[model];
+    float origin = -0.5f * (grid - 1) * spacing;
+    for (int z = 0; z < grid; ++z)
+        for (int x = 0; x < grid; ++x)
+            scene.AddInstance(model, glm::vec3(origin + x * spacing, 0.f, origin + z * spacing));
+}
+
+// luz principal (la de siempre, con radio "infinito") + luces extra pseudo-aleatorias sobre la escena
+void BuildLights(std::vector<PointLight>& lights, int extra, float extent) {
+    lights.clear();
+    lights.push_back({ glm::vec3(-1.f, 1.f, 4.f), glm::vec3(1.f, 1.f, 1.f), 1000.f });
+    std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
+    std::default_random_engine generator;
+    extent = std::max(extent, 1.f);
+    for (int i = 0; i < extra; ++i) {
+        glm::vec3 position(
+            (randomFloats(generator) * 2.f - 1.f) * extent,
+            randomFloats(generator) * 1.5f - 0.25f,
+            (randomFloats(generator) * 2.f - 1.f) * extent);
+        glm::vec3 color(randomFloats(generator), randomFloats(generator), randomFloats(generator));
+        lights.push_back({ position, color / std::max(color.r, std::max(color.g, color.b)), 0.5f + randomFloats(generator) * 1.5f });
+    }
 }
 
 // ImGui auxiliar
@@ -612,37 +1015,1293 @@ bool Combo(const char* label, int* current_item, const std::vector<std::string>&
 /*
 * Genera un "Kernel" (asi le dice learnopengl) de muestras (samples) que se usarn para hacer un offset
 * a la posicin en view-space del fragmento en una semiesfera orientada hacia la normal del fragmento.
+* Con HALTON o POISSON (utils/sample_sets.h) las muestras se concentran cerca del origen y cualquier
+* prefijo del kernel esta bien distribuido, asi que samplesNum < 64 no pierde calidad.
 */
-std::vector<glm::vec3> GenerateSamples(int n) {
-    std::uniform_real_distribution<float> randomFloats(0.0, 1.0);   // genera flotantes aleatorios en una distribucion uniforme
-    std::default_random_engine generator;       // genera numero pseudo-aleatorios
-    std::vector<glm::vec3> samples;
-    for (int i = 0; i < n; ++i) {
-        glm::vec3 sample(
-            randomFloats(generator) * 2.0 - 1.0,    // x random entre -1 y 1
-            randomFloats(generator) * 2.0 - 1.0,    // y random entre -1 y 1
-            randomFloats(generator));   // se supone que la normal de la superficie apunta a z
-        sample = glm::normalize(sample);
-        sample *= randomFloats(generator);  // una longitud aleatoria entre 0 y 1 (estarian acotados en la semiesfera)
-        // ac podramos acomodarlos ms cerca del origen, pero meh
-        samples.push_back(sample);
-    }
-    return samples;
+std::vector<glm::vec3> GenerateSamples(int n, int distribution) {
+    return SampleSets::Kernel(n, (SampleSets::Distribution)distribution);
 }
 
 /*
 * Genera una matriz de 4x4 con vectores de rotacin pseudo aleatorios
+* (o de size x size con blue noise: sin grumos de baja frecuencia, el blur lo limpia mejor)
 */
-std::vector<glm::vec3> GenerateRotationNoise() {
-    std::uniform_real_distribution<float> randomFloats(0.0, 360.0);   // genera flotantes aleatorios en una distribucion uniforme
-    std::default_random_engine generator;       // genera numero pseudo-aleatorios
-    std::vector<glm::vec3> angles;
-    for (int i = 0; i < 16; ++i) {
-        glm::vec3 rotation(
-            randomFloats(generator) * 2.0 - 1.0,
-            randomFloats(generator) * 2.0 - 1.0,
-            0.f);
-        angles.push_back(rotation);
-    }
-    return angles;
+std::vector<glm::vec3> GenerateRotationNoise(bool blue, int size) {
+    return blue ? SampleSets::BlueNoiseRotations(size) : SampleSets::WhiteNoise(4);
+}
+
+// lado del box de ssao_blur.frag para una textura de ruido de noiseSide x noiseSide. Hasta 4x4 el box cubre
+// un periodo entero y el promedio cancela el patron; una textura mas grande es blue noise (sin bajas
+// frecuencias), que se limpia con un 3x3 centrado: un box del tamanio del periodo borraria la oclusion
+int BlurSize(int noiseSide) {
+    return noiseSide <= 4 ? noiseSide : 3;
+}
+
+// despierta al hilo que espera el traspaso (con el lock, asi no se pierde entre su chequeo y su wait)
+void NotifyHandoff()
+{
+    std::lock_guard<std::mutex> lock(handoffMutex);
+    handoff.notify_all();
+}
+
+void RunOnRender(const std::function<void()>& command)
+{
+    std::lock_guard<std::mutex> lock(renderCommandsMutex);
+    renderCommands.push_back(command);
+}
+
+ModelImporter importerFor(const std::string& model)
+{
+    auto found = modelImporters.find(model);
+    return found != modelImporters.end() ? found->second : defaultImporter;
+}
+
+bool meshCacheFor(const std::string& model)
+{
+    return Model::UseMeshCache || std::find(meshCacheModels.begin(), meshCacheModels.end(), model) != meshCacheModels.end();
+}
+
+// "assimp" cambia el de todos los modelos, "suzanne=assimp" el de uno solo
+bool parseImporter(const std::string& arg)
+{
+    size_t equals = arg.find('=');
+    std::string mode = equals == std::string::npos ? arg : arg.substr(equals + 1);
+    ModelImporter importer;
+    if (mode == "auto")
+        importer = ModelImporter::Auto;
+    else if (mode == "assimp")
+        importer = ModelImporter::Assimp;
+    else if (mode == "obj")
+        importer = ModelImporter::Obj;
+    else
+        return false;
+    if (equals == std::string::npos)
+        defaultImporter = importer;
+    else
+        modelImporters[arg.substr(0, equals)] = importer;
+    return true;
+}
+
+// features de cada pase segun los flags (el mismo orden siempre: es la clave de la permutacion)
+ShaderDefines GBufferDefines(bool octahedral)
+{
+    return ShaderDefines().Flag("NORMAL_OCT", octahedral);
+}
+
+ShaderDefines SSAODefines(bool octahedral, int kernelSize, bool smooth, bool adaptive)
+{
+    return GBufferDefines(octahedral).Set("KERNEL_SIZE", kernelSize).Flag("SMOOTH", smooth).Flag("ADAPTIVE", adaptive);
+}
+
+ShaderDefines TileDefines(bool octahedral, int kernelSize)
+{
+    return GBufferDefines(octahedral).Set("KERNEL_SIZE", kernelSize);
+}
+
+ShaderDefines LightingDefines(bool octahedral, int debugView, bool ssao, bool baked)
+{
+    return GBufferDefines(octahedral).Set("DEBUG_VIEW", debugView).Flag("USE_SSAO", ssao).Flag("BAKED_AO", baked);
+}
+
+PassPrograms::PassPrograms(int kernel)
+    : Samples(GenerateSamples(64, kernel)), Kernel(kernel),
+      GeometryPasses("gbuffer.vert", "gbuffer.frag"),
+      SSAOPasses("quad.vert", "ssao.frag", [this](Shader& shader) {
+          shader.setInt("gPosition", 0);
+          shader.setInt("gNormal", 1);
+          shader.setInt("texNoise", 2);
+          shader.setInt("tileBudget", 3);
+          // las que no entran en KERNEL_SIZE no tienen location y se ignoran
+          for (unsigned int i = 0; i < Samples.size(); ++i)
+              shader.setVec3("samples[" + std::to_string(i) + "]", Samples[i]);
+      }),
+      SSAOTilePasses("quad.vert", "ssao_tiles.frag", [this](Shader& shader) {
+          shader.setInt("gPosition", 0);
+          shader.setInt("gNormal", 1);
+          for (unsigned int i = 0; i < Samples.size(); ++i)
+              shader.setVec3("samples[" + std::to_string(i) + "]", Samples[i]);
+      }),
+      // lighting pass y vistas de debug (gPos, gNormal, gColor, oclusion)
+      LightingPasses("quad.vert", "lighting.frag", [](Shader& shader) {
+          shader.setInt("gPosition", 0);
+          shader.setInt("gNormal", 1);
+          shader.setInt("gAlbedo", 2);
+          shader.setInt("ssao", 3);
+      }),
+      SSAOBlur("quad.vert", "ssao_blur.frag")
+{
+    SSAOBlur.use();
+    SSAOBlur.setInt("ssaoInput", 0);
+}
+
+void PassPrograms::SetKernel(const std::vector<glm::vec3>& samples, int kernel)
+{
+    Samples = samples;
+    Kernel = kernel;
+    SSAOPasses.Refresh();
+    SSAOTilePasses.Refresh();
+}
+
+void PassPrograms::Precompile(bool octahedral)
+{
+    GeometryPasses.Get(GBufferDefines(octahedral));
+    for (int kernelSize = 8; kernelSize <= 64; kernelSize *= 2) {
+        for (int mode = 0; mode < 4; ++mode)
+            SSAOPasses.Get(SSAODefines(octahedral, kernelSize, (mode & 1) != 0, (mode & 2) != 0));
+        SSAOTilePasses.Get(TileDefines(octahedral, kernelSize));
+    }
+    LightingPasses.Precompile({ LightingDefines(octahedral, 0, false, false), LightingDefines(octahedral, 0, true, false),
+        LightingDefines(octahedral, 0, false, true), LightingDefines(octahedral, 1, false, false), LightingDefines(octahedral, 2, false, false),
+        LightingDefines(octahedral, 3, false, false), LightingDefines(octahedral, 4, false, false), LightingDefines(octahedral, 4, false, true) });
+}
+
+size_t PassPrograms::Count() const
+{
+    return GeometryPasses.Count() + SSAOPasses.Count() + SSAOTilePasses.Count() + LightingPasses.Count();
+}
+
+RenderResources::RenderResources(PassPrograms& programs, Scene& world, int grid)
+    : Programs(programs), DepthPrepass("depth_prepass.vert", "depth_prepass.frag"), World(world), PrepassGrid(grid)
+{
+    // vectores rotacion y textura (la imagen se sube en el primer frame)
+    glGenTextures(1, &NoiseTexture);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, NoiseTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+// hornea la AO de un modelo y la guarda junto al .obj
+void BakeModel(AOBaker& baker, Model& model)
+{
+    // el baker necesita los vertices en RAM: si se liberaron se leen de la GPU solo para el bake
+    bool restored = !model.HasCpuData();
+    model.RestoreCpuData();
+    std::vector<std::vector<float>> ao = baker.Bake(model);
+    if (restored)
+        model.ReleaseCpuData();
+    model.SetBakedAO(ao);
+    bool saved = model.SaveBakedAO(model.BakedAOPath(), ao);
+    std::cout << "Baked AO " << model.BakedAOPath() << ": " << baker.Vertices << " vertices, " << baker.Triangles << " triangles, "
+              << baker.Rays << " rays, " << baker.Seconds << " s" << (saved ? "" : " (not saved)") << std::endl;
+}
+
+// cobertura: el stencil de gDepth tiene 1 donde hay geometria. Los pases de pantalla completa lo pegan como
+// depth/stencil de su framebuffer y solo corren ahi; el fondo queda con el clear
+void TestCoverage(bool coverage)
+{
+    GLState& glState = GLState::Get();
+    glState.Enable(GL_STENCIL_TEST, coverage);
+    if (coverage) {
+        glState.StencilFunc(GL_EQUAL, 1, 0xFF);
+        glState.StencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    }
+}
+
+// memoria por recurso del lado de render, separada en CPU y GPU (la usa la interfaz, que le suma la
+// escena; --memory-report la imprime al arrancar)
+MemoryReport QueryMemory(RenderResources& r)
+{
+    MemoryReport report;
+    for (size_t m = 0; m < r.World.Models.size(); ++m)
+        r.World.Models[m]->Memory(report, models[m]);
+    report.Add("Scene", "instance buffer", r.World.BufferMemory());
+    report.Add("Scene", "occlusion culling", r.Occlusion.Memory());
+    report.Add("Scene", "light clusters", r.Clusters.Memory());
+    r.Graph.Memory(report);
+    report.Add("Textures", "rotation noise", MemoryUsage(0, (size_t)r.BuiltNoise * r.BuiltNoise * 4 * sizeof(float)));
+    report.Add("Capture", "PBO ring + encoder queue", r.Capture.Memory());
+    return report;
+}
+
+// el hilo de render: toma el paquete mas nuevo, lo dibuja y presenta, hasta renderQuit
+void RenderLoop(GLFWwindow* window, RenderResources& r)
+{
+    glfwMakeContextCurrent(window);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(handoffMutex);
+            handoff.wait(lock, [] { return framePackets.Pending() || renderQuit.load(); });
+        }
+        if (!framePackets.Acquire())
+            break;      // renderQuit y no queda nada por dibujar
+        FramePacket& frame = framePackets.Read();
+        acquiredFrame = frame.Frame + 1;
+        NotifyHandoff();
+        RenderFrame(r, frame);
+
+        // glfw: swap buffers
+        glfwSwapBuffers(window);
+    }
+    glfwMakeContextCurrent(NULL);
+}
+
+// un frame: los pases del frame graph con los parametros y la DrawList del paquete, y la interfaz
+void RenderFrame(RenderResources& r, FramePacket& frame)
+{
+    double renderStart = glfwGetTime();
+
+    // pedidos de la interfaz que necesitan GL
+    std::vector<std::function<void()>> commands;
+    {
+        std::lock_guard<std::mutex> lock(renderCommandsMutex);
+        commands.swap(renderCommands);
+    }
+    for (const std::function<void()>& command : commands)
+        command();
+
+    FrameSetup f = SetupFrame(r, frame);
+    frameTimer.Begin();
+    UploadScene(r, frame);
+
+    // render
+    // ------
+    // (la ventana no se limpia: el lighting pass o el upscale la cubren entera)
+    if (r.Cache.Dirty(FrameCache::GEOMETRY))
+        AddGeometryPass(r, frame, f);
+
+    // ---------- SSAO ----------
+    bool computeAO = r.Cache.Dirty(FrameCache::AO);
+    if (computeAO && frame.Adaptive)
+        AddSSAOTilesPass(r, frame, f);
+    if (computeAO)
+        AddSSAOPass(r, frame, f);
+    if (computeAO && frame.Blur)
+        AddBlurPass(r, f);
+    // ----------      ----------
+
+    if (r.Cache.Dirty(FrameCache::LIGHTING))
+        AddLightingPass(r, frame, f);
+    if (f.Upscale)
+        AddUpscalePass(r, f);
+    if (frame.CaptureRecord || captureOnce) {
+        AddCapturePass(r, frame, f);
+        captureOnce = false;
+    }
+    if (snapshotOnce) {
+        AddSnapshotPass(r, frame, f);
+        snapshotOnce = false;
+    }
+
+    GLState& glState = GLState::Get();
+    r.Graph.Compile();
+    r.Graph.Execute();
+    r.Capture.Update();
+    glState.Viewport(0, 0, f.Width, f.Height);
+    frameTimer.End();
+
+    // interfaz: las listas que armo el update (el backend de ImGui restaura lo que cambia, asi que la cache sigue valida)
+    if (ImDrawData* ui = frame.Ui.Data())
+        ImGui_ImplOpenGL3_RenderDrawData(ui);
+    glState.EndFrame();
+
+    PublishStats(r, frame, f, renderStart);
+}
+
+// resolucion, kernel, ruido, permutaciones y firmas del render incremental de este frame, y los targets que
+// pide al frame graph
+FrameSetup SetupFrame(RenderResources& r, const FramePacket& frame)
+{
+    FrameSetup f;
+
+    // resolucion interna: los targets siguen a la ventana y el controlador decide que fraccion usar
+    // (en un replay la escala sale del trace: depende de tiempos de GPU que no se repiten)
+    dynamicResolution.Enabled = frame.DynamicResolution;
+    dynamicResolution.TargetMs = frame.TargetMs;
+    if (frame.ReplayScale > 0.0f) {
+        dynamicResolution.Scale = frame.ReplayScale;
+        dynamicResolution.SampleScale = frame.ReplaySampleScale;
+    }
+    else if (!frame.Incremental || r.Cache.Dirty(FrameCache::GEOMETRY)) {
+        // un frame reusado casi no mide nada: el controlador solo mira los que rehicieron la escena (si no, subiria
+        // la escala, eso rehace todo, la baja de nuevo...)
+        dynamicResolution.Update(frameTimer.LastMs);
+    }
+
+    // kernel y ruido de rotacion: se regeneran si cambiaron (desde la interfaz o el replay)
+    if (r.Programs.Kernel != frame.Kernel)
+        r.Programs.SetKernel(GenerateSamples(64, frame.Kernel), frame.Kernel);
+    if (r.BuiltNoise != (frame.BlueNoise ? frame.NoiseSize : 4)) {
+        std::vector<glm::vec3> rotationNoise = GenerateRotationNoise(frame.BlueNoise, frame.NoiseSize);
+        r.BuiltNoise = frame.BlueNoise ? frame.NoiseSize : 4;
+        GLState::Get().BindTexture(GL_TEXTURE_2D, r.NoiseTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, r.BuiltNoise, r.BuiltNoise, 0, GL_RGB, GL_FLOAT, &rotationNoise[0]);
+    }
+    f.Width = frame.Width;
+    f.Height = frame.Height;
+    f.RenderSize = dynamicResolution.InternalSize(f.Width, f.Height);
+    f.UVScale = glm::vec2((float)f.RenderSize.x / f.Width, (float)f.RenderSize.y / f.Height);
+
+    // permutaciones de este frame: el kernel se redondea a 8, 16, 32 o 64 muestras
+    f.Samples = dynamicResolution.Samples(frame.Samples);
+    while (f.KernelSize < f.Samples)
+        f.KernelSize *= 2;
+    f.UseSSAO = frame.SSAO && !frame.BakedAO;
+    f.DebugView = frame.DebugView;
+    PassPrograms& programs = r.Programs;
+    f.GeometryPass = &programs.GeometryPasses.Get(GBufferDefines(frame.NormalOct));
+    f.SSAOPass = &programs.SSAOPasses.Get(SSAODefines(frame.NormalOct, f.KernelSize, frame.Smooth, frame.Adaptive));
+    f.SSAOTiles = &programs.SSAOTilePasses.Get(TileDefines(frame.NormalOct, f.KernelSize));
+    f.LightingPass = &programs.LightingPasses.Get(LightingDefines(frame.NormalOct, f.DebugView, f.UseSSAO, frame.BakedAO));
+
+    // render incremental: firmas de lo que afecta a cada etapa. Con la camara y la escena quietas el g-buffer y la
+    // oclusion son identicos a los del frame anterior (quedan en texturas persistentes del grafo) y solo se
+    // rehace lo que cambio; lo que solo toca la iluminacion no rehace la oclusion
+    f.Coverage = frame.Coverage;
+    f.Incremental = frame.Incremental;
+    bool needAO = f.UseSSAO || (f.DebugView == 4 && !frame.BakedAO);
+    FrameCache::Key geometryKey, aoKey, lightingKey;
+    geometryKey.Add(f.Width).Add(f.Height).Add(f.RenderSize.x).Add(f.RenderSize.y).Add(frame.View).Add(frame.Projection)
+        .Add(frame.Model).Add(frame.Grid).Add(frame.ModelAngle).Add(frame.NormalOct).Add(f.Coverage);
+    aoKey.Add(needAO).Add(f.Samples).Add(frame.Smooth).Add(frame.Adaptive).Add(frame.MinSamples).Add(frame.Radius)
+        .Add(frame.Bias).Add(frame.Intensity).Add(frame.Kernel).Add(frame.BlueNoise).Add(r.BuiltNoise).Add(frame.Blur);
+    lightingKey.Add(f.DebugView).Add(f.UseSSAO).Add(frame.BakedAO).Add(frame.ExtraLights);
+    r.Cache.Update(f.Incremental, geometryKey, aoKey, lightingKey);
+
+    // ---------- frame graph ----------
+    // los targets se piden del tamanio de la ventana; la resolucion interna usa la esquina inferior izquierda,
+    // asi cambiar la escala no obliga a realocar nada. Con render incremental solo son persistentes las salidas que
+    // un frame siguiente puede reusar sin rehacerlas: el g-buffer, la oclusion final y sceneColor. Los intermedios
+    // (el SSAO sin blur cuando hay blur, el presupuesto de los tiles) son transitorios y van al pool del grafo
+    FrameGraph& graph = r.Graph;
+    graph.Reset();
+    auto target = [&graph, &f](const std::string& name, const FrameGraph::TextureDesc& desc, bool reused = true) {
+        return f.Incremental && reused ? graph.Persistent(name, desc) : graph.Create(name, desc);
+    };
+    int w = f.Width, h = f.Height;
+    f.GPosition = target("gPosition", FrameGraph::TextureDesc(w, h, GL_RGBA16F, GL_RGBA, GL_FLOAT));
+    f.GNormal = target("gNormal", frame.NormalOct ? FrameGraph::TextureDesc(w, h, GL_RG16F, GL_RG, GL_FLOAT)
+                                                  : FrameGraph::TextureDesc(w, h, GL_RGBA16F, GL_RGBA, GL_FLOAT));
+    f.GAlbedo = target("gAlbedo", FrameGraph::TextureDesc(w, h, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE));
+    f.GDepth = target("gDepth", FrameGraph::TextureDesc(w, h, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8));
+    f.TileBudget = graph.Create("ssaoTileBudget",
+        FrameGraph::TextureDesc((w + SSAO_TILE - 1) / SSAO_TILE, (h + SSAO_TILE - 1) / SSAO_TILE, GL_R8, GL_RED, GL_UNSIGNED_BYTE));
+    f.SSAORaw = target("ssao", FrameGraph::TextureDesc(w, h, GL_R8, GL_RED, GL_UNSIGNED_BYTE), !frame.Blur);
+    f.SSAOBlurred = target("ssaoBlur", FrameGraph::TextureDesc(w, h, GL_R8, GL_RED, GL_UNSIGNED_BYTE), frame.Blur);
+    f.SceneColor = target("sceneColor", FrameGraph::TextureDesc(w, h, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR));
+    f.Noise = graph.Import("noise", r.NoiseTexture);
+    f.Backbuffer = graph.Backbuffer();
+    f.Occlusion = frame.Blur ? f.SSAOBlurred : f.SSAORaw;
+    // a resolucion completa el lighting pass dibuja directo en la ventana; si no, en sceneColor y despues se escala
+    // (con cobertura tambien: el stencil de gDepth no se puede pegar al framebuffer de la ventana; y con render
+    // incremental, porque la ventana se recompone cada frame desde sceneColor aunque no se rehaga nada)
+    f.Upscale = f.RenderSize.x != w || f.RenderSize.y != h || f.Coverage || f.Incremental;
+    // las luces extra se reparten sobre la extension de la grilla
+    const Scene& scene = r.World;
+    f.LightsExtent = 0.5f * frame.Grid * 2.5f * scene.Models[frame.Model]->BoundsRadius() * scene.ModelScale[frame.Model];
+    return f;
+}
+
+// escena: instancias visibles que armo el update (se suben solo si hay que rehacer el g-buffer)
+void UploadScene(RenderResources& r, const FramePacket& frame)
+{
+    if (r.PrepassGrid != frame.Grid) {
+        depthPrepass.Reset();   // las mediciones dependen de la escena
+        r.PrepassGrid = frame.Grid;
+    }
+    depthPrepass.Mode = frame.DepthPrepass;
+    r.Occlusion.Enabled = frame.OcclusionCulling;
+    if (r.Cache.Dirty(FrameCache::GEOMETRY)) {
+        r.World.Upload(frame.Draws);
+        if (r.Occlusion.Enabled)
+            r.Occlusion.Early(r.World, frame.Draws);
+    }
+}
+
+// 1. geometry pass: render scene's geometry/color data into gbuffer
+// -----------------------------------------------------------------
+void AddGeometryPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f)
+{
+    r.Graph.AddPass("geometry", [&f](FrameGraph::PassBuilder& pass) {
+        pass.Write(f.GPosition);
+        pass.Write(f.GNormal);
+        pass.Write(f.GAlbedo);
+        pass.Write(f.GDepth);
+    }, [&r, &frame, &f](FrameGraph& graph) {
+        GLState& glState = GLState::Get();
+        glState.Viewport(0, 0, f.RenderSize.x, f.RenderSize.y);
+        glState.Enable(GL_DEPTH_TEST, true);
+        glState.StencilMask(0xFF);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glClearBufferfv(GL_COLOR, 0, GBUFFER_BACKGROUND);     // el fondo de gPosition no depende del clear color
+        // todo lo que pasa el depth test marca su pixel (tambien el pre-pass y la fase tardia del occlusion culling)
+        glState.Enable(GL_STENCIL_TEST, f.Coverage);
+        if (f.Coverage) {
+            glState.StencilFunc(GL_ALWAYS, 1, 0xFF);
+            glState.StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        }
+
+        bool prepass = depthPrepass.Use(frame.Model);
+        geometryTimer.Begin(DepthPrepassAdvisor::Tag(frame.Model, prepass));
+        auto drawGeometry = [&r, &frame, &f, &glState, prepass](unsigned int instanceBuffer) {
+            // depth pre-pass: solo posiciones, sin color; despues el g-buffer escribe cada pixel una vez
+            if (prepass) {
+                r.DepthPrepass.use();
+                r.DepthPrepass.setMat4("projection", frame.Projection);
+                r.DepthPrepass.setMat4("view", frame.View);
+                glState.ColorMask(false);
+                r.World.Draw(frame.Draws, r.DepthPrepass, true, instanceBuffer);
+                glState.ColorMask(true);
+                glState.DepthFunc(GL_EQUAL);
+                glState.DepthMask(false);
+            }
+            Shader& shader = *f.GeometryPass;
+            shader.use();
+            shader.setMat4("projection", frame.Projection);
+            shader.setMat4("view", frame.View);
+            r.World.Draw(frame.Draws, shader, false, instanceBuffer);
+            if (prepass) {
+                glState.DepthFunc(GL_LESS);
+                glState.DepthMask(true);
+            }
+        };
+        if (!r.Occlusion.Enabled) {
+            drawGeometry(0);
+        }
+        else {
+            // occlusion culling: lo visible el frame anterior, Hi-Z de eso y lo que aparecio detras
+            drawGeometry(r.Occlusion.EarlyBuffer());
+            r.Occlusion.Late(r.World, graph.Texture(f.GDepth), glm::ivec2(f.Width, f.Height), f.RenderSize, frame.View, frame.Projection, 0.1f);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, graph.Framebuffer({ f.GPosition, f.GNormal, f.GAlbedo, f.GDepth }));
+            glState.Viewport(0, 0, f.RenderSize.x, f.RenderSize.y);
+            glState.Enable(GL_DEPTH_TEST, true);
+            drawGeometry(r.Occlusion.LateBuffer());
+        }
+        geometryTimer.End();
+        glState.Enable(GL_STENCIL_TEST, false);
+        if (geometryTimer.Resolved())
+            depthPrepass.Record(geometryTimer.LastTag, geometryTimer.LastMs);
+    });
+}
+
+// SSAO adaptativo: primero un pase barato por tiles de 8x8 que decide cuantas muestras necesita cada uno
+void AddSSAOTilesPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f)
+{
+    r.Graph.AddPass("ssao tiles", [&f](FrameGraph::PassBuilder& pass) {
+        pass.Read(f.GPosition);
+        pass.Read(f.GNormal);
+        pass.Write(f.TileBudget);
+    }, [&frame, &f](FrameGraph& graph) {
+        GLState& glState = GLState::Get();
+        glState.Viewport(0, 0, (f.RenderSize.x + SSAO_TILE - 1) / SSAO_TILE, (f.RenderSize.y + SSAO_TILE - 1) / SSAO_TILE);
+        glState.Enable(GL_DEPTH_TEST, false);
+        glState.Enable(GL_STENCIL_TEST, false);     // un texel por tile: no hay stencil de ese tamanio
+        Shader& shader = *f.SSAOTiles;
+        shader.use();
+        shader.setInt("coarseSamples", std::min(frame.MinSamples, f.Samples));
+        shader.setFloat("radius", frame.Radius);
+        shader.setFloat("bias", frame.Bias);
+        shader.setVec2("uvScale", f.UVScale);
+        shader.setMat4("projection", frame.Projection);
+        glState.BindTexture(0, GL_TEXTURE_2D, graph.Texture(f.GPosition));
+        glState.BindTexture(1, GL_TEXTURE_2D, graph.Texture(f.GNormal));
+        renderQuad();
+    });
+}
+
+// mandar la informacion del gBuffer al SSAO framebuffer para calcular la oclusion
+void AddSSAOPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f)
+{
+    int noiseSide = r.BuiltNoise;
+    r.Graph.AddPass("ssao", [&frame, &f](FrameGraph::PassBuilder& pass) {
+        pass.Read(f.GPosition);
+        pass.Read(f.GNormal);
+        pass.Read(f.Noise);
+        if (frame.Adaptive)
+            pass.Read(f.TileBudget);
+        if (f.Coverage)
+            pass.DepthStencil(f.GDepth);
+        pass.Write(f.SSAORaw);
+    }, [&frame, &f, noiseSide](FrameGraph& graph) {
+        GLState& glState = GLState::Get();
+        glState.Viewport(0, 0, f.RenderSize.x, f.RenderSize.y);
+        glState.Enable(GL_DEPTH_TEST, false);
+        // el fondo sin oclusion (el blur lo promedia con los bordes de la geometria)
+        glClearBufferfv(GL_COLOR, 0, UNOCCLUDED);
+        TestCoverage(f.Coverage);
+        Shader& shader = *f.SSAOPass;
+        shader.use();
+        shader.setInt("samplesNum", f.Samples);
+        shader.setFloat("radius", frame.Radius);
+        shader.setFloat("bias", frame.Bias);
+        shader.setFloat("intensity", frame.Intensity);
+        shader.setVec2("noiseScale", (float)f.Width / noiseSide, (float)f.Height / noiseSide);
+        shader.setVec2("uvScale", f.UVScale);
+        shader.setInt("minSamples", frame.MinSamples);
+        shader.setMat4("projection", frame.Projection);
+        glState.BindTexture(0, GL_TEXTURE_2D, graph.Texture(f.GPosition));
+        glState.BindTexture(1, GL_TEXTURE_2D, graph.Texture(f.GNormal));
+        glState.BindTexture(2, GL_TEXTURE_2D, graph.Texture(f.Noise));
+        glState.BindTexture(3, GL_TEXTURE_2D, graph.Texture(f.TileBudget));
+        renderQuad();
+    });
+}
+
+// blur opcional: promedia el patron del ruido de rotacion
+void AddBlurPass(RenderResources& r, const FrameSetup& f)
+{
+    Shader& shader = r.Programs.SSAOBlur;
+    int blurSize = BlurSize(r.BuiltNoise);
+    r.Graph.AddPass("ssao blur", [&f](FrameGraph::PassBuilder& pass) {
+        pass.Read(f.SSAORaw);
+        if (f.Coverage)
+            pass.DepthStencil(f.GDepth);
+        pass.Write(f.SSAOBlurred);
+    }, [&f, &shader, blurSize](FrameGraph& graph) {
+        GLState& glState = GLState::Get();
+        glState.Viewport(0, 0, f.RenderSize.x, f.RenderSize.y);
+        glState.Enable(GL_DEPTH_TEST, false);
+        if (f.Coverage)
+            glClearBufferfv(GL_COLOR, 0, UNOCCLUDED);
+        TestCoverage(f.Coverage);
+        shader.use();
+        shader.setVec2("uvScale", f.UVScale);
+        shader.setInt("blurSize", blurSize);
+        glState.BindTexture(0, GL_TEXTURE_2D, graph.Texture(f.SSAORaw));
+        renderQuad();
+    });
+}
+
+// 2. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content.
+// -----------------------------------------------------------------------------------------------------------------------
+// (o una de las vistas de debug: cada una lee solo lo que muestra y el grafo descarta el resto)
+void AddLightingPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f)
+{
+    r.Graph.AddPass(f.DebugView == 0 ? "lighting" : "debug view", [&frame, &f](FrameGraph::PassBuilder& pass) {
+        int debugView = f.DebugView;
+        if (debugView == 0 || debugView == 1)
+            pass.Read(f.GPosition);
+        if (debugView == 0 || debugView == 2)
+            pass.Read(f.GNormal);
+        if (debugView == 0 || debugView == 3 || (debugView == 4 && frame.BakedAO))
+            pass.Read(f.GAlbedo);
+        if (f.UseSSAO || (debugView == 4 && !frame.BakedAO))
+            pass.Read(f.Occlusion);
+        if (f.Coverage)
+            pass.DepthStencil(f.GDepth);
+        pass.Write(f.Upscale ? f.SceneColor : f.Backbuffer);
+    }, [&r, &frame, &f](FrameGraph& graph) {
+        // el quad cubre todo el rectangulo: sin depth test, y sin clear salvo el fondo con cobertura
+        GLState& glState = GLState::Get();
+        glState.Viewport(0, 0, f.RenderSize.x, f.RenderSize.y);
+        glState.Enable(GL_DEPTH_TEST, false);
+        if (f.Coverage)
+            glClear(GL_COLOR_BUFFER_BIT);
+        TestCoverage(f.Coverage);
+
+            // send light relevant uniforms
+        if (r.BuiltLights != frame.ExtraLights || r.BuiltLightsExtent != f.LightsExtent) {
+            BuildLights(r.Lights, frame.ExtraLights, f.LightsExtent);
+            r.BuiltLights = frame.ExtraLights;
+            r.BuiltLightsExtent = f.LightsExtent;
+        }
+        r.Clusters.Build(r.Lights, frame.View, frame.Projection, f.RenderSize.x, f.RenderSize.y);
+        r.Clusters.Upload();
+
+        Shader& shader = *f.LightingPass;
+        shader.use();
+        r.Clusters.Bind(shader, 4);
+        shader.setVec2("uvScale", f.UVScale);
+
+            // activar las texturas del gbuffer + ssao-buffer
+        glState.BindTexture(0, GL_TEXTURE_2D, graph.Texture(f.GPosition));
+        glState.BindTexture(1, GL_TEXTURE_2D, graph.Texture(f.GNormal));
+        glState.BindTexture(2, GL_TEXTURE_2D, graph.Texture(f.GAlbedo));
+        glState.BindTexture(3, GL_TEXTURE_2D, graph.Texture(f.Occlusion)); // add extra SSAO texture to lighting pass
+
+        // FINALMENTE renderizar el quad
+        renderQuad();
+        glState.Enable(GL_STENCIL_TEST, false);
+    });
+}
+
+// escalado de la resolucion interna a la ventana (o copia 1:1 cuando solo hace falta por la cobertura)
+void AddUpscalePass(RenderResources& r, const FrameSetup& f)
+{
+    r.Graph.AddPass("upscale", [&f](FrameGraph::PassBuilder& pass) {
+        pass.Read(f.SceneColor);
+        pass.Write(f.Backbuffer);
+    }, [&f](FrameGraph& graph) {
+        GLState& glState = GLState::Get();
+        glState.BindFramebuffer(GL_READ_FRAMEBUFFER, graph.Framebuffer({ f.SceneColor }));
+        glState.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, f.RenderSize.x, f.RenderSize.y, 0, 0, f.Width, f.Height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    });
+}
+
+// captura: copia el target elegido a un PBO; SideEffect hace que el grafo no la descarte (ni lo que lee)
+void AddCapturePass(RenderResources& r, const FramePacket& frame, const FrameSetup& f)
+{
+    static const char* captureNames[] = { "frame", "ao", "gPosition", "gNormal", "gAlbedo" };
+    FrameGraph::Resource captured[] = { f.Backbuffer, f.Occlusion, f.GPosition, f.GNormal, f.GAlbedo };
+    FrameGraph::Resource target = captured[frame.CaptureSource];
+    r.Graph.AddPass("capture", [target](FrameGraph::PassBuilder& pass) {
+        pass.Read(target);
+        pass.SideEffect();
+    }, [&r, &frame, &f, target](FrameGraph& graph) {
+        bool window = target == f.Backbuffer;
+        char path[64];
+        std::snprintf(path, sizeof(path), "captures/%s_%06d", captureNames[frame.CaptureSource], captureIndex++);
+        r.Capture.Read(graph.Framebuffer({ target }), GL_COLOR_ATTACHMENT0, window ? f.Width : f.RenderSize.x, window ? f.Height : f.RenderSize.y,
+            frame.CaptureSource == 1 ? 1 : 3, frame.CaptureSource == 2 || frame.CaptureSource == 3, (FrameCapture::Encoding)frame.CaptureEncoding, path);
+    });
+}
+
+// instantanea del g-buffer para --ssao-bench: lo que leen SSAO, blur y lighting, con los parametros de este frame.
+// La lectura es sincronica (frena el pipeline una vez)
+void AddSnapshotPass(RenderResources& r, const FramePacket& frame, const FrameSetup& f)
+{
+    r.Graph.AddPass("snapshot", [&f](FrameGraph::PassBuilder& pass) {
+        pass.Read(f.GPosition);
+        pass.Read(f.GNormal);
+        pass.Read(f.GAlbedo);
+        pass.Read(f.GDepth);
+        pass.Read(f.Noise);
+        pass.SideEffect();
+    }, [&r, &frame, &f](FrameGraph& graph) {
+        GBufferSnapshot snapshot;
+        snapshot.Width = f.RenderSize.x;
+        snapshot.Height = f.RenderSize.y;
+        snapshot.View = frame.View;
+        snapshot.Projection = frame.Projection;
+        snapshot.Samples = f.Samples;
+        snapshot.MinSamples = frame.MinSamples;
+        snapshot.Radius = frame.Radius;
+        snapshot.Bias = frame.Bias;
+        snapshot.Intensity = frame.Intensity;
+        snapshot.NormalOct = frame.NormalOct;
+        snapshot.Smooth = frame.Smooth;
+        snapshot.Adaptive = frame.Adaptive;
+        snapshot.Blur = frame.Blur;
+        snapshot.Coverage = f.Coverage;
+        snapshot.ExtraLights = frame.ExtraLights;
+        snapshot.LightsExtent = f.LightsExtent;
+        snapshot.NoiseSize = r.BuiltNoise;
+        snapshot.Kernel.assign(r.Programs.Samples.begin(), r.Programs.Samples.begin() + f.KernelSize);
+        snapshot.Read(graph.Framebuffer({ f.GPosition }), graph.Framebuffer({ f.GNormal }), graph.Framebuffer({ f.GAlbedo }),
+            graph.Framebuffer({ f.GDepth }), graph.Texture(f.Noise));
+        char path[64];
+        std::snprintf(path, sizeof(path), "captures/snapshot_%06d.gbs", snapshotIndex++);
+        std::cout << (snapshot.Write(path) ? "Wrote " : "Could not write ") << path << std::endl;
+    });
+}
+
+// lo que la interfaz y la sesion necesitan del render
+void PublishStats(RenderResources& r, const FramePacket& frame, const FrameSetup& f, double renderStart)
+{
+    GLState& glState = GLState::Get();
+    RenderStats& stats = renderStats.Write();
+    stats.GpuMs = frameTimer.LastMs;
+    stats.RenderScale = dynamicResolution.Scale;
+    stats.SampleScale = dynamicResolution.SampleScale;
+    stats.RenderWidth = f.RenderSize.x;
+    stats.RenderHeight = f.RenderSize.y;
+    stats.Samples = f.Samples;
+    stats.Passes = (int)r.Graph.ExecutedPasses.size();
+    stats.CulledPasses = (int)r.Graph.CulledPasses.size();
+    stats.VirtualTextures = r.Graph.VirtualTextures;
+    stats.PhysicalTextures = r.Graph.PhysicalTextures;
+    stats.PhysicalBytes = r.Graph.PhysicalBytes;
+    stats.PoolBytes = r.Graph.PoolBytes;
+    stats.LightIndices = r.Clusters.TotalIndices;
+    stats.MaxLightsPerCluster = r.Clusters.MaxPerCluster;
+    stats.PrepassMeasured = frame.Model < (int)depthPrepass.PerModel.size();
+    if (stats.PrepassMeasured) {
+        stats.PrepassMs[0] = depthPrepass.PerModel[frame.Model].Ms[0];
+        stats.PrepassMs[1] = depthPrepass.PerModel[frame.Model].Ms[1];
+        stats.PrepassFaster = depthPrepass.Faster(frame.Model);
+    }
+    stats.OcclusionVisible = r.Occlusion.Visible;
+    stats.OcclusionTested = r.Occlusion.Tested;
+    stats.CapturesWritten = r.Capture.Written.load();
+    stats.CapturesDropped = r.Capture.Dropped;
+    stats.CapturesPending = r.Capture.Pending();
+    stats.GlIssued = glState.LastIssued;
+    stats.GlFiltered = glState.LastFiltered;
+    stats.ShaderPermutations = r.Programs.Count();
+    for (int stage = 0; stage < FrameCache::STAGES; ++stage)
+        stats.StageRan[stage] = r.Cache.Dirty((FrameCache::Stage)stage);
+    stats.BakedModels.resize(r.World.Models.size());
+    for (size_t m = 0; m < r.World.Models.size(); ++m)
+        stats.BakedModels[m] = r.World.Models[m]->bakedAO;
+    stats.Memory = frame.MemoryReport ? QueryMemory(r) : MemoryReport();
+    stats.CpuMs = 1000.0f * (float)(glfwGetTime() - renderStart);
+    renderStats.Publish();
+}
+
+// camara en orbita (grados) alrededor de una esfera, a la distancia en que entra en el campo de vision
+void OrbitCamera(const glm::vec3& center, float radius, float fov, float aspect, float yaw, float pitch, glm::mat4& view, glm::mat4& projection)
+{
+    float distance = radius / std::sin(0.5f * glm::radians(fov) * std::min(aspect, 1.0f)) * 1.05f;
+    float a = glm::radians(yaw), e = glm::radians(pitch);
+    glm::vec3 eye = center + distance * glm::vec3(std::sin(a) * std::cos(e), std::sin(e), std::cos(a) * std::cos(e));
+    view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    projection = glm::perspective(glm::radians(fov), aspect, std::max(distance - 1.5f * radius, 0.01f), distance + 1.5f * radius);
+}
+
+// --import-bench [N]: compara Assimp con el cargador de OBJ propio sobre los modelos (no abre ventana)
+int RunImportBench(int repetitions)
+{
+    for (const std::string& model : models)
+        Model::BenchmarkImporters(FileSystem::getPath("models/" + model + "/" + model + ".obj"), repetitions, std::cout);
+    return 0;
+}
+
+// --cpu-gbuffer [lado]: el g-buffer del modelo 'index' con el rasterizador de CPU (utils/cpu_rasterizer.h), para
+// los nodos sin GPU: no crea ventana ni contexto. El modelo se lee con CpuModel (la cache de --mesh-cache o el
+// .obj, y la AO horneada del .ao). Informa el tiempo de cada etapa y guarda captures/cpu_<modelo>_gPosition.pfm,
+// _gNormal.pfm, _gAlbedo (rgb) y _gAO con el mismo contenido que tendrian los targets de GL
+int RunCpuGBuffer(int index, int size)
+{
+    const std::string& name = models[index];
+    CpuModel model;
+    if (!model.Load(FileSystem::getPath("models/" + name + "/" + name + ".obj"), meshCacheFor(name))) {
+        std::cout << "Could not load " << name << ": " << model.Error << std::endl;
+        return 1;
+    }
+
+    // una instancia en el origen con la escala de la escena (lo que arma BuildScene con grid 1)
+    float scale = modelScales[index];
+    InstanceData instance;
+    instance.Model = glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.Model)));
+    for (int c = 0; c < 3; ++c)
+        instance.NormalMatrix[c] = glm::vec4(normalMatrix[c], 0.0f);
+    std::vector<InstanceData> instances(1, instance);
+    glm::mat4 view, projection;
+    OrbitCamera(model.BoundsCenter() * scale, model.BoundsRadius() * scale, camera.Zoom, 1.0f, 30.0f, 17.0f, view, projection);
+
+    CpuRasterizer rasterizer;
+    rasterizer.OctahedralNormals = normalOct;
+    // la primera vuelta reserva los buffers
+    rasterizer.Render(model, instances, view, projection, size, size);
+    const int repetitions = 5;
+    double setup = 0.0, raster = 0.0, resolve = 0.0;
+    for (int r = 0; r < repetitions; ++r) {
+        rasterizer.Render(model, instances, view, projection, size, size);
+        setup += rasterizer.SetupMs / repetitions;
+        raster += rasterizer.RasterMs / repetitions;
+        resolve += rasterizer.ResolveMs / repetitions;
+    }
+
+    // FrameCapture::Write no usa GL: los pixeles ya estan en RAM
+    FrameCapture captures;
+    const CpuGBuffer& gbuffer = rasterizer.Target;
+    std::string path = "captures/cpu_" + name;
+    captures.Write(gbuffer.Position.data(), gbuffer.Width, gbuffer.Height, 3, true, FrameCapture::PFM, path + "_gPosition");
+    captures.Write(gbuffer.Normal.data(), gbuffer.Width, gbuffer.Height, 3, true, FrameCapture::PFM, path + "_gNormal");
+    size_t pixels = (size_t)gbuffer.Width * gbuffer.Height;
+    std::vector<unsigned char> albedo(pixels * 3), ao(pixels);
+    for (size_t p = 0; p < pixels; ++p) {
+        for (int c = 0; c < 3; ++c)
+            albedo[3 * p + c] = gbuffer.Albedo[4 * p + c];
+        ao[p] = gbuffer.Albedo[4 * p + 3];
+    }
+    captures.Write(albedo.data(), gbuffer.Width, gbuffer.Height, 3, false, FrameCapture::PNG, path + "_gAlbedo");
+    captures.Write(ao.data(), gbuffer.Width, gbuffer.Height, 1, false, FrameCapture::PNG, path + "_gAO");
+
+    bool baked = !model.Meshes.empty() && !model.Meshes[0].BakedAO.empty();
+    std::cout << name << (model.FromCache ? " (mesh cache)" : "") << (baked ? " with baked AO" : "") << ": " << size << "x"
+              << size << ", " << rasterizer.Triangles << " triangles (" << rasterizer.Rasterized << " after culling and clipping, "
+              << rasterizer.BinEntries << " tile entries), " << rasterizer.BlocksCulled << "/" << rasterizer.BlocksTested
+              << " blocks rejected | setup " << setup << " ms, raster " << raster << " ms, resolve " << resolve << " ms with "
+              << ThreadPool::Get().Size() << " threads" << std::endl;
+    return 0;
+}
+
+
+// --shard <workers> <frames> <dir> [lado]: coordinador de una secuencia offline repartida en procesos
+// (utils/render_shards.h). No abre ventana: solo reparte los frames y espera a los workers. La camara da una
+// vuelta al modelo actual (--model) con el SSAO por defecto; --sweep <radius|bias|intensity|samples> <desde>
+// <hasta> ademas varia ese parametro a lo largo de los frames. argv da los --importer para los workers
+int RunShardCoordinator(RenderShards& shards, int argc, char** argv)
+{
+    shards.Base.Model = models[currentModel];
+    shards.Base.Radius = ssaoRadius;
+    shards.Base.Bias = ssaoBias;
+    shards.Base.Intensity = ssaoIntensity;
+    shards.Base.Samples = samplesNum;
+    shards.Base.Blur = ssaoBlur;
+    // los workers mapean la cache de las mallas del modelo de la secuencia (solo la de ese), que se escribe
+    // aca una vez, sin GL, con el mismo ObjLoader que usarian ellos. Con Assimp la escribe el primer worker
+    shards.WorkerArgs.push_back("--mesh-cache");
+    shards.WorkerArgs.push_back(shards.Base.Model);
+    if (importerFor(shards.Base.Model) != ModelImporter::Assimp) {
+        CpuModel model;
+        std::string path = FileSystem::getPath("models/" + shards.Base.Model + "/" + shards.Base.Model + ".obj");
+        if (!model.Load(path, true))
+            std::cout << "Could not load " << shards.Base.Model << ": " << model.Error << std::endl;
+        else if (!model.SaveMeshCache())
+            std::cout << "Could not write " << MeshCache::Path(path) << std::endl;
+    }
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::string(argv[i]) == "--importer") {
+            shards.WorkerArgs.push_back(argv[i]);
+            shards.WorkerArgs.push_back(argv[i + 1]);
+        }
+    std::cout << "Rendering " << shards.Frames << " frames of " << shards.Base.Model << " with " << shards.Workers << " workers in "
+              << shards.Directory << std::endl;
+    return shards.Run(argv[0], std::cout) ? 0 : 1;
+}
+
+
+// --ssao-bench <archivo|dir> [iteraciones]: solo los pases de SSAO (tiles, SSAO, blur y lighting) sobre
+// instantaneas del g-buffer (utils/gbuffer_snapshot.h, se capturan con G), cada una con su kernel, ruido y
+// parametros: mide el cambio de un shader sin la escena, la camara ni el geometry pass de por medio. Informa
+// el tiempo de GPU de cada pase (mediana de las iteraciones) y guarda la oclusion de cada instantanea en
+// captures/bench_<nombre>_ao.png para comparar la imagen entre versiones. Solo se compilan (o se leen de la
+// cache) las permutaciones que piden las instantaneas
+int RunSSAOBench(PassPrograms& programs, const std::string& path, int iterations)
+{
+    GLState& glState = GLState::Get();
+    std::vector<PointLight> lights;
+    LightClusters lightClusters;
+    std::vector<std::string> files = GBufferSnapshot::List(path);
+    FrameCapture captures;
+    const int passes = 4;
+    const char* passNames[passes] = { "tiles", "ssao", "blur", "lighting" };
+    unsigned int queries[passes + 1];
+    glGenQueries(passes + 1, queries);
+    double medianSum = 0.0;
+    int benched = 0;
+    for (const std::string& file : files) {
+        GBufferSnapshot snapshot;
+        if (!snapshot.Open(file)) {
+            std::cout << "Could not read snapshot " << file << std::endl;
+            continue;
+        }
+        int w = snapshot.Width, h = snapshot.Height;
+
+        // el g-buffer y el ruido salen del mapeo; los targets de la oclusion y el color son del tamanio de la instantanea
+        double uploadStart = glfwGetTime();
+        unsigned int gPosition = snapshot.Upload(GBufferSnapshot::POSITION);
+        unsigned int gNormal = snapshot.Upload(GBufferSnapshot::NORMAL);
+        unsigned int gAlbedo = snapshot.Upload(GBufferSnapshot::ALBEDO);
+        unsigned int gDepth = snapshot.Upload(GBufferSnapshot::DEPTH);
+        unsigned int noise = snapshot.Upload(GBufferSnapshot::NOISE);
+        glFinish();
+        double uploadMs = (glfwGetTime() - uploadStart) * 1000.0;
+        auto target = [&glState](int tw, int th, GLenum internalFormat, GLenum format) {
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glState.BindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, tw, th, 0, format, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            return texture;
+        };
+        unsigned int tileBudget = target((w + SSAO_TILE - 1) / SSAO_TILE, (h + SSAO_TILE - 1) / SSAO_TILE, GL_R8, GL_RED);
+        unsigned int ssaoRaw = target(w, h, GL_R8, GL_RED), ssaoBlurred = target(w, h, GL_R8, GL_RED);
+        unsigned int sceneColor = target(w, h, GL_RGBA8, GL_RGBA);
+        // un framebuffer por pase; los de pantalla completa llevan gDepth para el test de cobertura
+        auto framebuffer = [&glState, gDepth](unsigned int color, bool depthStencil) {
+            unsigned int fbo;
+            glGenFramebuffers(1, &fbo);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+            if (depthStencil)
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "Bench framebuffer not complete!" << std::endl;
+            return fbo;
+        };
+        unsigned int fbos[passes] = { framebuffer(tileBudget, false), framebuffer(ssaoRaw, true), framebuffer(ssaoBlurred, true),
+                                      framebuffer(sceneColor, true) };
+
+        // el kernel de la instantanea en los programas (como cuando cambia desde la interfaz)
+        programs.SetKernel(snapshot.Kernel, -1);
+        Shader& ssaoShader = programs.SSAOPasses.Get(SSAODefines(snapshot.NormalOct, snapshot.KernelSize, snapshot.Smooth, snapshot.Adaptive));
+        Shader& tileShader = programs.SSAOTilePasses.Get(TileDefines(snapshot.NormalOct, snapshot.KernelSize));
+        Shader& lightingShader = programs.LightingPasses.Get(LightingDefines(snapshot.NormalOct, 0, true, false));
+        BuildLights(lights, snapshot.ExtraLights, snapshot.LightsExtent);
+        lightClusters.Build(lights, snapshot.View, snapshot.Projection, w, h);
+        lightClusters.Upload();
+
+        // los mismos pases que el frame (ver el loop de render), con un timestamp entre uno y otro
+        glm::vec2 uvScale(1.0f);
+        auto runPasses = [&]() {
+            glState.Enable(GL_DEPTH_TEST, false);
+            glQueryCounter(queries[0], GL_TIMESTAMP);
+            if (snapshot.Adaptive) {
+                glState.BindFramebuffer(GL_FRAMEBUFFER, fbos[0]);
+                glState.Viewport(0, 0, (w + SSAO_TILE - 1) / SSAO_TILE, (h + SSAO_TILE - 1) / SSAO_TILE);
+                glState.Enable(GL_STENCIL_TEST, false);
+                tileShader.use();
+                tileShader.setInt("coarseSamples", std::min(snapshot.MinSamples, snapshot.Samples));
+                tileShader.setFloat("radius", snapshot.Radius);
+                tileShader.setFloat("bias", snapshot.Bias);
+                tileShader.setVec2("uvScale", uvScale);
+                tileShader.setMat4("projection", snapshot.Projection);
+                glState.BindTexture(0, GL_TEXTURE_2D, gPosition);
+                glState.BindTexture(1, GL_TEXTURE_2D, gNormal);
+                renderQuad();
+            }
+            glQueryCounter(queries[1], GL_TIMESTAMP);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, fbos[1]);
+            glState.Viewport(0, 0, w, h);
+            glClearBufferfv(GL_COLOR, 0, UNOCCLUDED);
+            TestCoverage(snapshot.Coverage);
+            ssaoShader.use();
+            ssaoShader.setInt("samplesNum", snapshot.Samples);
+            ssaoShader.setFloat("radius", snapshot.Radius);
+            ssaoShader.setFloat("bias", snapshot.Bias);
+            ssaoShader.setFloat("intensity", snapshot.Intensity);
+            ssaoShader.setVec2("noiseScale", (float)w / snapshot.NoiseSize, (float)h / snapshot.NoiseSize);
+            ssaoShader.setVec2("uvScale", uvScale);
+            ssaoShader.setInt("minSamples", snapshot.MinSamples);
+            ssaoShader.setMat4("projection", snapshot.Projection);
+            glState.BindTexture(0, GL_TEXTURE_2D, gPosition);
+            glState.BindTexture(1, GL_TEXTURE_2D, gNormal);
+            glState.BindTexture(2, GL_TEXTURE_2D, noise);
+            glState.BindTexture(3, GL_TEXTURE_2D, tileBudget);
+            renderQuad();
+            glQueryCounter(queries[2], GL_TIMESTAMP);
+            if (snapshot.Blur) {
+                glState.BindFramebuffer(GL_FRAMEBUFFER, fbos[2]);
+                if (snapshot.Coverage)
+                    glClearBufferfv(GL_COLOR, 0, UNOCCLUDED);
+                TestCoverage(snapshot.Coverage);
+                programs.SSAOBlur.use();
+                programs.SSAOBlur.setVec2("uvScale", uvScale);
+                programs.SSAOBlur.setInt("blurSize", BlurSize(snapshot.NoiseSize));
+                glState.BindTexture(0, GL_TEXTURE_2D, ssaoRaw);
+                renderQuad();
+            }
+            glQueryCounter(queries[3], GL_TIMESTAMP);
+            glState.BindFramebuffer(GL_FRAMEBUFFER, fbos[3]);
+            if (snapshot.Coverage)
+                glClear(GL_COLOR_BUFFER_BIT);
+            TestCoverage(snapshot.Coverage);
+            lightingShader.use();
+            lightClusters.Bind(lightingShader, 4);
+            lightingShader.setVec2("uvScale", uvScale);
+            glState.BindTexture(0, GL_TEXTURE_2D, gPosition);
+            glState.BindTexture(1, GL_TEXTURE_2D, gNormal);
+            glState.BindTexture(2, GL_TEXTURE_2D, gAlbedo);
+            glState.BindTexture(3, GL_TEXTURE_2D, snapshot.Blur ? ssaoBlurred : ssaoRaw);
+            renderQuad();
+            glQueryCounter(queries[4], GL_TIMESTAMP);
+            glState.Enable(GL_STENCIL_TEST, false);
+        };
+
+        // la primera vuelta compila en el driver y llena caches
+        runPasses();
+        glFinish();
+        std::vector<double> passMs[passes], totalMs;
+        for (int r = 0; r < iterations; ++r) {
+            runPasses();
+            GLuint64 stamps[passes + 1];
+            for (int q = 0; q <= passes; ++q)
+                glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &stamps[q]);
+            for (int p = 0; p < passes; ++p)
+                passMs[p].push_back((stamps[p + 1] - stamps[p]) / 1.0e6);
+            totalMs.push_back((stamps[passes] - stamps[0]) / 1.0e6);
+        }
+        auto median = [](std::vector<double> values) {
+            std::sort(values.begin(), values.end());
+            return values[values.size() / 2];
+        };
+        double mean = 0.0;
+        for (double ms : totalMs)
+            mean += ms / totalMs.size();
+        std::string name = std::filesystem::path(file).stem().string();
+        std::cout << name << ": " << w << "x" << h << ", " << snapshot.Samples << " samples (kernel " << snapshot.KernelSize << ")"
+                  << (snapshot.Adaptive ? ", adaptive" : "") << (snapshot.Coverage ? ", coverage" : "") << " |";
+        for (int p = 0; p < passes; ++p)
+            std::cout << " " << passNames[p] << " " << median(passMs[p]) << " ms";
+        std::cout << " | total median " << median(totalMs) << " ms, min " << *std::min_element(totalMs.begin(), totalMs.end())
+                  << " ms, mean " << mean << " ms over " << iterations << " iterations (upload " << uploadMs << " ms)" << std::endl;
+        medianSum += median(totalMs);
+        ++benched;
+
+        captures.Read(fbos[snapshot.Blur ? 2 : 1], GL_COLOR_ATTACHMENT0, w, h, 1, false, FrameCapture::PNG, "captures/bench_" + name + "_ao");
+        captures.Flush();
+        unsigned int textures[] = { gPosition, gNormal, gAlbedo, gDepth, noise, tileBudget, ssaoRaw, ssaoBlurred, sceneColor };
+        glState.DeleteFramebuffers(passes, fbos);
+        glState.DeleteTextures(sizeof(textures) / sizeof(textures[0]), textures);
+    }
+    if (benched > 1)
+        std::cout << benched << " snapshots: " << medianSum << " ms (sum of the median totals)" << std::endl;
+    else if (benched == 0)
+        std::cout << "No snapshots in " << path << std::endl;
+    glDeleteQueries(passes + 1, queries);
+    captures.Clear();
+    return benched > 0 ? 0 : 1;
+}
+
+
+// modos por lotes, con la ventana oculta; los dos usan los targets en capas de utils/multi_view.h (g-buffer,
+// SSAO, blur y lighting de todas las vistas de un lote con un draw por pase):
+//  --turntable [vistas] [lado]: 'vistas' camaras alrededor de cada modelo; guarda cada vista en
+//      captures/turntable_<modelo>_<vista>.png y compara el tiempo con una vista por submit
+//  --serve <dir>: atiende los trabajos de render que aparecen en <dir> (ver utils/render_service.h) con los
+//      modelos y programas cargados entre uno y otro, hasta que exista <dir>/stop
+int RunBatch(Scene& scene, const std::vector<glm::vec3>& samples, int turntableViews, int turntableSize, const std::string& servicePath)
+{
+    ShaderPermutations batchGeometry("gbuffer.vert", "gbuffer.frag", MultiViewTargets::BindViews, "multiview_gbuffer.geom");
+    ShaderPermutations batchSSAO("quad.vert", "ssao.frag", [&samples](Shader& shader) {
+        shader.setInt("gPosition", 0);
+        shader.setInt("gNormal", 1);
+        shader.setInt("texNoise", 2);
+        for (unsigned int i = 0; i < samples.size(); ++i)
+            shader.setVec3("samples[" + std::to_string(i) + "]", samples[i]);
+        MultiViewTargets::BindViews(shader);
+    }, "multiview_quad.geom");
+    ShaderPermutations batchBlur("quad.vert", "ssao_blur.frag", [](Shader& shader) {
+        shader.setInt("ssaoInput", 0);
+        MultiViewTargets::BindViews(shader);
+    }, "multiview_quad.geom");
+    ShaderPermutations batchLighting("quad.vert", "lighting.frag", [](Shader& shader) {
+        shader.setInt("gPosition", 0);
+        shader.setInt("gNormal", 1);
+        shader.setInt("gAlbedo", 2);
+        shader.setInt("ssao", 3);
+        MultiViewTargets::BindViews(shader);
+    }, "multiview_quad.geom");
+    Shader& geometryShader = batchGeometry.Get(GBufferDefines(normalOct).Flag("MULTIVIEW"));
+    Shader& ssaoShader = batchSSAO.Get(SSAODefines(normalOct, 64, ssaoSmooth, false).Flag("MULTIVIEW"));
+    Shader& blurShader = batchBlur.Get(ShaderDefines().Flag("MULTIVIEW"));
+    Shader& lightingShader = batchLighting.Get(LightingDefines(normalOct, 0, !bakedAO, bakedAO).Flag("MULTIVIEW"));
+
+    // ruido de rotacion de la interfaz (no cambia durante el lote)
+    GLState& glState = GLState::Get();
+    std::vector<glm::vec3> rotationNoise = GenerateRotationNoise(blueNoise, noiseSize);
+    int builtNoise = blueNoise ? noiseSize : 4;
+    unsigned int noiseTexture;
+    glGenTextures(1, &noiseTexture);
+    glState.BindTexture(GL_TEXTURE_2D, noiseTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, builtNoise, builtNoise, 0, GL_RGB, GL_FLOAT, &rotationNoise[0]);
+
+    MultiViewTargets multiView;
+    FrameCapture captures(MultiViewTargets::MAX_VIEWS);
+    captures.MaxQueued = MultiViewTargets::MAX_VIEWS * 2;
+
+    // las primeras 'count' capas de multiView con las vistas que tiene cargadas y el SSAO de 'settings':
+    // cada pase es un solo draw. Con settings.AOOnly termina en la oclusion
+    auto renderViews = [&glState, &multiView, &geometryShader, &ssaoShader, &blurShader, &lightingShader, noiseTexture, builtNoise](Scene& batchScene, const Scene::DrawList& list, int count, const RenderJob& settings) {
+        int w = multiView.Width, h = multiView.Height;
+        glState.BindFramebuffer(GL_FRAMEBUFFER, multiView.GeometryFramebuffer());
+        glState.Viewport(0, 0, w, h);
+        glState.Enable(GL_DEPTH_TEST, true);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClearBufferfv(GL_COLOR, 0, GBUFFER_BACKGROUND);
+        geometryShader.use();
+        geometryShader.setInt("viewCount", count);
+        batchScene.Draw(list, geometryShader, false, 0, count);
+
+        glState.Enable(GL_DEPTH_TEST, false);
+        glState.BindFramebuffer(GL_FRAMEBUFFER, multiView.OcclusionFramebuffer(false));
+        ssaoShader.use();
+        ssaoShader.setInt("samplesNum", settings.Samples);
+        ssaoShader.setFloat("radius", settings.Radius);
+        ssaoShader.setFloat("bias", settings.Bias);
+        ssaoShader.setFloat("intensity", settings.Intensity);
+        ssaoShader.setVec2("noiseScale", (float)w / builtNoise, (float)h / builtNoise);
+        glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, multiView.Position());
+        glState.BindTexture(1, GL_TEXTURE_2D_ARRAY, multiView.Normal());
+        glState.BindTexture(2, GL_TEXTURE_2D, noiseTexture);
+        renderQuad(count);
+        if (settings.Blur) {
+            glState.BindFramebuffer(GL_FRAMEBUFFER, multiView.OcclusionFramebuffer(true));
+            blurShader.use();
+            blurShader.setInt("blurSize", BlurSize(builtNoise));
+            glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, multiView.Occlusion(false));
+            renderQuad(count);
+        }
+        if (settings.AOOnly)
+            return;
+
+        glState.BindFramebuffer(GL_FRAMEBUFFER, multiView.ColorFramebuffer());
+        lightingShader.use();
+        glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, multiView.Position());
+        glState.BindTexture(1, GL_TEXTURE_2D_ARRAY, multiView.Normal());
+        glState.BindTexture(2, GL_TEXTURE_2D_ARRAY, multiView.Albedo());
+        glState.BindTexture(3, GL_TEXTURE_2D_ARRAY, multiView.Occlusion(settings.Blur));
+        renderQuad(count);
+    };
+    // encola la lectura de la capa 'layer': el color, o la oclusion (1 canal) con settings.AOOnly
+    auto readLayer = [&multiView, &captures](int layer, const RenderJob& settings, const std::string& path) {
+        unsigned int source = settings.AOOnly ? multiView.Occlusion(settings.Blur) : multiView.Color();
+        return captures.Read(multiView.LayerFramebuffer(source, layer), GL_COLOR_ATTACHMENT0, multiView.Width, multiView.Height,
+            settings.AOOnly ? 1 : 3, false, FrameCapture::PNG, path);
+    };
+
+    Scene::DrawList list;
+    if (turntableViews > 0) {
+        // los parametros de SSAO de la interfaz
+        RenderJob settings;
+        settings.Radius = ssaoRadius;
+        settings.Bias = ssaoBias;
+        settings.Intensity = ssaoIntensity;
+        settings.Samples = samplesNum;
+        settings.Blur = ssaoBlur;
+        multiView.Resize(turntableSize, turntableSize, turntableViews, normalOct);
+        const int repetitions = 5;
+        for (size_t m = 0; m < scene.Models.size(); ++m) {
+            BuildScene(scene, (int)m, 1);
+            scene.UpdateTransforms();
+            scene.CullAll();
+            scene.Pack(list);
+            scene.Upload(list);
+
+            glm::vec3 center = scene.Models[m]->BoundsCenter() * scene.ModelScale[m];
+            float radius = scene.Models[m]->BoundsRadius() * scene.ModelScale[m];
+            std::vector<glm::mat4> views(turntableViews), projections(turntableViews);
+            for (int v = 0; v < turntableViews; ++v)
+                OrbitCamera(center, radius, camera.Zoom, 1.0f, 360.0f * v / turntableViews, 17.0f, views[v], projections[v]);
+
+            // una vista por submit (los mismos pases con count = 1) contra todas en un lote; la primera vuelta
+            // calienta drivers y caches
+            auto oneByOne = [&]() {
+                for (int v = 0; v < turntableViews; ++v) {
+                    multiView.SetViews({ views[v] }, { projections[v] });
+                    renderViews(scene, list, 1, settings);
+                }
+            };
+            auto batched = [&]() {
+                multiView.SetViews(views, projections);
+                renderViews(scene, list, turntableViews, settings);
+            };
+            double seconds[2] = { 0.0, 0.0 };
+            for (int mode = 0; mode < 2; ++mode) {
+                mode == 0 ? oneByOne() : batched();
+                glFinish();
+                double start = glfwGetTime();
+                for (int r = 0; r < repetitions; ++r)
+                    mode == 0 ? oneByOne() : batched();
+                glFinish();
+                seconds[mode] = (glfwGetTime() - start) / repetitions;
+            }
+
+            // el ultimo lote sigue en multiView: una lectura por capa
+            for (int v = 0; v < turntableViews; ++v) {
+                char path[256];
+                std::snprintf(path, sizeof(path), "captures/turntable_%s_%02d", models[m].c_str(), v);
+                readLayer(v, settings, path);
+            }
+            captures.Flush();
+            std::cout << models[m] << ": " << turntableViews << " views " << turntableSize << "x" << turntableSize
+                      << " | one per submit " << seconds[0] * 1000.0 << " ms (" << turntableViews / seconds[0] << " views/s)"
+                      << " | batched " << seconds[1] * 1000.0 << " ms (" << turntableViews / seconds[1] << " views/s)" << std::endl;
+        }
+    }
+    else {
+        RenderSpool spool(servicePath);
+        ModelCache modelCache;
+        Scene jobScene;     // un modelo y una instancia; las vistas del lote la rodean
+        std::cout << "Serving " << servicePath << " (create " << servicePath << "/stop to quit)" << std::endl;
+        using Clock = std::chrono::steady_clock;
+        auto ms = [](Clock::time_point from, Clock::time_point to) {
+            return std::chrono::duration<double, std::milli>(to - from).count();
+        };
+        while (!spool.StopRequested()) {
+            // de a un lote como mucho: si hay otros servicios en el directorio (--shard), se reparten el resto
+            std::vector<RenderJob> jobs = spool.Claim(MultiViewTargets::MAX_VIEWS);
+            if (jobs.empty()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                continue;
+            }
+            // lotes de trabajos compatibles (solo cambia la camara), hasta MAX_VIEWS cada uno
+            std::stable_sort(jobs.begin(), jobs.end(), [](const RenderJob& a, const RenderJob& b) { return a.BatchKey() < b.BatchKey(); });
+            for (size_t first = 0, last = 0; first < jobs.size(); first = last) {
+                last = first + 1;
+                while (last < jobs.size() && last - first < (size_t)MultiViewTargets::MAX_VIEWS && jobs[last].BatchKey() == jobs[first].BatchKey())
+                    ++last;
+                const RenderJob& settings = jobs[first];
+                int count = (int)(last - first);
+                Clock::time_point batchStart = Clock::now();
+
+                // modelo: uno de los del programa (con su escala base) o un archivo, de la cache
+                Model* model = nullptr;
+                float scale = settings.Scale;
+                for (size_t m = 0; m < models.size() && model == nullptr; ++m)
+                    if (models[m] == settings.Model) {
+                        model = scene.Models[m];
+                        scale *= scene.ModelScale[m];
+                    }
+                double loadMs = 0.0;
+                if (model == nullptr) {
+                    model = modelCache.Get(settings.Model, importerFor(settings.Model), keepMeshData);
+                    loadMs = modelCache.LastLoadSeconds * 1000.0;
+                }
+                if (model == nullptr) {
+                    for (size_t j = first; j < last; ++j)
+                        spool.Fail(jobs[j], "could not load model " + settings.Model);
+                    continue;
+                }
+                jobScene.Models.assign(1, model);
+                jobScene.ModelScale.assign(1, scale);
+                jobScene.ClearInstances();
+                jobScene.AddInstance(0, glm::vec3(0.0f));
+                jobScene.UpdateTransforms();
+                jobScene.CullAll();
+                jobScene.Pack(list);
+                jobScene.Upload(list);
+
+                glm::vec3 center = model->BoundsCenter() * scale;
+                float radius = model->BoundsRadius() * scale;
+                float aspect = (float)settings.Width / settings.Height;
+                std::vector<glm::mat4> views(count), projections(count);
+                for (int v = 0; v < count; ++v) {
+                    const RenderJob& job = jobs[first + v];
+                    if (job.ExplicitCamera) {
+                        views[v] = glm::lookAt(job.Eye, job.Target, glm::vec3(0.0f, 1.0f, 0.0f));
+                        projections[v] = glm::perspective(glm::radians(job.Fov), aspect, 0.1f, 50.0f);
+                    }
+                    else {
+                        OrbitCamera(center, radius, job.Fov, aspect, job.Yaw, job.Pitch, views[v], projections[v]);
+                    }
+                }
+
+                // los targets solo crecen: lotes mas chicos usan las primeras capas
+                multiView.Resize(settings.Width, settings.Height, count, normalOct);
+                glFinish();
+                Clock::time_point renderStart = Clock::now();
+                multiView.SetViews(views, projections);
+                renderViews(jobScene, list, count, settings);
+                glFinish();
+                Clock::time_point renderEnd = Clock::now();
+
+                unsigned long long failed = captures.Failed + captures.Dropped;
+                for (int v = 0; v < count; ++v)
+                    readLayer(v, jobs[first + v], spool.OutputPath(jobs[first + v]));
+                captures.Flush();
+                while (captures.Pending() > 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                Clock::time_point written = Clock::now();
+                bool ok = captures.Failed + captures.Dropped == failed;
+
+                for (size_t j = first; j < last; ++j) {
+                    if (!ok) {
+                        spool.Fail(jobs[j], "could not write the image");
+                        continue;
+                    }
+                    std::ostringstream metadata;
+                    metadata << "image " << jobs[j].Name << FrameCapture::Extension(FrameCapture::PNG) << "\n"
+                             << "size " << settings.Width << " " << settings.Height << "\n"
+                             << "batch " << count << "\n"
+                             << "wait_ms " << ms(jobs[j].Claimed, batchStart) << "\n"
+                             << "load_ms " << loadMs << "\n"
+                             << "render_ms " << ms(renderStart, renderEnd) / count << "\n"
+                             << "batch_render_ms " << ms(renderStart, renderEnd) << "\n"
+                             << "write_ms " << ms(renderEnd, written) << "\n"
+                             << "model_cache " << modelCache.Hits << " hits " << modelCache.Misses << " misses\n";
+                    spool.Complete(jobs[j], metadata.str());
+                }
+                std::cout << "Served " << count << " job(s) of " << settings.Model << " in " << ms(batchStart, written) << " ms" << std::endl;
+            }
+        }
+        modelCache.Clear();
+    }
+    captures.Clear();
+    multiView.Clear();
+    glDeleteTextures(1, &noiseTexture);
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+// Vistas en lote (utils/multi_view.h). Con MULTIVIEW los targets de entrada son arreglos 2D con una capa por
+// vista, Layer lo pone multiview_quad.geom y las matrices de cada vista vienen en el bloque Views (el mismo
+// que declara gbuffer.vert). Sin MULTIVIEW es un sampler2D comun.
+#ifdef MULTIVIEW
+#ifndef MAX_VIEWS
+#define MAX_VIEWS 32
+#endif
+layout (std140) uniform Views
+{
+    mat4 viewMatrices[MAX_VIEWS];
+    mat4 projectionMatrices[MAX_VIEWS];
+};
+flat in int Layer;
+
+#define GBUFFER_SAMPLER sampler2DArray
+vec4 gbufferTexture(sampler2DArray s, vec2 uv)
+{
+    return texture(s, vec3(uv, float(Layer)));
+}
+vec2 gbufferSize(sampler2DArray s)
+{
+    return vec2(textureSize(s, 0).xy);
+}
+#else
+#define GBUFFER_SAMPLER sampler2D
+vec4 gbufferTexture(sampler2D s, vec2 uv)
+{
+    return texture(s, uv);
+}
+vec2 gbufferSize(sampler2D s)
+{
+    return vec2(textureSize(s, 0));
+}
+#endif
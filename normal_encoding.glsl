@@ -0,0 +1,35 @@
+// Codificacion de la normal en el g-buffer (se incluye con #include "normal_encoding.glsl").
+// Con NORMAL_OCT la normal unitaria se guarda en 2 componentes con el mapeo octaedrico
+// y el target de normales puede ser RG16F; sin NORMAL_OCT se guarda tal cual.
+#ifdef NORMAL_OCT
+vec2 octWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+    return vec3(n.xy, 0.0);
+}
+
+vec3 decodeNormal(vec3 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#else
+vec3 encodeNormal(vec3 n)
+{
+    return n;
+}
+
+vec3 decodeNormal(vec3 e)
+{
+    return normalize(e);
+}
+#endif
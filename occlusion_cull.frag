@@ -0,0 +1,8 @@
+#version 330 core
+// marca la instancia como visible en el mapa de visibilidad (las ocultas no llegan a rasterizarse)
+out float Visible;
+
+void main()
+{
+    Visible = 1.0;
+}
@@ -0,0 +1,90 @@
+#version 330 core
+// un punto por instancia visible por el frustum, en el orden del VBO de instancias de la escena (ver
+// utils/occlusion_culling.h). Lo que sale en Instance* lo captura el transform feedback: la InstanceData
+// de la instancia si hay que dibujarla en esta fase, o la matriz nula si no
+layout (location = 0) in mat4 aModel;
+layout (location = 4) in vec4 aNormal0;
+layout (location = 5) in vec4 aNormal1;
+layout (location = 6) in vec4 aNormal2;
+layout (location = 7) in vec4 aSphere;      // centro (mundo) y radio
+layout (location = 8) in int aInstance;     // indice en la escena: texel en el mapa de visibilidad
+
+out vec4 InstanceModel0, InstanceModel1, InstanceModel2, InstanceModel3;
+out vec4 InstanceNormal0, InstanceNormal1, InstanceNormal2;
+
+uniform int phase;                  // 0: se dibujan las visibles el frame anterior; 1: prueba contra el Hi-Z
+uniform sampler2D lastVisible;      // mapa de visibilidad del frame anterior
+uniform sampler2D hiZ;
+uniform int hiZLevels;
+uniform vec2 renderSize;            // resolucion interna: el gDepth usado es la esquina inferior izquierda
+uniform float nearPlane;
+uniform mat4 view;
+uniform mat4 projection;
+
+// true si la esfera queda entera detras de la profundidad del Hi-Z
+bool occluded()
+{
+    // espacio de vista con z hacia adelante (la view es rigida: el radio no cambia)
+    vec3 c = (view * vec4(aSphere.xyz, 1.0)).xyz * vec3(1.0, 1.0, -1.0);
+    float r = aSphere.w;
+    if (c.z < r + nearPlane)
+        return false;
+
+    // rectangulo que ocupa la esfera proyectada (Mara y McGuire 2013), en [0, 1]
+    vec3 cr = c * r;
+    float czr2 = c.z * c.z - r * r;
+    float vx = sqrt(c.x * c.x + czr2);
+    float minX = (vx * c.x - cr.z) / (vx * c.z + cr.x);
+    float maxX = (vx * c.x + cr.z) / (vx * c.z - cr.x);
+    float vy = sqrt(c.y * c.y + czr2);
+    float minY = (vy * c.y - cr.z) / (vy * c.z + cr.y);
+    float maxY = (vy * c.y + cr.z) / (vy * c.z - cr.y);
+    vec4 rect = vec4(minX * projection[0][0], minY * projection[1][1], maxX * projection[0][0], maxY * projection[1][1]) * 0.5 + 0.5;
+
+    // pixeles del gDepth que cubre; un texel del nivel l junta 2^(l+1) pixeles por lado. Se sube hasta que el
+    // rectangulo entra en 2x2 texels y se toma el mas lejano de los cuatro
+    ivec2 last = ivec2(renderSize) - 1;
+    ivec2 lo = clamp(ivec2(floor(rect.xy * renderSize)), ivec2(0), last);
+    ivec2 hi = clamp(ivec2(floor(rect.zw * renderSize)), ivec2(0), last);
+    int level = 0;
+    while (level < hiZLevels - 1 && any(greaterThan((hi >> (level + 1)) - (lo >> (level + 1)), ivec2(1))))
+        ++level;
+    ivec2 size = textureSize(hiZ, level);
+    ivec2 a = min(lo >> (level + 1), size - 1);
+    ivec2 b = min(hi >> (level + 1), size - 1);
+    float farthest = max(max(texelFetch(hiZ, a, level).r, texelFetch(hiZ, ivec2(b.x, a.y), level).r),
+                         max(texelFetch(hiZ, ivec2(a.x, b.y), level).r, texelFetch(hiZ, b, level).r));
+
+    // profundidad (de ventana) del punto mas cercano de la esfera
+    vec4 clip = projection * vec4(0.0, 0.0, r - c.z, 1.0);
+    return clip.z / clip.w * 0.5 + 0.5 > farthest;
+}
+
+void main()
+{
+    ivec2 mapSize = textureSize(lastVisible, 0);
+    ivec2 texel = ivec2(aInstance % mapSize.x, aInstance / mapSize.x);
+    bool drawnEarly = texelFetch(lastVisible, texel, 0).r > 0.5;
+
+    bool draw;
+    if (phase == 0) {
+        // sin raster (GL_RASTERIZER_DISCARD): solo cuenta lo capturado
+        draw = drawnEarly;
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    }
+    else {
+        // las visibles marcan su texel para el proximo frame; las ocultas quedan fuera del clip volume
+        bool visible = !occluded();
+        draw = visible && !drawnEarly;
+        gl_Position = visible ? vec4((vec2(texel) + 0.5) / vec2(mapSize) * 2.0 - 1.0, 0.0, 1.0) : vec4(2.0, 2.0, 2.0, 1.0);
+    }
+
+    mat4 model = draw ? aModel : mat4(0.0);
+    InstanceModel0 = model[0];
+    InstanceModel1 = model[1];
+    InstanceModel2 = model[2];
+    InstanceModel3 = model[3];
+    InstanceNormal0 = aNormal0;
+    InstanceNormal1 = aNormal1;
+    InstanceNormal2 = aNormal2;
+}
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+#ifdef MULTIVIEW
+// vistas en lote: un quad por instancia, multiview_quad.geom lo manda a la capa gl_InstanceID
+#define TexCoords vTexCoords
+flat out int vView;
+#endif
+out vec2 TexCoords;
+
+// fraccion de los targets que ocupa la resolucion interna
+uniform vec2 uvScale = vec2(1.0);
+
+void main()
+{
+    TexCoords = aTexCoords * uvScale;
+    gl_Position = vec4(aPos, 1.0);
+#ifdef MULTIVIEW
+    vView = gl_InstanceID;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+// Pase de SSAO. Permutaciones:
+//  KERNEL_SIZE  tamanio del kernel de muestras (samplesNum no puede superarlo)
+//  SMOOTH       rangeCheck con smoothstep
+//  ADAPTIVE     cada tile usa entre minSamples y samplesNum muestras (ssao_tiles.frag)
+//  NORMAL_OCT   normales octaedricas en el g-buffer (normal_encoding.glsl)
+//  MULTIVIEW    todas las vistas de un lote en un draw, una capa por vista (multiview.glsl; sin ADAPTIVE)
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 64
+#endif
+
+#include "multiview.glsl"
+
+uniform GBUFFER_SAMPLER gPosition;
+uniform GBUFFER_SAMPLER gNormal;
+uniform sampler2D texNoise;
+uniform sampler2D tileBudget;   // fraccion de muestras por tile de 8x8 (ssao_tiles_shader)
+
+uniform vec3 samples[KERNEL_SIZE];
+
+// parametros
+uniform int samplesNum = KERNEL_SIZE;
+uniform float radius = 0.5;
+uniform float bias = 0.025;
+uniform float intensity = 1.0;
+uniform int minSamples = 8;     // ADAPTIVE
+
+// textura de ruido: (dimensiones de los targets) / 4
+uniform vec2 noiseScale = vec2(800.0/4.0, 600.0/4.0);
+// fraccion de los targets que ocupa la resolucion interna
+uniform vec2 uvScale = vec2(1.0);
+
+#ifdef MULTIVIEW
+#define projection projectionMatrices[Layer]
+#else
+uniform mat4 projection;
+#endif
+
+#include "normal_encoding.glsl"
+
+void main()
+{
+    // obtener las entradas para calcular AO
+    vec3 fragPos = gbufferTexture(gPosition, TexCoords).xyz;
+    vec3 normal = decodeNormal(gbufferTexture(gNormal, TexCoords).rgb);
+    vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);
+
+    // matriz de cambio de base(de tangent-space a view-space)
+    vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
+    vec3 binormal = cross(normal, tangent);
+    mat3 TBN = mat3(tangent, binormal, normal);
+
+    // no leer fuera de la zona renderizada este frame
+    vec2 uvMax = uvScale - 0.5 / gbufferSize(gPosition);
+
+    // cantidad de muestras para este fragmento
+    int sampleCount = min(samplesNum, KERNEL_SIZE);
+#ifdef ADAPTIVE
+    float budget = texelFetch(tileBudget, ivec2(gl_FragCoord.xy) / 8, 0).r;
+    sampleCount = clamp(int(ceil(budget * float(sampleCount))), min(minSamples, sampleCount), sampleCount);
+#endif
+
+    // calculamos un factor de oclusion por cada fragmento
+    float occlusion = 0.0;
+    for(int i = 0; i < sampleCount; ++i)
+    {
+        // get sample position
+        vec3 samplePos = TBN * samples[i]; // de tangent-space a view-space
+        samplePos = fragPos + samplePos * radius; 
+        
+        // proyectamos la muestra para obtener su posicion en la pantalla (y en la textura)
+        vec4 offset = vec4(samplePos, 1.0);
+        offset = projection * offset; // view-space -> clip-space
+        offset.xyz /= offset.w; // division perspectiva
+        offset.xyz = offset.xyz * 0.5 + 0.5; // -> screen-space [0.0, 1.0]
+        offset.xy = min(clamp(offset.xy, 0.0, 1.0) * uvScale, uvMax); // -> sub-rectangulo de la resolucion interna
+        
+        // profundidad del fragmento sobre el que se proyecta
+        float sampleDepth = gbufferTexture(gPosition, offset.xy).z; // get depth value of kernel sample
+        
+        // interpolacion suave para eliminar ruido (en gran parte).
+#ifdef SMOOTH
+        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
+#else
+        float rangeCheck = radius / abs(fragPos.z - sampleDepth);
+#endif
+
+        occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck * intensity;           
+    }
+    occlusion = 1.0 - (occlusion / float(sampleCount));
+    
+    FragColor = occlusion;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+// Blur del SSAO: box filter de blurSize x blurSize (ver BlurSize en main.cpp). Con el ruido blanco de 4x4 el
+// box es del tamanio de la textura de ruido, asi el promedio cancela el patron de la rotacion del kernel; con
+// blue noise el patron no tiene bajas frecuencias y alcanza un box chico centrado.
+
+#include "multiview.glsl"
+
+uniform GBUFFER_SAMPLER ssaoInput;
+
+// fraccion de los targets que ocupa la resolucion interna
+uniform vec2 uvScale = vec2(1.0);
+uniform int blurSize = 4;
+
+void main()
+{
+    vec2 texelSize = 1.0 / gbufferSize(ssaoInput);
+    // no leer fuera de la zona renderizada este frame
+    vec2 uvMax = uvScale - 0.5 * texelSize;
+    float result = 0.0;
+    int first = -blurSize / 2, end = blurSize - blurSize / 2;
+    for (int x = first; x < end; ++x)
+        for (int y = first; y < end; ++y)
+            result += gbufferTexture(ssaoInput, min(max(TexCoords + vec2(float(x), float(y)) * texelSize, vec2(0.0)), uvMax)).r;
+    FragColor = result / float(blurSize * blurSize);
+}
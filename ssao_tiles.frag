@@ -0,0 +1,90 @@
+#version 330 core
+out float FragColor;
+
+// Clasificacion por tiles de 8x8 para el SSAO adaptativo: cada fragmento de este pase es un tile.
+// Con pocas muestras y la variacion local de profundidad/normal decide que fraccion de samplesNum
+// necesita el tile (0 = solo las muestras minimas, 1 = todas).
+// Permutaciones: KERNEL_SIZE y NORMAL_OCT, igual que ssao.frag
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 64
+#endif
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+
+uniform vec3 samples[KERNEL_SIZE];
+
+// parametros
+uniform int coarseSamples = 8;
+uniform float radius = 0.5;
+uniform float bias = 0.025;
+// variacion a partir de la cual el tile se considera "complejo"
+uniform float depthThreshold = 0.02;
+uniform float normalThreshold = 0.1;
+
+// fraccion de los targets que ocupa la resolucion interna
+uniform vec2 uvScale = vec2(1.0);
+
+uniform mat4 projection;
+
+const float TILE = 8.0;
+// z de gPosition donde no hay geometria: el geometry pass lo limpia a (0, 0, BACKGROUND_Z, 0) (GBUFFER_BACKGROUND en
+// main.cpp). Queda detras de la camara; la geometria visible siempre tiene z < 0
+const float BACKGROUND_Z = 1.0;
+
+#include "normal_encoding.glsl"
+
+void main()
+{
+    vec2 texSize = vec2(textureSize(gPosition, 0));
+    vec2 uvMax = uvScale - 0.5 / texSize;
+    vec2 center = min((floor(gl_FragCoord.xy) * TILE + TILE * 0.5) / texSize, uvMax);
+
+    vec3 fragPos = texture(gPosition, center).xyz;
+    vec3 normal = decodeNormal(texture(gNormal, center).rgb);
+
+    // fondo (g-buffer sin geometria)
+    if (fragPos.z >= BACKGROUND_Z) {
+        FragColor = 0.0;
+        return;
+    }
+
+    // variacion local: esquinas del tile contra el centro
+    float depthVar = 0.0;
+    float normalVar = 0.0;
+    vec2 corner = (TILE * 0.5 - 0.5) / texSize;
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 dir = vec2((i & 1) == 0 ? -1.0 : 1.0, (i & 2) == 0 ? -1.0 : 1.0);
+        vec2 uv = min(max(center + dir * corner, vec2(0.0)), uvMax);
+        vec3 p = texture(gPosition, uv).xyz;
+        vec3 n = decodeNormal(texture(gNormal, uv).rgb);
+        // un vecino en el fondo es un borde de silueta
+        depthVar = max(depthVar, p.z >= BACKGROUND_Z ? 1.0 : abs(p.z - fragPos.z) / max(abs(fragPos.z), 1e-3));
+        normalVar = max(normalVar, 1.0 - dot(n, normal));
+    }
+
+    // oclusion gruesa con el prefijo del kernel, sin rotacion
+    vec3 tangent = normalize(abs(normal.x) < 0.9 ? cross(normal, vec3(1.0, 0.0, 0.0)) : cross(normal, vec3(0.0, 1.0, 0.0)));
+    mat3 TBN = mat3(tangent, cross(normal, tangent), normal);
+    float occluded = 0.0;
+    int coarse = min(coarseSamples, KERNEL_SIZE);
+    for (int i = 0; i < coarse; ++i)
+    {
+        vec3 samplePos = fragPos + TBN * samples[i] * radius;
+        vec4 offset = projection * vec4(samplePos, 1.0);
+        offset.xy = offset.xy / offset.w * 0.5 + 0.5;
+        offset.xy = min(clamp(offset.xy, 0.0, 1.0) * uvScale, uvMax);
+        float sampleDepth = texture(gPosition, offset.xy).z;
+        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
+        occluded += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;
+    }
+    occluded /= float(coarse);
+
+    // superficie plana y sin oclusion -> pocas muestras; bordes, pliegues o penumbra -> todas
+    float complexity = max(smoothstep(0.0, depthThreshold, depthVar), smoothstep(0.0, normalThreshold, normalVar));
+    float penumbra = occluded * (1.0 - occluded) * 4.0;     // 0 en los extremos, 1 en 50% ocluido
+    float partial = occluded > 0.0 ? max(penumbra, 0.25) : 0.0;
+
+    FragColor = clamp(max(complexity, partial), 0.0, 1.0);
+}
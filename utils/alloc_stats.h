@@ -0,0 +1,175 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#define PSAPI_VERSION 2     // K32GetProcessMemoryInfo, sin linkear psapi.lib
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Contadores de las reservas de C++ (operator new/delete de todo el programa, Assimp incluido): cantidad,
+// bytes vivos y pico de bytes vivos. Los cuentan los operadores de reemplazo que se compilan en la unidad que
+// define ALLOC_STATS_IMPLEMENTATION antes del include (una sola, como STB_IMAGE_IMPLEMENTATION). Lo que se
+// reserva con malloc (stb_image) no pasa por aca; para eso esta el pico de RSS del proceso.
+struct AllocStats
+{
+    static std::atomic<unsigned long long>& Count()
+    {
+        static std::atomic<unsigned long long> count{ 0 };
+        return count;
+    }
+
+    static std::atomic<size_t>& Live()
+    {
+        static std::atomic<size_t> live{ 0 };
+        return live;
+    }
+
+    static std::atomic<size_t>& Peak()
+    {
+        static std::atomic<size_t> peak{ 0 };
+        return peak;
+    }
+
+    static void Allocated(size_t bytes)
+    {
+        Count().fetch_add(1, std::memory_order_relaxed);
+        size_t live = Live().fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = Peak().load(std::memory_order_relaxed);
+        while (live > peak && !Peak().compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    }
+
+    static void Freed(size_t bytes)
+    {
+        Live().fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    // pico de memoria residente del proceso desde que arranco (bytes)
+    static size_t PeakRss()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.PeakWorkingSetSize;
+        return 0;
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#ifdef __APPLE__
+        return (size_t)usage.ru_maxrss;           // bytes en macOS
+#else
+        return (size_t)usage.ru_maxrss * 1024;    // KB en Linux
+#endif
+#endif
+    }
+};
+
+// Mide un tramo (la carga de un modelo): reservas hechas, pico de heap por encima de lo que habia al empezar,
+// lo que queda reservado al final y el pico de RSS. El pico del heap es global, asi que no se anidan.
+class AllocScope
+{
+public:
+    AllocScope()
+    {
+        Restart();
+    }
+
+    void Restart()
+    {
+        startCount = AllocStats::Count().load();
+        startLive = AllocStats::Live().load();
+        AllocStats::Peak().store(startLive);
+    }
+
+    unsigned long long Allocations() const
+    {
+        return AllocStats::Count().load() - startCount;
+    }
+
+    size_t PeakBytes() const
+    {
+        return AllocStats::Peak().load() - startLive;
+    }
+
+    // puede ser negativo si el tramo libero cosas de antes
+    long long RetainedBytes() const
+    {
+        return (long long)AllocStats::Live().load() - (long long)startLive;
+    }
+
+    // imprime y empieza un tramo nuevo
+    void Report(std::ostream& out, const std::string& name)
+    {
+        out << name << ": " << Allocations() << " allocations, heap peak " << PeakBytes() / 1024 << " KB, retained "
+            << RetainedBytes() / 1024 << " KB, process peak RSS " << AllocStats::PeakRss() / (1024 * 1024) << " MB" << std::endl;
+        Restart();
+    }
+
+private:
+    unsigned long long startCount = 0;
+    size_t startLive = 0;
+};
+
+#ifdef ALLOC_STATS_IMPLEMENTATION
+#include <cstdlib>
+#include <new>
+
+// cada bloque lleva delante su tamanio; el encabezado ocupa max_align_t para no romper la alineacion
+namespace alloc_stats_detail
+{
+    const size_t HEADER = sizeof(std::max_align_t) > sizeof(size_t) ? sizeof(std::max_align_t) : sizeof(size_t);
+
+    inline void* allocate(size_t bytes)
+    {
+        unsigned char* block = (unsigned char*)std::malloc(bytes + HEADER);
+        if (!block)
+            return nullptr;
+        *(size_t*)block = bytes;
+        AllocStats::Allocated(bytes);
+        return block + HEADER;
+    }
+
+    inline void release(void* p)
+    {
+        if (!p)
+            return;
+        unsigned char* block = (unsigned char*)p - HEADER;
+        AllocStats::Freed(*(size_t*)block);
+        std::free(block);
+    }
+}
+
+// las versiones nothrow, de arrays y con tamanio llaman a estas
+void* operator new(size_t bytes)
+{
+    void* p = alloc_stats_detail::allocate(bytes);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    alloc_stats_detail::release(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    alloc_stats_detail::release(p);
+}
+#endif
+#endif
@@ -0,0 +1,116 @@
+#ifndef AO_BAKER_H
+#define AO_BAKER_H
+
+#include <glm/glm.hpp>
+
+#include "utils/bvh.h"
+#include "utils/model.h"
+#include "utils/thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Bake offline de oclusion ambiental por vertice para modelos estaticos.
+// Arma un BVH con todas las mallas del modelo y, por cada vertice, traza Rays rayos con distribucion
+// coseno sobre el hemisferio de la normal; la AO es la fraccion de rayos que no chocan dentro de
+// MaxDistance. Los vertices se reparten en el ThreadPool. El resultado se guarda con Model::SaveBakedAO
+// y el modelo lo carga solo al abrirse (ver Model::LoadBakedAO).
+class AOBaker
+{
+public:
+    int Rays = 256;
+    float MaxDistance = 0.3f;   // fraccion del radio del modelo
+    float Bias = 1e-3f;         // fraccion del radio: separa el origen de la superficie
+
+    // estadisticas del ultimo Bake
+    size_t Triangles = 0, Vertices = 0, BvhNodes = 0;
+    double Seconds = 0.0;
+
+    // AO por vertice de cada malla del modelo (espacio de modelo)
+    std::vector<std::vector<float>> Bake(const Model& model)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // todas las mallas en un solo BVH: la oclusion entre mallas tambien cuenta
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        for (const Mesh& mesh : model.meshes) {
+            uint32_t base = (uint32_t)positions.size();
+            for (const Vertex& v : mesh.vertices)
+                positions.push_back(v.Position);
+            for (unsigned int i : mesh.indices)
+                indices.push_back(base + i);
+        }
+        Bvh bvh;
+        bvh.Build(positions, indices);
+        Triangles = bvh.TriangleCount();
+        BvhNodes = bvh.NodeCount();
+
+        float radius = std::max(model.BoundsRadius(), 1e-6f);
+        float maxDistance = MaxDistance * radius;
+        float bias = Bias * radius;
+        int rays = std::max(1, Rays);
+
+        std::vector<std::vector<float>> ao(model.meshes.size());
+        Vertices = 0;
+        for (size_t m = 0; m < model.meshes.size(); ++m) {
+            const std::vector<Vertex>& vertices = model.meshes[m].vertices;
+            ao[m].assign(vertices.size(), 1.0f);
+            Vertices += vertices.size();
+            ThreadPool::Get().ParallelFor(vertices.size(), 64, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    glm::vec3 n = vertices[i].Normal;
+                    float len = glm::length(n);
+                    if (!(len > 1e-6f))
+                        continue;
+                    n /= len;
+                    // base ortonormal alrededor de la normal
+                    glm::vec3 t = glm::normalize(std::fabs(n.x) < 0.9f ? glm::cross(n, glm::vec3(1.0f, 0.0f, 0.0f)) : glm::cross(n, glm::vec3(0.0f, 1.0f, 0.0f)));
+                    glm::vec3 b = glm::cross(n, t);
+                    glm::vec3 origin = vertices[i].Position + n * bias;
+
+                    // Hammersley con un desplazamiento por vertice (Cranley-Patterson), para no repetir el patron
+                    float shiftU = hashToUnit((uint32_t)(i * 2 + 0) ^ (uint32_t)(m * 0x9E3779B9u));
+                    float shiftV = hashToUnit((uint32_t)(i * 2 + 1) ^ (uint32_t)(m * 0x9E3779B9u));
+                    int hits = 0;
+                    for (int r = 0; r < rays; ++r) {
+                        float u = std::fmod((r + 0.5f) / rays + shiftU, 1.0f);
+                        float v = std::fmod(radicalInverse((uint32_t)r) + shiftV, 1.0f);
+                        // coseno: punto uniforme en el disco proyectado al hemisferio
+                        float rr = std::sqrt(u), phi = 6.28318530718f * v;
+                        glm::vec3 dir = t * (rr * std::cos(phi)) + b * (rr * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - u));
+                        if (bvh.Occluded(origin, dir, 0.0f, maxDistance))
+                            ++hits;
+                    }
+                    ao[m][i] = 1.0f - (float)hits / rays;
+                }
+            });
+        }
+
+        Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return ao;
+    }
+
+private:
+    static float radicalInverse(uint32_t bits)
+    {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return (float)bits * 2.3283064365386963e-10f;
+    }
+
+    static float hashToUnit(uint32_t x)
+    {
+        x ^= x >> 16; x *= 0x7feb352du;
+        x ^= x >> 15; x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return (x >> 8) * (1.0f / 16777216.0f);
+    }
+};
+#endif
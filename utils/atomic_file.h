@@ -0,0 +1,46 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Escribe 'path' entero o nada: 'write' llena un temporal propio de este proceso y este llamado
+// (<path>.<pid>.<n>.tmp, en el mismo directorio) que despues se renombra encima de 'path'. Quien lo lee,
+// aunque sea otro proceso, ve el archivo anterior o el nuevo completo; dos procesos que escriben el mismo
+// archivo a la vez no se pisan el temporal, gana el ultimo rename. 'write' devuelve false para abortar; si
+// algo falla se borra el temporal y 'path' queda como estaba.
+inline bool WriteFileAtomic(const std::string& path, const std::function<bool(std::ofstream&)>& write)
+{
+    static std::atomic<unsigned long long> counter{ 0 };
+#ifdef _WIN32
+    long long pid = _getpid();
+#else
+    long long pid = getpid();
+#endif
+    std::filesystem::path tmp(path + "." + std::to_string(pid) + "." + std::to_string(counter++) + ".tmp");
+    bool ok;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        ok = out && write(out);
+        out.close();
+        ok = ok && !out.fail();
+    }
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tmp, path, ec);
+        ok = !ec;
+    }
+    if (!ok)
+        std::filesystem::remove(tmp, ec);
+    return ok;
+}
+#endif
@@ -0,0 +1,326 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// BVH de triangulos para consultas de visibilidad (bake de AO).
+// Se construye con SAH por bins sobre los centroides; cada hoja tiene hasta 4 triangulos guardados
+// como un paquete SoA, asi la interseccion rayo/triangulo (Moller-Trumbore) prueba los 4 a la vez con SSE.
+// Es de solo lectura una vez construido: Occluded se puede llamar desde varios hilos.
+class Bvh
+{
+public:
+    // triangulos: posiciones e indices (3 por triangulo)
+    void Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+    {
+        size_t triCount = indices.size() / 3;
+        tris.resize(triCount);
+        refs.resize(triCount);
+        for (size_t t = 0; t < triCount; ++t) {
+            Tri& tri = tris[t];
+            tri.V0 = positions[indices[t * 3]];
+            tri.V1 = positions[indices[t * 3 + 1]];
+            tri.V2 = positions[indices[t * 3 + 2]];
+            refs[t].Min = glm::min(tri.V0, glm::min(tri.V1, tri.V2));
+            refs[t].Max = glm::max(tri.V0, glm::max(tri.V1, tri.V2));
+            refs[t].Centroid = (refs[t].Min + refs[t].Max) * 0.5f;
+            refs[t].Index = (uint32_t)t;
+        }
+
+        nodes.clear();
+        packets.clear();
+        nodes.reserve(triCount * 2 / LEAF_SIZE + 1);
+        nodes.emplace_back();
+        if (triCount > 0)
+            build(0, 0, triCount, 0);
+        else
+            nodes[0].Count = 0;
+        refs.clear();
+        refs.shrink_to_fit();
+    }
+
+    size_t NodeCount() const
+    {
+        return nodes.size();
+    }
+
+    size_t TriangleCount() const
+    {
+        return tris.size();
+    }
+
+    // true si el rayo origin + t * dir toca algun triangulo con tMin < t < tMax
+    bool Occluded(const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax) const
+    {
+        if (nodes.empty() || tris.empty())
+            return false;
+        glm::vec3 invDir(1.0f / safe(dir.x), 1.0f / safe(dir.y), 1.0f / safe(dir.z));
+        uint32_t stack[STACK_SIZE];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (!hitsBox(node, origin, invDir, tMin, tMax))
+                continue;
+            if (node.Count > 0) {
+                if (hitsPacket(packets[node.First], origin, dir, tMin, tMax))
+                    return true;
+            }
+            else {
+                stack[top++] = node.First;
+                stack[top++] = node.First + 1;
+            }
+        }
+        return false;
+    }
+
+private:
+    static const int LEAF_SIZE = 4;
+    static const int BINS = 16;
+    // a partir de esta profundidad se corta por la mitad: acota la pila del recorrido
+    static const int MAX_SAH_DEPTH = 40;
+    static const int STACK_SIZE = 128;
+
+    struct Node {
+        glm::vec3 Min;
+        uint32_t First = 0;     // hoja: indice del paquete; interno: hijo izquierdo (el derecho es First + 1)
+        glm::vec3 Max;
+        uint32_t Count = 0;     // triangulos en la hoja (0 = nodo interno)
+    };
+
+    struct Tri { glm::vec3 V0, V1, V2; };
+
+    struct Ref {
+        glm::vec3 Min, Max, Centroid;
+        uint32_t Index;
+    };
+
+    // 4 triangulos en SoA: vertice 0 y aristas e1 = v1 - v0, e2 = v2 - v0 (los que faltan quedan degenerados)
+    struct Packet {
+        float V0[3][4];
+        float E1[3][4];
+        float E2[3][4];
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Packet> packets;
+    std::vector<Tri> tris;
+    std::vector<Ref> refs;
+
+    static float safe(float v)
+    {
+        return std::fabs(v) < 1e-12f ? (v < 0.0f ? -1e-12f : 1e-12f) : v;
+    }
+
+    static float area(const glm::vec3& mn, const glm::vec3& mx)
+    {
+        glm::vec3 d = mx - mn;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    void build(uint32_t nodeIndex, size_t begin, size_t end, int depth)
+    {
+        glm::vec3 mn(FLT_MAX), mx(-FLT_MAX), cmn(FLT_MAX), cmx(-FLT_MAX);
+        for (size_t i = begin; i < end; ++i) {
+            mn = glm::min(mn, refs[i].Min);
+            mx = glm::max(mx, refs[i].Max);
+            cmn = glm::min(cmn, refs[i].Centroid);
+            cmx = glm::max(cmx, refs[i].Centroid);
+        }
+        nodes[nodeIndex].Min = mn;
+        nodes[nodeIndex].Max = mx;
+        size_t count = end - begin;
+
+        // mejor corte por SAH: bins sobre el eje de cada dimension de los centroides
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = FLT_MAX;
+        if (count > (size_t)LEAF_SIZE && depth < MAX_SAH_DEPTH) {
+            for (int axis = 0; axis < 3; ++axis) {
+                float extent = cmx[axis] - cmn[axis];
+                if (extent <= 0.0f)
+                    continue;
+                glm::vec3 bmn[BINS], bmx[BINS];
+                int bcount[BINS] = { 0 };
+                for (int b = 0; b < BINS; ++b) {
+                    bmn[b] = glm::vec3(FLT_MAX);
+                    bmx[b] = glm::vec3(-FLT_MAX);
+                }
+                float scale = BINS / extent;
+                for (size_t i = begin; i < end; ++i) {
+                    int b = std::min(BINS - 1, (int)((refs[i].Centroid[axis] - cmn[axis]) * scale));
+                    ++bcount[b];
+                    bmn[b] = glm::min(bmn[b], refs[i].Min);
+                    bmx[b] = glm::max(bmx[b], refs[i].Max);
+                }
+                // barrido: areas y cantidades a la izquierda y a la derecha de cada corte
+                float leftArea[BINS - 1];
+                int leftCount[BINS - 1];
+                glm::vec3 lmn(FLT_MAX), lmx(-FLT_MAX);
+                int lc = 0;
+                for (int b = 0; b < BINS - 1; ++b) {
+                    lc += bcount[b];
+                    if (bcount[b] > 0) {
+                        lmn = glm::min(lmn, bmn[b]);
+                        lmx = glm::max(lmx, bmx[b]);
+                    }
+                    leftCount[b] = lc;
+                    leftArea[b] = lc > 0 ? area(lmn, lmx) : 0.0f;
+                }
+                glm::vec3 rmn(FLT_MAX), rmx(-FLT_MAX);
+                int rc = 0;
+                for (int b = BINS - 1; b > 0; --b) {
+                    rc += bcount[b];
+                    if (bcount[b] > 0) {
+                        rmn = glm::min(rmn, bmn[b]);
+                        rmx = glm::max(rmx, bmx[b]);
+                    }
+                    if (leftCount[b - 1] == 0 || rc == 0)
+                        continue;
+                    float cost = leftArea[b - 1] * leftCount[b - 1] + area(rmn, rmx) * rc;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b;
+                    }
+                }
+            }
+        }
+
+        // hoja: si entra en un paquete, o si no hay corte posible (centroides coincidentes)
+        if (bestAxis < 0) {
+            if (count <= (size_t)LEAF_SIZE) {
+                makeLeaf(nodeIndex, begin, end);
+                return;
+            }
+            // mitad y mitad por orden, para no dejar hojas de mas de LEAF_SIZE
+            splitAt(nodeIndex, begin, begin + count / 2, end, depth);
+            return;
+        }
+
+        float scale = BINS / (cmx[bestAxis] - cmn[bestAxis]);
+        float cmnAxis = cmn[bestAxis];
+        Ref* mid = std::partition(refs.data() + begin, refs.data() + end, [&](const Ref& r) {
+            return std::min(BINS - 1, (int)((r.Centroid[bestAxis] - cmnAxis) * scale)) < bestSplit;
+        });
+        splitAt(nodeIndex, begin, mid - refs.data(), end, depth);
+    }
+
+    void splitAt(uint32_t nodeIndex, size_t begin, size_t mid, size_t end, int depth)
+    {
+        uint32_t left = (uint32_t)nodes.size();
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[nodeIndex].First = left;
+        nodes[nodeIndex].Count = 0;
+        build(left, begin, mid, depth + 1);
+        build(left + 1, mid, end, depth + 1);
+    }
+
+    void makeLeaf(uint32_t nodeIndex, size_t begin, size_t end)
+    {
+        Packet p;
+        for (int lane = 0; lane < 4; ++lane) {
+            glm::vec3 v0(0.0f), e1(0.0f), e2(0.0f);
+            if (begin + lane < end) {
+                const Tri& t = tris[refs[begin + lane].Index];
+                v0 = t.V0;
+                e1 = t.V1 - t.V0;
+                e2 = t.V2 - t.V0;
+            }
+            for (int c = 0; c < 3; ++c) {
+                p.V0[c][lane] = v0[c];
+                p.E1[c][lane] = e1[c];
+                p.E2[c][lane] = e2[c];
+            }
+        }
+        nodes[nodeIndex].First = (uint32_t)packets.size();
+        nodes[nodeIndex].Count = (uint32_t)(end - begin);
+        packets.push_back(p);
+    }
+
+    static bool hitsBox(const Node& n, const glm::vec3& o, const glm::vec3& invDir, float tMin, float tMax)
+    {
+        for (int a = 0; a < 3; ++a) {
+            float t0 = (n.Min[a] - o[a]) * invDir[a];
+            float t1 = (n.Max[a] - o[a]) * invDir[a];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+            if (tMin > tMax)
+                return false;
+        }
+        return true;
+    }
+
+    // Moller-Trumbore contra los 4 triangulos del paquete
+    static bool hitsPacket(const Packet& p, const glm::vec3& o, const glm::vec3& d, float tMin, float tMax)
+    {
+#ifdef BVH_SSE
+        __m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+        __m128 e1x = _mm_loadu_ps(p.E1[0]), e1y = _mm_loadu_ps(p.E1[1]), e1z = _mm_loadu_ps(p.E1[2]);
+        __m128 e2x = _mm_loadu_ps(p.E2[0]), e2y = _mm_loadu_ps(p.E2[1]), e2z = _mm_loadu_ps(p.E2[2]);
+        // pvec = d x e2
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        // |det| > eps (los triangulos de relleno tienen det = 0)
+        __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+        __m128 valid = _mm_cmpgt_ps(absDet, _mm_set1_ps(1e-12f));
+        __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(_mm_and_ps(valid, det), _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+        // tvec = o - v0
+        __m128 tx = _mm_sub_ps(_mm_set1_ps(o.x), _mm_loadu_ps(p.V0[0]));
+        __m128 ty = _mm_sub_ps(_mm_set1_ps(o.y), _mm_loadu_ps(p.V0[1]));
+        __m128 tz = _mm_sub_ps(_mm_set1_ps(o.z), _mm_loadu_ps(p.V0[2]));
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inv);
+        // qvec = tvec x e1
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv);
+        __m128 zero = _mm_setzero_ps();
+        __m128 hit = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+        hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, _mm_set1_ps(tMin)));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(t, _mm_set1_ps(tMax)));
+        return _mm_movemask_ps(hit) != 0;
+#else
+        for (int lane = 0; lane < 4; ++lane) {
+            glm::vec3 e1(p.E1[0][lane], p.E1[1][lane], p.E1[2][lane]);
+            glm::vec3 e2(p.E2[0][lane], p.E2[1][lane], p.E2[2][lane]);
+            glm::vec3 pvec = glm::cross(d, e2);
+            float det = glm::dot(e1, pvec);
+            if (std::fabs(det) <= 1e-12f)
+                continue;
+            float inv = 1.0f / det;
+            glm::vec3 tvec = o - glm::vec3(p.V0[0][lane], p.V0[1][lane], p.V0[2][lane]);
+            float u = glm::dot(tvec, pvec) * inv;
+            if (u < 0.0f || u > 1.0f)
+                continue;
+            glm::vec3 qvec = glm::cross(tvec, e1);
+            float v = glm::dot(d, qvec) * inv;
+            if (v < 0.0f || u + v > 1.0f)
+                continue;
+            float t = glm::dot(e2, qvec) * inv;
+            if (t > tMin && t < tMax)
+                return true;
+        }
+        return false;
+#endif
+    }
+};
+#endif
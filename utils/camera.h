@@ -112,6 +112,14 @@ public:
             Zoom = 45.0f; 
     }
 
+    // sets the Euler angles directly (session replay) and recomputes the camera vectors
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
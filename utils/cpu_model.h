@@ -0,0 +1,123 @@
+#ifndef CPU_MODEL_H
+#define CPU_MODEL_H
+
+#include <glm/glm.hpp>
+
+#include "utils/mesh_cache.h"
+#include "utils/model.h"
+#include "utils/obj_loader.h"
+
+#include <cfloat>
+#include <string>
+#include <vector>
+
+// Un modelo solo en memoria, sin nada de GL: para lo que corre sin contexto (el rasterizador de CPU en maquinas
+// sin GPU, el coordinador de --shard). Las mallas salen de la cache binaria (<modelo>.mesh, mapeada) o del .obj
+// con ObjLoader, y la AO horneada directo de <modelo>.ao. No carga texturas ni crea buffers; los vertices son los
+// mismos que subiria Model, asi que tambien puede escribir la cache que despues leen los procesos con GL.
+class CpuModel
+{
+public:
+    struct Part
+    {
+        const Vertex* Vertices = nullptr;
+        unsigned int VertexCount = 0;
+        const unsigned int* Indices = nullptr;
+        unsigned int IndexCount = 0;
+        std::vector<float> BakedAO;     // un valor por vertice; vacio si no hay bake (o es de otra version del modelo)
+    };
+
+    std::vector<Part> Meshes;
+    glm::vec3 BoundsMin = glm::vec3(FLT_MAX), BoundsMax = glm::vec3(-FLT_MAX);
+    bool FromCache = false;
+    std::string Error;
+
+    CpuModel() {}
+    CpuModel(const CpuModel&) = delete;
+    CpuModel& operator=(const CpuModel&) = delete;
+
+    // 'path' es el .obj; con useCache se lee la cache si esta al dia. Solo importa con ObjLoader (el que usa
+    // Model para los .obj): si falla no hay fallback a Assimp y devuelve false con el motivo en Error
+    bool Load(const std::string& path, bool useCache)
+    {
+        Meshes.clear();
+        objMeshes.clear();
+        cache.Close();
+        BoundsMin = glm::vec3(FLT_MAX);
+        BoundsMax = glm::vec3(-FLT_MAX);
+        FromCache = false;
+        Error.clear();
+        this->path = path;
+
+        if (useCache && cache.Open(path) && !cache.Meshes.empty()) {
+            FromCache = true;
+            for (const MeshCache::MeshData& data : cache.Meshes)
+                addPart(data.Vertices, data.VertexCount, data.Indices, data.IndexCount);
+        }
+        else {
+            ObjLoader loader;
+            if (!loader.Load(path, objMeshes)) {
+                Error = loader.Error;
+                return false;
+            }
+            for (const ObjMesh& mesh : objMeshes)
+                addPart(mesh.Vertices.data(), (unsigned int)mesh.Vertices.size(), mesh.Indices.data(), (unsigned int)mesh.Indices.size());
+        }
+
+        std::vector<unsigned int> counts;
+        for (const Part& part : Meshes)
+            counts.push_back(part.VertexCount);
+        std::vector<std::vector<float>> ao;
+        if (Model::ReadBakedAO(path + ".ao", counts, ao))
+            for (size_t m = 0; m < Meshes.size(); ++m)
+                Meshes[m].BakedAO = std::move(ao[m]);
+        return true;
+    }
+
+    // escribe la cache de las mallas importadas, con las mismas referencias a texturas que guardaria Model
+    // (si se leyeron de la cache ya esta al dia)
+    bool SaveMeshCache() const
+    {
+        if (FromCache)
+            return true;
+        std::vector<MeshCache::MeshData> data;
+        for (size_t m = 0; m < objMeshes.size(); ++m) {
+            const Part& part = Meshes[m];
+            MeshCache::MeshData entry = { part.Vertices, part.VertexCount, part.Indices, part.IndexCount, {} };
+            if (!objMeshes[m].DiffuseMap.empty())
+                entry.Textures.push_back({ "texture_diffuse", objMeshes[m].DiffuseMap });
+            data.push_back(std::move(entry));
+        }
+        return MeshCache::Write(path, data);
+    }
+
+    glm::vec3 BoundsCenter() const
+    {
+        return (BoundsMin + BoundsMax) * 0.5f;
+    }
+
+    float BoundsRadius() const
+    {
+        return glm::length(BoundsMax - BoundsMin) * 0.5f;
+    }
+
+private:
+    std::string path;
+    MeshCache cache;                    // duenos de los datos a los que apuntan los Part
+    std::vector<ObjMesh> objMeshes;
+
+    void addPart(const Vertex* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+    {
+        Part part;
+        part.Vertices = vertices;
+        part.VertexCount = vertexCount;
+        part.Indices = indices;
+        part.IndexCount = indexCount;
+        for (unsigned int i = 0; i < vertexCount; ++i) {
+            BoundsMin = glm::min(BoundsMin, vertices[i].Position);
+            BoundsMax = glm::max(BoundsMax, vertices[i].Position);
+        }
+        Meshes.push_back(std::move(part));
+    }
+};
+#endif
@@ -0,0 +1,562 @@
+#ifndef CPU_RASTERIZER_H
+#define CPU_RASTERIZER_H
+
+#include <glm/glm.hpp>
+
+#include "utils/cpu_model.h"
+#include "utils/memory_stats.h"
+#include "utils/thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_RASTER_SSE 1
+#include <emmintrin.h>
+#endif
+
+// G-buffer en memoria con lo mismo que escribe gbuffer.frag, pixel a pixel. Las filas van de abajo hacia
+// arriba como en las texturas de GL: cada arreglo se sube tal cual con glTexImage2D.
+struct CpuGBuffer
+{
+    int Width = 0, Height = 0;
+    std::vector<glm::vec3> Position;    // gPosition: espacio de vista (GL_RGB, GL_FLOAT); el fondo con z = 1 como en GL
+    std::vector<glm::vec3> Normal;      // gNormal: encodeNormal de normal_encoding.glsl (con NORMAL_OCT, z = 0)
+    std::vector<uint8_t> Albedo;        // gAlbedo: RGBA8, rgb color y a la AO horneada
+    std::vector<float> Depth;           // gDepth: profundidad de ventana, 1 en el fondo (GL_DEPTH_COMPONENT, GL_FLOAT)
+    std::vector<uint8_t> Coverage;      // 1 donde hay geometria (lo que marca el stencil de gDepth)
+
+    void Resize(int width, int height)
+    {
+        Width = width;
+        Height = height;
+        size_t n = (size_t)width * height;
+        Position.resize(n);
+        Normal.resize(n);
+        Albedo.resize(n * 4);
+        Depth.resize(n);
+        Coverage.resize(n);
+    }
+
+    size_t Bytes() const
+    {
+        return Position.capacity() * sizeof(glm::vec3) + Normal.capacity() * sizeof(glm::vec3) + Albedo.capacity()
+            + Depth.capacity() * sizeof(float) + Coverage.capacity();
+    }
+};
+
+// Rasterizador de CPU para el geometry pass, para maquinas sin GPU (un GL por software no sabe nada de la
+// escena y es bastante mas lento). No usa GL: dibuja un CpuModel. Produce el mismo g-buffer que gbuffer.vert + gbuffer.frag:
+//   1. vertices: posicion de clip, posicion y normal en vista y AO horneada, repartidos en el ThreadPool
+//   2. setup: por bloques de triangulos en paralelo; descarta lo que queda fuera del frustum, recorta contra el
+//      plano near, arma las funciones de borde y el plano de profundidad y anota cada triangulo en los tiles
+//      de TILE x TILE pixeles que toca (cada bloque en sus propias listas, sin locks)
+//   3. raster: un tile por trabajo. Los triangulos del tile se recorren en el orden en que se mandaron (como
+//      en GL, ante un empate de profundidad gana el primero) y se pintan por bloques de BLOCK x BLOCK pixeles,
+//      evaluando las tres funciones de borde y la profundidad de a 4 pixeles con SSE2 (con fallback escalar).
+//      La profundidad es jerarquica: el tile y cada bloque guardan la profundidad mas lejana que tienen, y un
+//      triangulo cuya profundidad minima no le gana se saltea entero sin tocar pixeles. Cada pixel guarda solo
+//      la profundidad y el triangulo visible
+//   4. resolve: interpola los atributos (con correccion de perspectiva) solo en los pixeles visibles
+// No hay culling de caras, igual que en el pipeline de GL.
+class CpuRasterizer
+{
+public:
+    static const int TILE = 64;     // lado de los tiles (multiplo de BLOCK)
+    static const int BLOCK = 8;     // lado de los bloques de la profundidad jerarquica
+
+    bool OctahedralNormals = false; // gNormal con NORMAL_OCT
+
+    CpuGBuffer Target;
+
+    // estadisticas del ultimo Render
+    size_t Triangles = 0, Rasterized = 0, BinEntries = 0, BlocksTested = 0, BlocksCulled = 0;
+    double SetupMs = 0.0, RasterMs = 0.0, ResolveMs = 0.0;
+
+    CpuRasterizer() {}
+    CpuRasterizer(const CpuRasterizer&) = delete;
+    CpuRasterizer& operator=(const CpuRasterizer&) = delete;
+
+    // un modelo con sus instancias
+    void Render(const CpuModel& model, const std::vector<InstanceData>& instances, const glm::mat4& view, const glm::mat4& projection, int width, int height)
+    {
+        render(model, instances, view, projection, width, height);
+    }
+
+    MemoryUsage Memory() const
+    {
+        size_t bins = 0;
+        for (const std::vector<uint32_t>& bin : tileBins)
+            bins += bin.capacity() * sizeof(uint32_t);
+        return MemoryUsage(Target.Bytes() + vertices.capacity() * sizeof(ShadedVertex) + triangles.capacity() * sizeof(Triangle) + bins
+            + depth.capacity() * sizeof(float) + visibility.capacity() * sizeof(uint32_t), 0);
+    }
+
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+    static const size_t CHUNK = 8192;       // triangulos por trabajo del setup
+
+    // una malla de una instancia: sus vertices transformados empiezan en FirstVertex y sus triangulos en FirstTriangle
+    struct Batch
+    {
+        const CpuModel::Part* Source;
+        const InstanceData* Instance;
+        const float* AO;
+        size_t FirstVertex, FirstTriangle;
+    };
+
+    struct ShadedVertex
+    {
+        glm::vec4 Clip;
+        glm::vec3 View;
+        glm::vec3 Normal;
+        float AO;
+    };
+
+    // triangulo listo para rasterizar, en pixeles de ventana. E_i(x, y) = A[i] x + (B[i] y + C[i]) es el borde
+    // opuesto al vertice i, positivo adentro. Weights[i] son los pesos del vertice i de pantalla sobre los tres
+    // originales (la identidad, salvo que el recorte contra near haya creado vertices)
+    struct Triangle
+    {
+        float A[3], B[3], C[3];
+        uint32_t Inclusive[3];      // mascara (todos unos o cero): el borde incluye los pixeles con E = 0
+        float Zx, Zy, Zc, ZMin;
+        float InvW[3];
+        int MinX, MinY, MaxX, MaxY;
+        uint32_t Vertex[3];
+        glm::vec3 Weights[3];
+    };
+
+    std::vector<Batch> batches;
+    std::vector<ShadedVertex> vertices;
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<Triangle>> chunkTriangles;
+    std::vector<std::vector<uint32_t>> tileBins;    // [bloque del setup * tiles + tile]: indices locales del bloque
+    std::vector<size_t> chunkStart;
+    std::vector<float> depth;                       // a tiles enteros (paddedWidth x paddedHeight)
+    std::vector<uint32_t> visibility;
+    int tilesX = 0, tilesY = 0, paddedWidth = 0;
+
+    void render(const CpuModel& model, const std::vector<InstanceData>& instances, const glm::mat4& view, const glm::mat4& projection, int width, int height)
+    {
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point start = Clock::now();
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        Target.Resize(width, height);
+        tilesX = (width + TILE - 1) / TILE;
+        tilesY = (height + TILE - 1) / TILE;
+        paddedWidth = tilesX * TILE;
+        depth.resize((size_t)paddedWidth * tilesY * TILE);
+        visibility.resize(depth.size());
+
+        // 1. vertices
+        batches.clear();
+        size_t vertexCount = 0, triangleCount = 0;
+        for (const InstanceData& instance : instances) {
+            // las instancias que descarta el occlusion culling llegan con la matriz nula (como en gbuffer.vert)
+            if (instance.Model[3][3] == 0.0f)
+                continue;
+            for (const CpuModel::Part& mesh : model.Meshes) {
+                const float* meshAO = mesh.BakedAO.size() == mesh.VertexCount ? mesh.BakedAO.data() : nullptr;
+                batches.push_back({ &mesh, &instance, meshAO, vertexCount, triangleCount });
+                vertexCount += mesh.VertexCount;
+                triangleCount += mesh.IndexCount / 3;
+            }
+        }
+        Triangles = triangleCount;
+        vertices.resize(vertexCount);
+        ThreadPool::Get().ParallelFor(vertexCount, 4096, [&](size_t begin, size_t end) {
+            size_t b = findBatch(begin, &Batch::FirstVertex), current = batches.size();
+            glm::mat4 modelView, modelViewProjection;
+            glm::mat3 normalMatrix;
+            for (size_t i = begin; i < end; ++i) {
+                while (b + 1 < batches.size() && batches[b + 1].FirstVertex <= i)
+                    ++b;
+                const Batch& batch = batches[b];
+                if (b != current) {
+                    // las matrices de la instancia, una vez por malla
+                    const InstanceData& instance = *batch.Instance;
+                    modelView = view * instance.Model;
+                    modelViewProjection = projection * modelView;
+                    normalMatrix = glm::mat3(view) * glm::mat3(glm::vec3(instance.NormalMatrix[0]), glm::vec3(instance.NormalMatrix[1]),
+                                                               glm::vec3(instance.NormalMatrix[2]));
+                    current = b;
+                }
+                const Vertex& source = batch.Source->Vertices[i - batch.FirstVertex];
+                glm::vec4 position(source.Position, 1.0f);
+                glm::vec4 viewPos = modelView * position;
+                ShadedVertex& out = vertices[i];
+                out.Clip = modelViewProjection * position;
+                out.View = glm::vec3(viewPos);
+                out.Normal = normalMatrix * source.Normal;
+                out.AO = batch.AO != nullptr ? batch.AO[i - batch.FirstVertex] : 1.0f;
+            }
+        });
+
+        // 2. setup y binning
+        size_t chunks = (triangleCount + CHUNK - 1) / CHUNK;
+        size_t tileCount = (size_t)tilesX * tilesY;
+        chunkTriangles.resize(chunks);
+        tileBins.resize(chunks * tileCount);
+        for (std::vector<uint32_t>& bin : tileBins)
+            bin.clear();
+        ThreadPool::Get().ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c)
+                setupChunk(c, std::min((c + 1) * CHUNK, triangleCount), width, height);
+        });
+        chunkStart.assign(chunks + 1, 0);
+        for (size_t c = 0; c < chunks; ++c)
+            chunkStart[c + 1] = chunkStart[c] + chunkTriangles[c].size();
+        Rasterized = chunkStart[chunks];
+        triangles.resize(Rasterized);
+        for (size_t c = 0; c < chunks; ++c)
+            std::copy(chunkTriangles[c].begin(), chunkTriangles[c].end(), triangles.begin() + chunkStart[c]);
+        BinEntries = 0;
+        for (const std::vector<uint32_t>& bin : tileBins)
+            BinEntries += bin.size();
+        Clock::time_point setupEnd = Clock::now();
+
+        // 3. raster
+        std::vector<size_t> tested(tileCount, 0), culled(tileCount, 0);
+        ThreadPool::Get().ParallelFor(tileCount, 1, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; ++t)
+                rasterTile(t, chunks, tested[t], culled[t]);
+        });
+        BlocksTested = BlocksCulled = 0;
+        for (size_t t = 0; t < tileCount; ++t) {
+            BlocksTested += tested[t];
+            BlocksCulled += culled[t];
+        }
+        Clock::time_point rasterEnd = Clock::now();
+
+        // 4. resolve
+        ThreadPool::Get().ParallelFor((size_t)height, 16, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y)
+                for (int x = 0; x < width; ++x)
+                    resolve(x, (int)y);
+        });
+        Clock::time_point resolveEnd = Clock::now();
+
+        SetupMs = std::chrono::duration<double, std::milli>(setupEnd - start).count();
+        RasterMs = std::chrono::duration<double, std::milli>(rasterEnd - setupEnd).count();
+        ResolveMs = std::chrono::duration<double, std::milli>(resolveEnd - rasterEnd).count();
+    }
+
+    // el Batch que contiene el elemento 'index' (vertice o triangulo, segun 'first')
+    size_t findBatch(size_t index, size_t Batch::*first) const
+    {
+        auto it = std::upper_bound(batches.begin(), batches.end(), index, [first](size_t value, const Batch& batch) { return value < batch.*first; });
+        return it == batches.begin() ? 0 : (size_t)(it - batches.begin()) - 1;
+    }
+
+    void setupChunk(size_t chunk, size_t end, int width, int height)
+    {
+        std::vector<Triangle>& out = chunkTriangles[chunk];
+        out.clear();
+        size_t first = chunk * CHUNK;
+        size_t b = findBatch(first, &Batch::FirstTriangle);
+        for (size_t t = first; t < end; ++t) {
+            while (b + 1 < batches.size() && batches[b + 1].FirstTriangle <= t)
+                ++b;
+            const Batch& batch = batches[b];
+            const unsigned int* index = batch.Source->Indices + 3 * (t - batch.FirstTriangle);
+            uint32_t original[3];
+            glm::vec4 clip[3];
+            for (int i = 0; i < 3; ++i) {
+                original[i] = (uint32_t)(batch.FirstVertex + index[i]);
+                clip[i] = vertices[original[i]].Clip;
+            }
+
+            // afuera de un mismo plano del frustum (el far lo resuelve el test de profundidad contra 1)
+            bool outside = false;
+            for (int axis = 0; axis < 3 && !outside; ++axis) {
+                outside = clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w;
+                outside = outside || (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w);
+            }
+            if (outside)
+                continue;
+
+            glm::vec3 identity[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+            if (clip[0].z >= -clip[0].w && clip[1].z >= -clip[1].w && clip[2].z >= -clip[2].w) {
+                emit(clip, identity, original, chunk, width, height);
+                continue;
+            }
+
+            // recorte contra near (z = -w): queda un triangulo o un cuadrilatero, que se parte en dos
+            glm::vec4 polygon[4];
+            glm::vec3 weights[4];
+            int count = 0;
+            for (int i = 0; i < 3; ++i) {
+                int j = (i + 1) % 3;
+                float di = clip[i].z + clip[i].w, dj = clip[j].z + clip[j].w;
+                if (di >= 0.0f) {
+                    polygon[count] = clip[i];
+                    weights[count++] = identity[i];
+                }
+                if ((di >= 0.0f) != (dj >= 0.0f)) {
+                    float s = di / (di - dj);
+                    polygon[count] = glm::mix(clip[i], clip[j], s);
+                    weights[count++] = glm::mix(identity[i], identity[j], s);
+                }
+            }
+            for (int k = 1; k + 1 < count; ++k) {
+                glm::vec4 fanClip[3] = { polygon[0], polygon[k], polygon[k + 1] };
+                glm::vec3 fanWeights[3] = { weights[0], weights[k], weights[k + 1] };
+                emit(fanClip, fanWeights, original, chunk, width, height);
+            }
+        }
+    }
+
+    void emit(const glm::vec4 clip[3], const glm::vec3 weights[3], const uint32_t original[3], size_t chunk, int width, int height)
+    {
+        Triangle tri;
+        float x[3], y[3], z[3];
+        for (int i = 0; i < 3; ++i) {
+            if (!(clip[i].w > 1e-7f))
+                return;
+            tri.InvW[i] = 1.0f / clip[i].w;
+            x[i] = (clip[i].x * tri.InvW[i] * 0.5f + 0.5f) * width;
+            y[i] = (clip[i].y * tri.InvW[i] * 0.5f + 0.5f) * height;
+            z[i] = clip[i].z * tri.InvW[i] * 0.5f + 0.5f;
+            tri.Vertex[i] = original[i];
+            tri.Weights[i] = weights[i];
+        }
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (!(std::fabs(area) > 0.0f) || !std::isfinite(area))
+            return;
+        // sin culling de caras: los de espaldas se dan vuelta para que los bordes den positivo adentro
+        if (area < 0.0f) {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            std::swap(tri.InvW[1], tri.InvW[2]);
+            std::swap(tri.Weights[1], tri.Weights[2]);
+            area = -area;
+        }
+
+        // pixeles cuyo centro puede caer adentro
+        tri.MinX = std::max((int)std::ceil(std::min(std::min(x[0], x[1]), x[2]) - 0.5f), 0);
+        tri.MinY = std::max((int)std::ceil(std::min(std::min(y[0], y[1]), y[2]) - 0.5f), 0);
+        tri.MaxX = std::min((int)std::floor(std::max(std::max(x[0], x[1]), x[2]) - 0.5f), width - 1);
+        tri.MaxY = std::min((int)std::floor(std::max(std::max(y[0], y[1]), y[2]) - 0.5f), height - 1);
+        if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+            return;
+
+        // un borde compartido da en los dos triangulos coeficientes exactamente opuestos (las mismas cuentas con
+        // los extremos cambiados), asi que E tambien es exactamente opuesto y la regla de empate lo pinta una vez
+        float invArea = 1.0f / area;
+        tri.Zx = tri.Zy = tri.Zc = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            int a = (i + 1) % 3, b = (i + 2) % 3;
+            tri.A[i] = y[a] - y[b];
+            tri.B[i] = x[b] - x[a];
+            tri.C[i] = x[a] * y[b] - x[b] * y[a];
+            tri.Inclusive[i] = tri.A[i] > 0.0f || (tri.A[i] == 0.0f && tri.B[i] > 0.0f) ? 0xFFFFFFFFu : 0u;
+            tri.Zx += tri.A[i] * z[i] * invArea;
+            tri.Zy += tri.B[i] * z[i] * invArea;
+            tri.Zc += tri.C[i] * z[i] * invArea;
+        }
+        tri.ZMin = std::min(std::min(z[0], z[1]), z[2]);
+
+        std::vector<Triangle>& out = chunkTriangles[chunk];
+        uint32_t local = (uint32_t)out.size();
+        out.push_back(tri);
+        size_t tileBase = chunk * (size_t)tilesX * tilesY;
+        for (int ty = tri.MinY / TILE; ty <= tri.MaxY / TILE; ++ty)
+            for (int tx = tri.MinX / TILE; tx <= tri.MaxX / TILE; ++tx)
+                tileBins[tileBase + (size_t)ty * tilesX + tx].push_back(local);
+    }
+
+    void rasterTile(size_t tile, size_t chunks, size_t& tested, size_t& culled)
+    {
+        const int blocksPerSide = TILE / BLOCK;
+        int tileX = (int)(tile % tilesX) * TILE, tileY = (int)(tile / tilesX) * TILE;
+        for (int y = 0; y < TILE; ++y) {
+            size_t row = (size_t)(tileY + y) * paddedWidth + tileX;
+            std::fill(depth.begin() + row, depth.begin() + row + TILE, 1.0f);
+            std::fill(visibility.begin() + row, visibility.begin() + row + TILE, (uint32_t)NONE);
+        }
+        float blockMax[blocksPerSide * blocksPerSide];
+        std::fill(blockMax, blockMax + blocksPerSide * blocksPerSide, 1.0f);
+        float tileMax = 1.0f;
+
+        size_t tileCount = (size_t)tilesX * tilesY;
+        for (size_t c = 0; c < chunks; ++c) {
+            for (uint32_t local : tileBins[c * tileCount + tile]) {
+                uint32_t id = (uint32_t)(chunkStart[c] + local);
+                const Triangle& tri = triangles[id];
+                // profundidad jerarquica: nada del tile esta mas lejos que el triangulo
+                if (tri.ZMin >= tileMax) {
+                    ++culled;
+                    continue;
+                }
+                int bx0 = (std::max(tri.MinX, tileX) - tileX) / BLOCK, bx1 = (std::min(tri.MaxX, tileX + TILE - 1) - tileX) / BLOCK;
+                int by0 = (std::max(tri.MinY, tileY) - tileY) / BLOCK, by1 = (std::min(tri.MaxY, tileY + TILE - 1) - tileY) / BLOCK;
+                bool wrote = false;
+                for (int by = by0; by <= by1; ++by)
+                    for (int bx = bx0; bx <= bx1; ++bx) {
+                        ++tested;
+                        float& bmax = blockMax[by * blocksPerSide + bx];
+                        int px = tileX + bx * BLOCK, py = tileY + by * BLOCK;
+                        if (tri.ZMin >= bmax || !touchesBlock(tri, px, py)) {
+                            ++culled;
+                            continue;
+                        }
+                        if (rasterBlock(tri, id, px, py)) {
+                            wrote = true;
+                            float farthest = 0.0f;
+                            for (int y = 0; y < BLOCK; ++y) {
+                                const float* d = depth.data() + (size_t)(py + y) * paddedWidth + px;
+                                for (int x = 0; x < BLOCK; ++x)
+                                    farthest = std::max(farthest, d[x]);
+                            }
+                            bmax = farthest;
+                        }
+                    }
+                if (wrote)
+                    tileMax = *std::max_element(blockMax, blockMax + blocksPerSide * blocksPerSide);
+            }
+        }
+    }
+
+    // false si el bloque queda entero afuera de algun borde (se prueba su esquina mas favorable, con margen)
+    static bool touchesBlock(const Triangle& tri, int px, int py)
+    {
+        for (int i = 0; i < 3; ++i) {
+            float x = px + (tri.A[i] > 0.0f ? BLOCK - 0.5f : 0.5f);
+            float y = py + (tri.B[i] > 0.0f ? BLOCK - 0.5f : 0.5f);
+            float e = tri.A[i] * x + (tri.B[i] * y + tri.C[i]);
+            if (e < -1e-3f * (std::fabs(tri.A[i]) + std::fabs(tri.B[i])))
+                return false;
+        }
+        return true;
+    }
+
+    // pinta el bloque de BLOCK x BLOCK con origen (px, py); true si escribio algun pixel. Solo recorre las filas
+    // y los grupos de 4 columnas que toca la caja del triangulo (la mayoria mide unos pocos pixeles)
+    bool rasterBlock(const Triangle& tri, uint32_t id, int px, int py)
+    {
+        bool wrote = false;
+        int y0 = std::max(tri.MinY - py, 0), y1 = std::min(tri.MaxY - py, BLOCK - 1);
+#ifdef CPU_RASTER_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128i ids = _mm_set1_epi32((int)id);
+        __m128 a[3], inclusive[3];
+        for (int i = 0; i < 3; ++i) {
+            a[i] = _mm_set1_ps(tri.A[i]);
+            inclusive[i] = _mm_castsi128_ps(_mm_set1_epi32((int)tri.Inclusive[i]));
+        }
+        const __m128 zx = _mm_set1_ps(tri.Zx);
+        int x0 = std::max(tri.MinX - px, 0) & ~3, x1 = std::min(tri.MaxX - px, BLOCK - 1);
+        for (int y = y0; y <= y1; ++y) {
+            float fy = py + y + 0.5f;
+            __m128 rowTerm[3];
+            for (int i = 0; i < 3; ++i)
+                rowTerm[i] = _mm_set1_ps(tri.B[i] * fy + tri.C[i]);
+            __m128 zRow = _mm_set1_ps(tri.Zy * fy + tri.Zc);
+            float* d = depth.data() + (size_t)(py + y) * paddedWidth + px;
+            uint32_t* v = visibility.data() + (size_t)(py + y) * paddedWidth + px;
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 fx = _mm_add_ps(_mm_set1_ps((float)(px + x)), lane);
+                __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int i = 0; i < 3; ++i) {
+                    __m128 e = _mm_add_ps(_mm_mul_ps(a[i], fx), rowTerm[i]);
+                    __m128 inside = _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), inclusive[i]));
+                    mask = _mm_and_ps(mask, inside);
+                }
+                __m128 z = _mm_add_ps(_mm_mul_ps(zx, fx), zRow);
+                __m128 stored = _mm_loadu_ps(d + x);
+                mask = _mm_and_ps(mask, _mm_cmplt_ps(z, stored));
+                if (_mm_movemask_ps(mask) == 0)
+                    continue;
+                _mm_storeu_ps(d + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, stored)));
+                __m128i maskInt = _mm_castps_si128(mask);
+                __m128i visible = _mm_loadu_si128((const __m128i*)(v + x));
+                _mm_storeu_si128((__m128i*)(v + x), _mm_or_si128(_mm_and_si128(maskInt, ids), _mm_andnot_si128(maskInt, visible)));
+                wrote = true;
+            }
+        }
+#else
+        int x0 = std::max(tri.MinX - px, 0), x1 = std::min(tri.MaxX - px, BLOCK - 1);
+        for (int y = y0; y <= y1; ++y) {
+            float fy = py + y + 0.5f;
+            float* d = depth.data() + (size_t)(py + y) * paddedWidth + px;
+            uint32_t* v = visibility.data() + (size_t)(py + y) * paddedWidth + px;
+            for (int x = x0; x <= x1; ++x) {
+                float fx = px + x + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < 3 && inside; ++i) {
+                    float e = tri.A[i] * fx + (tri.B[i] * fy + tri.C[i]);
+                    inside = e > 0.0f || (e == 0.0f && tri.Inclusive[i] != 0);
+                }
+                float z = tri.Zx * fx + (tri.Zy * fy + tri.Zc);
+                if (inside && z < d[x]) {
+                    d[x] = z;
+                    v[x] = id;
+                    wrote = true;
+                }
+            }
+        }
+#endif
+        return wrote;
+    }
+
+    // atributos del pixel (x, y) como los deja gbuffer.frag, interpolados con correccion de perspectiva
+    void resolve(int x, int y)
+    {
+        size_t out = (size_t)y * Target.Width + x;
+        size_t in = (size_t)y * paddedWidth + x;
+        uint8_t* albedo = Target.Albedo.data() + 4 * out;
+        uint32_t id = visibility[in];
+        if (id == NONE) {
+            Target.Position[out] = glm::vec3(0.0f, 0.0f, 1.0f);     // GBUFFER_BACKGROUND
+            Target.Normal[out] = glm::vec3(0.0f);
+            albedo[0] = albedo[1] = albedo[2] = albedo[3] = 0;
+            Target.Depth[out] = 1.0f;
+            Target.Coverage[out] = 0;
+            return;
+        }
+        const Triangle& tri = triangles[id];
+        float fx = x + 0.5f, fy = y + 0.5f;
+        float p[3], sum = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            p[i] = std::max(tri.A[i] * fx + (tri.B[i] * fy + tri.C[i]), 0.0f) * tri.InvW[i];
+            sum += p[i];
+        }
+        glm::vec3 screen = sum > 0.0f ? glm::vec3(p[0], p[1], p[2]) / sum : glm::vec3(1.0f / 3.0f);
+        glm::vec3 w = tri.Weights[0] * screen.x + tri.Weights[1] * screen.y + tri.Weights[2] * screen.z;
+        const ShadedVertex& v0 = vertices[tri.Vertex[0]];
+        const ShadedVertex& v1 = vertices[tri.Vertex[1]];
+        const ShadedVertex& v2 = vertices[tri.Vertex[2]];
+
+        Target.Position[out] = v0.View * w.x + v1.View * w.y + v2.View * w.z;
+        glm::vec3 normal = v0.Normal * w.x + v1.Normal * w.y + v2.Normal * w.z;
+        float length = glm::length(normal);
+        Target.Normal[out] = encodeNormal(length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f));
+        float ao = glm::clamp(v0.AO * w.x + v1.AO * w.y + v2.AO * w.z, 0.0f, 1.0f);
+        albedo[0] = albedo[1] = albedo[2] = (uint8_t)(0.95f * 255.0f + 0.5f);
+        albedo[3] = (uint8_t)(ao * 255.0f + 0.5f);
+        Target.Depth[out] = depth[in];
+        Target.Coverage[out] = 1;
+    }
+
+    // encodeNormal de normal_encoding.glsl
+    glm::vec3 encodeNormal(glm::vec3 n) const
+    {
+        if (!OctahedralNormals)
+            return n;
+        n /= std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+        if (n.z < 0.0f) {
+            glm::vec2 wrapped((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+            n.x = wrapped.x;
+            n.y = wrapped.y;
+        }
+        return glm::vec3(n.x, n.y, 0.0f);
+    }
+};
+#endif
@@ -0,0 +1,83 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <vector>
+
+// Decide por modelo si conviene un depth pre-pass antes del g-buffer.
+// El pre-pass cuesta un segundo recorrido de vertices (con el stream de solo posiciones) y a cambio
+// el g-buffer corre con GL_EQUAL: cada pixel escribe los 3 MRT una sola vez. Conviene cuando hay
+// mucho overdraw (modelos cerrados o grillas densas vistas de frente) y no cuando la geometria es
+// pesada pero casi sin superposicion.
+// En modo AUTO se mide el tiempo de GPU del pase de geometria con y sin pre-pass para cada modelo y
+// se elige el mas rapido, volviendo a medir la alternativa cada PROBE_INTERVAL pases de geometria del
+// modelo (con el render incremental el pase no corre en todos los frames: se cuentan los pases, no los frames).
+class DepthPrepassAdvisor
+{
+public:
+    enum { OFF = 0, ON = 1, AUTO = 2 };
+    int Mode = OFF;
+
+    struct Stats {
+        float Ms[2] = { 0.0f, 0.0f };   // tiempo suavizado sin [0] y con [1] pre-pass
+        int Samples[2] = { 0, 0 };
+        unsigned long long Passes = 0;  // pases de geometria que se decidieron en AUTO
+    };
+    std::vector<Stats> PerModel;
+
+    // decide para el pase de geometria que esta por correr (una llamada por pase)
+    bool Use(int model)
+    {
+        if (Mode != AUTO)
+            return Mode == ON;
+        Stats& s = stats(model);
+        ++s.Passes;
+        // primero juntamos algunas muestras de cada variante, alternando
+        if (s.Samples[0] < WARMUP || s.Samples[1] < WARMUP)
+            return s.Samples[1] < s.Samples[0];
+        bool best = Faster(model);
+        // cada tanto se prueba la otra opcion, por si cambio la vista o la escena
+        if (s.Passes % PROBE_INTERVAL == 0)
+            return !best;
+        return best;
+    }
+
+    // true si con las mediciones actuales el pre-pass es mas rapido para el modelo
+    bool Faster(int model)
+    {
+        Stats& s = stats(model);
+        return s.Samples[1] > 0 && (s.Samples[0] == 0 || s.Ms[1] < s.Ms[0]);
+    }
+
+    // registra una medicion (tag = Tag(model, prepass))
+    void Record(int tag, float ms)
+    {
+        Stats& s = stats(tag / 2);
+        int v = tag % 2;
+        s.Ms[v] = s.Samples[v] == 0 ? ms : s.Ms[v] + (ms - s.Ms[v]) * 0.1f;
+        ++s.Samples[v];
+    }
+
+    // para usar con GpuTimer::Begin
+    static int Tag(int model, bool prepass)
+    {
+        return model * 2 + (prepass ? 1 : 0);
+    }
+
+    // olvidar las mediciones (p.ej. al cambiar la escena)
+    void Reset()
+    {
+        PerModel.clear();
+    }
+
+private:
+    static const int WARMUP = 8;
+    static const int PROBE_INTERVAL = 64;
+
+    Stats& stats(int model)
+    {
+        if ((int)PerModel.size() <= model)
+            PerModel.resize(model + 1);
+        return PerModel[model];
+    }
+};
+#endif
@@ -0,0 +1,80 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Controlador de resolucion dinamica: ajusta la escala de la resolucion interna (y, si eso no
+// alcanza, la cantidad de muestras de SSAO) para acercar el tiempo de GPU al presupuesto TargetMs.
+class DynamicResolution
+{
+public:
+    bool Enabled = false;
+    float TargetMs = 16.6f;
+    // escala por eje de la resolucion interna respecto a la ventana
+    float Scale = 1.0f;
+    float MinScale = 0.5f;
+    float MaxScale = 1.0f;
+    // fraccion de samplesNum que se usa en el SSAO
+    float SampleScale = 1.0f;
+    float MinSampleScale = 0.25f;
+    // tiempo de GPU suavizado
+    float SmoothedMs = 0.0f;
+
+    // llamar una vez por frame con el ultimo tiempo de GPU medido
+    void Update(float gpuMs)
+    {
+        if (!Enabled) {
+            Scale = MaxScale;
+            SampleScale = 1.0f;
+            SmoothedMs = gpuMs;
+            return;
+        }
+        if (gpuMs <= 0.0f)
+            return;
+        SmoothedMs = SmoothedMs <= 0.0f ? gpuMs : glm::mix(SmoothedMs, gpuMs, 0.1f);
+
+        // esperamos unos frames entre cambios para que la medicion refleje la escala nueva
+        if (++framesSinceChange < COOLDOWN)
+            return;
+
+        // el costo es proporcional a la cantidad de pixeles -> escala por eje ~ sqrt(ratio)
+        float ratio = TargetMs / SmoothedMs;
+        if (ratio < 0.95f) {
+            // pasados del presupuesto: primero bajamos resolucion, despues muestras
+            if (Scale > MinScale)
+                Scale = std::max(MinScale, Scale * glm::clamp(std::sqrt(ratio), 0.85f, 0.98f));
+            else
+                SampleScale = std::max(MinSampleScale, SampleScale * glm::clamp(ratio, 0.75f, 0.95f));
+            framesSinceChange = 0;
+        }
+        else if (ratio > 1.15f) {
+            // sobra tiempo: recuperamos en orden inverso y de a pasos chicos (histeresis)
+            if (SampleScale < 1.0f)
+                SampleScale = std::min(1.0f, SampleScale * 1.1f);
+            else if (Scale < MaxScale)
+                Scale = std::min(MaxScale, Scale * std::min(std::sqrt(ratio), 1.05f));
+            framesSinceChange = 0;
+        }
+    }
+
+    // resolucion interna para una ventana de width x height
+    glm::ivec2 InternalSize(int width, int height) const
+    {
+        return glm::ivec2(std::max(1, (int)std::lround(width * Scale)), std::max(1, (int)std::lround(height * Scale)));
+    }
+
+    // muestras de SSAO efectivas para una cantidad pedida
+    int Samples(int requested) const
+    {
+        return std::max(1, (int)std::lround(requested * SampleScale));
+    }
+
+private:
+    static const int COOLDOWN = 8;
+    int framesSinceChange = 0;
+};
+#endif
@@ -0,0 +1,85 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Render incremental: decide que etapas del frame hay que rehacer. Cada etapa tiene una firma con todo lo que
+// afecta su salida (camara, escena, parametros); si es igual a la del frame anterior, la salida guardada (en
+// texturas persistentes del frame graph) sigue valida y la etapa se saltea. Las etapas van en cadena: si cambia
+// la geometria se rehace la oclusion, y si cambia la oclusion, la iluminacion.
+class FrameCache
+{
+public:
+    enum Stage { GEOMETRY = 0, AO = 1, LIGHTING = 2, STAGES = 3 };
+
+    // firma de una etapa: los valores que la afectan, en un orden fijo
+    class Key
+    {
+    public:
+        Key& Add(float v)
+        {
+            values.push_back(v);
+            return *this;
+        }
+        Key& Add(int v)
+        {
+            return Add((float)v);
+        }
+        Key& Add(bool v)
+        {
+            return Add(v ? 1.0f : 0.0f);
+        }
+        Key& Add(const glm::mat4& m)
+        {
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r)
+                    Add(m[c][r]);
+            return *this;
+        }
+
+        bool operator==(const Key& o) const
+        {
+            return values == o.values;
+        }
+
+    private:
+        std::vector<float> values;
+    };
+
+    // frames seguidos en que cada etapa se reuso (0: corrio en el ultimo)
+    unsigned long long Reused[STAGES] = { 0, 0, 0 };
+
+    // compara las firmas de este frame con las guardadas. Con enabled = false todo se rehace y lo guardado se
+    // olvida (las texturas dejan de ser persistentes)
+    void Update(bool enabled, const Key& geometry, const Key& ao, const Key& lighting)
+    {
+        const Key* current[STAGES] = { &geometry, &ao, &lighting };
+        bool dirty = !enabled || !valid;
+        for (int s = 0; s < STAGES; ++s) {
+            dirty = dirty || !(keys[s] == *current[s]);
+            this->dirty[s] = dirty;
+            Reused[s] = dirty ? 0 : Reused[s] + 1;
+            keys[s] = *current[s];
+        }
+        valid = enabled;
+    }
+
+    bool Dirty(Stage stage) const
+    {
+        return dirty[stage];
+    }
+
+    // lo guardado ya no vale (p.ej. cambio algo que las firmas no ven, como un bake)
+    void Invalidate()
+    {
+        valid = false;
+    }
+
+private:
+    Key keys[STAGES];
+    bool dirty[STAGES] = { true, true, true };
+    bool valid = false;
+};
+#endif
@@ -0,0 +1,347 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include "utils/gl_state.h"
+#include "utils/memory_stats.h"
+
+#if defined(__has_include)
+#if __has_include(<stb_image_write.h>)
+#define FRAME_CAPTURE_PNG
+#endif
+#endif
+
+#ifdef FRAME_CAPTURE_PNG
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Captura asincronica de framebuffers (frame final, oclusion o targets del g-buffer) sin frenar el render loop.
+// Read() solo encola un glReadPixels hacia un pixel buffer object del anillo y pone un fence; Update()
+// (una vez por frame) mapea los PBOs cuyo fence ya se cumplio, al menos Latency frames despues, copia los
+// pixeles y se los pasa a un hilo que codifica y escribe el archivo. Si el anillo esta lleno la captura
+// se descarta (Dropped) en vez de esperar a la GPU; si el hilo va atrasado, los PBOs quedan sin mapear
+// hasta que se libere la cola.
+class FrameCapture
+{
+public:
+    enum Encoding { PNG = 0, PFM = 1, RAW = 2 };   // PNG de 8 bits, PFM de floats, bytes crudos
+
+    int Latency = 2;            // frames minimos entre el glReadPixels y el mapeo
+    size_t MaxQueued = 32;      // capturas esperando al hilo codificador
+
+    // estadisticas
+    unsigned long long Requested = 0, Dropped = 0;
+    std::atomic<unsigned long long> Written{ 0 }, Failed{ 0 };   // los actualiza el hilo codificador
+
+    FrameCapture(int ring = 6) : slots(ring > 0 ? ring : 1) {}
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    ~FrameCapture()
+    {
+        stopWorker();
+    }
+
+    // encola la lectura de w x h pixeles del color 'attachment' de 'fbo' (0 = ventana, GL_BACK).
+    // channels es 1 o 3; los PNG se leen en bytes y los PFM en floats, RAW segun floatData.
+    // 'path' va sin extension: la agrega el codificador. Devuelve false si no habia PBO libre.
+    bool Read(unsigned int fbo, GLenum attachment, int w, int h, int channels, bool floatData, Encoding encoding, const std::string& path)
+    {
+        ++Requested;
+        Slot& slot = slots[head];
+        if (slot.Pending || w <= 0 || h <= 0) {
+            ++Dropped;
+            return false;
+        }
+        Job& job = slot.Request;
+        job.Width = w;
+        job.Height = h;
+        job.Channels = channels == 1 ? 1 : 3;
+        job.Float = encoding == PFM || (encoding == RAW && floatData);
+        job.Enc = encoding;
+        job.Path = path;
+        size_t bytes = job.Size();
+
+        if (slot.PBO == 0)
+            glGenBuffers(1, &slot.PBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+        if (slot.Bytes != bytes) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+            slot.Bytes = bytes;
+        }
+        GLState::Get().BindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glReadBuffer(fbo == 0 ? GL_BACK : attachment);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, w, h, job.Channels == 1 ? GL_RED : GL_RGB, job.Float ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.Frame = frame;
+        slot.Pending = true;
+        head = (head + 1) % slots.size();
+        return true;
+    }
+
+    // encola pixeles que ya estan en RAM (p.ej. el g-buffer de CpuRasterizer), con el mismo formato que dejaria
+    // Read: filas de abajo hacia arriba, 1 o 3 canales, bytes o floats segun la codificacion. No toca GL
+    bool Write(const void* pixels, int w, int h, int channels, bool floatData, Encoding encoding, const std::string& path)
+    {
+        ++Requested;
+        if (w <= 0 || h <= 0) {
+            ++Dropped;
+            return false;
+        }
+        Job job;
+        job.Width = w;
+        job.Height = h;
+        job.Channels = channels == 1 ? 1 : 3;
+        job.Float = encoding == PFM || (encoding == RAW && floatData);
+        job.Enc = encoding;
+        job.Path = path;
+        job.Pixels.assign((const unsigned char*)pixels, (const unsigned char*)pixels + job.Size());
+        startWorker();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(job));
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    // una vez por frame: entrega al hilo codificador las lecturas que ya termino la GPU (nunca espera)
+    void Update()
+    {
+        ++frame;
+        drain(false);
+    }
+
+    // espera las lecturas que estan en la GPU y se las pasa al codificador (modos batch, sin loop de frames)
+    void Flush()
+    {
+        drain(true);
+    }
+
+    // capturas en vuelo (en la GPU o esperando al codificador)
+    size_t Pending() const
+    {
+        size_t n = 0;
+        for (const Slot& slot : slots)
+            n += slot.Pending ? 1 : 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        return n + queue.size() + (busy ? 1 : 0);
+    }
+
+    // PBOs del anillo (GPU) y capturas esperando al codificador (CPU)
+    MemoryUsage Memory() const
+    {
+        MemoryUsage usage;
+        for (const Slot& slot : slots)
+            usage.Gpu += slot.Bytes;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Job& job : queue)
+            usage.Cpu += job.Pixels.capacity();
+        return usage;
+    }
+
+    // espera las capturas pendientes (al salir, para no perder el final de una secuencia) y libera los PBOs
+    void Clear()
+    {
+        drain(true);
+        stopWorker();
+        for (Slot& slot : slots) {
+            if (slot.PBO != 0)
+                glDeleteBuffers(1, &slot.PBO);
+            slot = Slot();
+        }
+        head = tail = 0;
+    }
+
+    static const char* Extension(Encoding encoding)
+    {
+        return encoding == PNG ? (pngSupported() ? ".png" : ".ppm") : encoding == PFM ? ".pfm" : ".raw";
+    }
+
+private:
+    struct Job
+    {
+        int Width = 0, Height = 0, Channels = 3;
+        bool Float = false;
+        Encoding Enc = PNG;
+        std::string Path;
+        std::vector<unsigned char> Pixels;
+
+        size_t Size() const
+        {
+            return (size_t)Width * Height * Channels * (Float ? sizeof(float) : 1);
+        }
+    };
+
+    struct Slot
+    {
+        unsigned int PBO = 0;
+        size_t Bytes = 0;
+        GLsync Fence = nullptr;
+        unsigned long long Frame = 0;
+        bool Pending = false;
+        Job Request;
+    };
+
+    std::vector<Slot> slots;
+    size_t head = 0, tail = 0;      // proximo slot a escribir / mas viejo pendiente
+    unsigned long long frame = 0;
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue;
+    bool busy = false, stopping = false;
+
+    static bool pngSupported()
+    {
+#ifdef FRAME_CAPTURE_PNG
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // mapea en orden de pedido; con wait = false corta en la primera lectura que no esta lista
+    void drain(bool wait)
+    {
+        while (slots[tail].Pending) {
+            Slot& slot = slots[tail];
+            if (!wait) {
+                if (frame - slot.Frame < (unsigned long long)Latency)
+                    break;
+                GLenum status = glClientWaitSync(slot.Fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                    break;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (queue.size() >= MaxQueued)
+                    break;
+            }
+            else {
+                glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            }
+            glDeleteSync(slot.Fence);
+            slot.Fence = nullptr;
+
+            Job job = slot.Request;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+            const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.Bytes, GL_MAP_READ_BIT);
+            if (data != nullptr) {
+                job.Pixels.resize(slot.Bytes);
+                std::memcpy(job.Pixels.data(), data, slot.Bytes);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            slot.Pending = false;
+            tail = (tail + 1) % slots.size();
+
+            if (job.Pixels.empty()) {
+                ++Failed;
+                continue;
+            }
+            startWorker();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(std::move(job));
+            }
+            wake.notify_one();
+        }
+    }
+
+    void startWorker()
+    {
+        if (worker.joinable())
+            return;
+        stopping = false;
+        worker = std::thread([this]() {
+            for (;;) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+                    if (queue.empty())
+                        return;     // stopping y sin trabajo
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                    busy = true;
+                }
+                bool ok = write(job);
+                std::lock_guard<std::mutex> lock(mutex);
+                busy = false;
+                ++(ok ? Written : Failed);
+            }
+        });
+    }
+
+    // termina de escribir lo encolado y cierra el hilo
+    void stopWorker()
+    {
+        if (!worker.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    // corre en el hilo codificador. Las filas de GL vienen de abajo hacia arriba
+    static bool write(const Job& job)
+    {
+        std::error_code ec;
+        std::filesystem::path dir = std::filesystem::path(job.Path).parent_path();
+        if (!dir.empty())
+            std::filesystem::create_directories(dir, ec);
+        std::string file = job.Path + Extension(job.Enc);
+
+        if (job.Enc == PNG) {
+#ifdef FRAME_CAPTURE_PNG
+            size_t stride = (size_t)job.Width * job.Channels;
+            std::vector<unsigned char> flipped(job.Pixels.size());
+            for (int y = 0; y < job.Height; ++y)
+                std::memcpy(flipped.data() + y * stride, job.Pixels.data() + (job.Height - 1 - y) * stride, stride);
+            return stbi_write_png(file.c_str(), job.Width, job.Height, job.Channels, flipped.data(), (int)stride) != 0;
+#else
+            // sin stb_image_write: PGM/PPM binario
+            FILE* f = std::fopen(file.c_str(), "wb");
+            if (!f)
+                return false;
+            std::fprintf(f, "P%d\n%d %d\n255\n", job.Channels == 1 ? 5 : 6, job.Width, job.Height);
+            size_t stride = (size_t)job.Width * job.Channels;
+            bool ok = true;
+            for (int y = job.Height - 1; y >= 0 && ok; --y)
+                ok = std::fwrite(job.Pixels.data() + y * stride, 1, stride, f) == stride;
+            return std::fclose(f) == 0 && ok;
+#endif
+        }
+
+        FILE* f = std::fopen(file.c_str(), "wb");
+        if (!f)
+            return false;
+        if (job.Enc == PFM) {
+            // PFM guarda las filas de abajo hacia arriba, igual que GL; escala negativa = little endian
+            std::fprintf(f, "%s\n%d %d\n-1.0\n", job.Channels == 1 ? "Pf" : "PF", job.Width, job.Height);
+        }
+        bool ok = std::fwrite(job.Pixels.data(), 1, job.Pixels.size(), f) == job.Pixels.size();
+        return std::fclose(f) == 0 && ok;
+    }
+};
+#endif
@@ -0,0 +1,492 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <glad/glad.h>
+
+#include "utils/gl_state.h"
+#include "utils/memory_stats.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Frame graph: cada frame se declaran los pases con las texturas que leen y escriben.
+// Compile:
+//   1. ordena los pases (quien escribe un recurso va antes de quien lo lee)
+//   2. descarta los pases cuyas salidas nadie usa (los que escriben la ventana son las raices)
+//   3. calcula la vida de cada textura transitoria (primer y ultimo pase que la usa) y le asigna una
+//      textura fisica de un pool: recursos con la misma descripcion y vidas disjuntas comparten textura
+// Execute corre los pases vivos en orden, con el framebuffer de sus escrituras ya enlazado (mas el depth/stencil
+// que el pase pida con DepthStencil, p.ej. para limitarse con el stencil a lo que marco el geometry pass).
+// Las texturas transitorias no conservan su contenido entre frames: cada pase limpia o pisa lo que escribe.
+// Las persistentes (Persistent) quedan fuera del pool y si lo conservan, para reusar resultados de frames anteriores.
+class FrameGraph
+{
+public:
+    typedef int Resource;
+
+    struct TextureDesc
+    {
+        int Width = 0, Height = 0;
+        GLint InternalFormat = GL_RGBA8;
+        GLenum Format = GL_RGBA, Type = GL_UNSIGNED_BYTE;
+        GLint Filter = GL_NEAREST;
+
+        TextureDesc() {}
+        TextureDesc(int width, int height, GLint internalFormat, GLenum format, GLenum type, GLint filter = GL_NEAREST)
+            : Width(width), Height(height), InternalFormat(internalFormat), Format(format), Type(type), Filter(filter) {}
+
+        bool operator==(const TextureDesc& o) const
+        {
+            return Width == o.Width && Height == o.Height && InternalFormat == o.InternalFormat && Filter == o.Filter;
+        }
+
+        bool IsDepth() const
+        {
+            return Format == GL_DEPTH_COMPONENT || Format == GL_DEPTH_STENCIL;
+        }
+
+        size_t Bytes() const
+        {
+            return (size_t)Width * Height * bytesPerPixel(InternalFormat);
+        }
+    };
+
+    struct Pass
+    {
+        std::string Name;
+        std::vector<Resource> Reads, Writes;
+        Resource DepthStencil = -1;     // attachment de solo lectura (tambien esta en Reads)
+        bool SideEffect = false;
+        bool Culled = false;
+        std::function<void(FrameGraph&)> Execute;
+    };
+
+    // lo que un pase declara en su setup
+    class PassBuilder
+    {
+    public:
+        Resource Read(Resource r)
+        {
+            if (r >= 0)
+                pass.Reads.push_back(r);
+            return r;
+        }
+        Resource Write(Resource r)
+        {
+            if (r >= 0)
+                pass.Writes.push_back(r);
+            return r;
+        }
+        // depth/stencil del framebuffer del pase sin escribirlo: cuenta como lectura (el pase no tiene que
+        // cambiar depth ni stencil, solo testear)
+        Resource DepthStencil(Resource r)
+        {
+            if (r >= 0) {
+                pass.Reads.push_back(r);
+                pass.DepthStencil = r;
+            }
+            return r;
+        }
+        // el pase se ejecuta aunque nadie lea lo que escribe (p.ej. lecturas a CPU)
+        void SideEffect()
+        {
+            pass.SideEffect = true;
+        }
+
+    private:
+        friend class FrameGraph;
+        Pass& pass;
+        PassBuilder(Pass& pass) : pass(pass) {}
+    };
+
+    // estadisticas del ultimo Compile
+    std::vector<std::string> ExecutedPasses, CulledPasses;
+    int VirtualTextures = 0, PhysicalTextures = 0;
+    size_t VirtualBytes = 0, PhysicalBytes = 0, PoolBytes = 0, PersistentBytes = 0;
+
+    FrameGraph() {}
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    // descarta los pases y recursos del frame anterior (el pool de texturas se conserva)
+    void Reset()
+    {
+        passes.clear();
+        resources.clear();
+        order.clear();
+        ++frame;
+    }
+
+    // textura transitoria: la crea el grafo, vive solo dentro del frame
+    Resource Create(const std::string& name, const TextureDesc& desc)
+    {
+        ResourceNode node;
+        node.Name = name;
+        node.Desc = desc;
+        resources.push_back(node);
+        return (Resource)resources.size() - 1;
+    }
+
+    // textura externa (ruido, etc.): el grafo solo la usa para ordenar
+    Resource Import(const std::string& name, unsigned int texture)
+    {
+        ResourceNode node;
+        node.Name = name;
+        node.Imported = true;
+        node.Texture = texture;
+        resources.push_back(node);
+        return (Resource)resources.size() - 1;
+    }
+
+    // textura persistente: la crea el grafo, pero con nombre propio y fuera del pool, asi lo que se escribe en un
+    // frame sigue ahi en los siguientes. Se recrea (sin contenido) si cambia la descripcion
+    Resource Persistent(const std::string& name, const TextureDesc& desc)
+    {
+        PersistentTexture& p = persistent[name];
+        if (p.Texture != 0 && !(p.Desc == desc)) {
+            releaseFramebuffers(p.Texture);
+            GLState::Get().DeleteTextures(1, &p.Texture);
+            p.Texture = 0;
+        }
+        if (p.Texture == 0) {
+            p.Desc = desc;
+            p.Texture = createTexture(desc);
+        }
+        p.LastFrame = frame;
+        Resource r = Import(name, p.Texture);
+        resources[r].Desc = desc;       // para elegir el attachment en Framebuffer
+        return r;
+    }
+
+    // framebuffer de la ventana: escribirlo hace al pase una raiz
+    Resource Backbuffer()
+    {
+        Resource r = Import("backbuffer", 0);
+        resources[r].Backbuffer = true;
+        return r;
+    }
+
+    void AddPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, const std::function<void(FrameGraph&)>& execute)
+    {
+        passes.emplace_back();
+        Pass& pass = passes.back();
+        pass.Name = name;
+        pass.Execute = execute;
+        PassBuilder builder(pass);
+        setup(builder);
+    }
+
+    void Compile()
+    {
+        sortPasses();
+        cullPasses();
+        allocate();
+    }
+
+    void Execute()
+    {
+        for (int p : order) {
+            Pass& pass = passes[p];
+            if (pass.Culled)
+                continue;
+            if (!pass.Writes.empty()) {
+                std::vector<Resource> attachments = pass.Writes;
+                if (pass.DepthStencil >= 0)
+                    attachments.push_back(pass.DepthStencil);
+                GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, Framebuffer(attachments));
+            }
+            pass.Execute(*this);
+        }
+        GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // textura fisica de un recurso (valido en Execute)
+    unsigned int Texture(Resource r) const
+    {
+        return r >= 0 ? resources[r].Texture : 0;
+    }
+
+    // framebuffer con esos recursos como attachments (los de depth van al depth o depth/stencil attachment);
+    // 0 para la ventana
+    unsigned int Framebuffer(const std::vector<Resource>& attachments)
+    {
+        std::vector<unsigned int> key;
+        for (Resource r : attachments) {
+            if (resources[r].Backbuffer)
+                return 0;
+            key.push_back(resources[r].Texture);
+        }
+        auto it = framebuffers.find(key);
+        if (it != framebuffers.end())
+            return it->second;
+
+        unsigned int fbo;
+        glGenFramebuffers(1, &fbo);
+        GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, fbo);
+        std::vector<unsigned int> drawBuffers;
+        for (Resource r : attachments) {
+            const ResourceNode& node = resources[r];
+            if (node.Desc.IsDepth()) {
+                GLenum attachment = node.Desc.Format == GL_DEPTH_STENCIL ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, node.Texture, 0);
+            }
+            else {
+                unsigned int attachment = GL_COLOR_ATTACHMENT0 + (unsigned int)drawBuffers.size();
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, node.Texture, 0);
+                drawBuffers.push_back(attachment);
+            }
+        }
+        if (drawBuffers.empty())
+            glDrawBuffer(GL_NONE);
+        else
+            glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Frame graph framebuffer not complete!" << std::endl;
+        framebuffers[key] = fbo;
+        return fbo;
+    }
+
+    // una entrada por textura del pool, con los recursos que la usaron en el ultimo frame
+    void Memory(MemoryReport& report) const
+    {
+        for (const PoolEntry& e : pool)
+            report.Add("Render targets", e.Users.empty() ? "(unused)" : e.Users, MemoryUsage(0, e.Desc.Bytes()));
+        for (const auto& p : persistent)
+            report.Add("Render targets", p.first + " (persistent)", MemoryUsage(0, p.second.Desc.Bytes()));
+    }
+
+    // libera todo el pool (p.ej. antes de destruir el contexto)
+    void Clear()
+    {
+        for (const PoolEntry& e : pool)
+            GLState::Get().DeleteTextures(1, &e.Texture);
+        pool.clear();
+        for (const auto& p : persistent)
+            GLState::Get().DeleteTextures(1, &p.second.Texture);
+        persistent.clear();
+        for (auto& f : framebuffers)
+            GLState::Get().DeleteFramebuffers(1, &f.second);
+        framebuffers.clear();
+        PoolBytes = PersistentBytes = 0;
+    }
+
+private:
+    struct ResourceNode
+    {
+        std::string Name;
+        TextureDesc Desc;
+        bool Imported = false, Backbuffer = false;
+        unsigned int Texture = 0;
+        int First = -1, Last = -1;      // posiciones en 'order' del primer y ultimo uso
+    };
+
+    struct PoolEntry
+    {
+        TextureDesc Desc;
+        unsigned int Texture = 0;
+        int BusyUntil = -1;             // ultimo pase (en 'order') del recurso que la ocupa este frame
+        unsigned long long LastFrame = 0;
+        std::string Users;              // recursos que la usaron el ultimo frame (varios si hubo aliasing)
+    };
+
+    struct PersistentTexture
+    {
+        TextureDesc Desc;
+        unsigned int Texture = 0;
+        unsigned long long LastFrame = 0;
+    };
+
+    // frames que una textura del pool (o persistente) puede quedar sin uso antes de liberarla
+    static const int KEEP_FRAMES = 120;
+
+    std::vector<Pass> passes;
+    std::vector<ResourceNode> resources;
+    std::vector<int> order;
+    std::vector<PoolEntry> pool;
+    std::map<std::string, PersistentTexture> persistent;
+    std::map<std::vector<unsigned int>, unsigned int> framebuffers;
+    unsigned long long frame = 0;
+
+    // orden topologico (Kahn); a igualdad se respeta el orden en que se agregaron los pases
+    void sortPasses()
+    {
+        size_t n = passes.size();
+        std::vector<std::vector<int>> writers(resources.size());
+        for (size_t p = 0; p < n; ++p)
+            for (Resource r : passes[p].Writes)
+                writers[r].push_back((int)p);
+
+        std::vector<std::vector<int>> next(n);
+        std::vector<int> incoming(n, 0);
+        for (size_t p = 0; p < n; ++p)
+            for (Resource r : passes[p].Reads)
+                for (int w : writers[r])
+                    if (w != (int)p) {
+                        next[w].push_back((int)p);
+                        ++incoming[p];
+                    }
+
+        order.clear();
+        std::vector<bool> done(n, false);
+        while (order.size() < n) {
+            int pick = -1;
+            for (size_t p = 0; p < n && pick < 0; ++p)
+                if (!done[p] && incoming[p] == 0)
+                    pick = (int)p;
+            if (pick < 0) {
+                // ciclo: se ejecutan en el orden en que se agregaron
+                std::cout << "Frame graph: cycle between passes" << std::endl;
+                for (size_t p = 0; p < n; ++p)
+                    if (!done[p]) {
+                        done[p] = true;
+                        order.push_back((int)p);
+                    }
+                break;
+            }
+            done[pick] = true;
+            order.push_back(pick);
+            for (int q : next[pick])
+                --incoming[q];
+        }
+    }
+
+    // de atras hacia adelante: un pase vive si tiene efectos o si un pase vivo lee algo que escribe
+    void cullPasses()
+    {
+        std::vector<bool> needed(resources.size(), false);
+        ExecutedPasses.clear();
+        CulledPasses.clear();
+        for (int i = (int)order.size() - 1; i >= 0; --i) {
+            Pass& pass = passes[order[i]];
+            bool alive = pass.SideEffect;
+            for (Resource r : pass.Writes)
+                alive = alive || needed[r] || resources[r].Backbuffer;
+            pass.Culled = !alive;
+            if (alive)
+                for (Resource r : pass.Reads)
+                    needed[r] = true;
+        }
+        for (int p : order)
+            (passes[p].Culled ? CulledPasses : ExecutedPasses).push_back(passes[p].Name);
+    }
+
+    // vidas de los recursos y asignacion de texturas fisicas del pool
+    void allocate()
+    {
+        for (size_t i = 0; i < order.size(); ++i) {
+            const Pass& pass = passes[order[i]];
+            if (pass.Culled)
+                continue;
+            for (const std::vector<Resource>* list : { &pass.Reads, &pass.Writes })
+                for (Resource r : *list) {
+                    ResourceNode& node = resources[r];
+                    if (node.First < 0)
+                        node.First = (int)i;
+                    node.Last = (int)i;
+                }
+        }
+
+        for (PoolEntry& e : pool)
+            e.BusyUntil = -1;
+        VirtualTextures = PhysicalTextures = 0;
+        VirtualBytes = PhysicalBytes = 0;
+        for (size_t i = 0; i < order.size(); ++i) {
+            // los recursos que empiezan en este pase toman una textura libre con la misma descripcion
+            for (ResourceNode& node : resources) {
+                if (node.Imported || node.First != (int)i)
+                    continue;
+                ++VirtualTextures;
+                VirtualBytes += node.Desc.Bytes();
+                PoolEntry* entry = nullptr;
+                for (PoolEntry& e : pool)
+                    if (e.BusyUntil < (int)i && e.Desc == node.Desc) {
+                        entry = &e;
+                        break;
+                    }
+                if (entry == nullptr) {
+                    pool.emplace_back();
+                    entry = &pool.back();
+                    entry->Desc = node.Desc;
+                    entry->Texture = createTexture(node.Desc);
+                }
+                if (entry->LastFrame != frame) {
+                    ++PhysicalTextures;
+                    PhysicalBytes += entry->Desc.Bytes();
+                    entry->Users = node.Name;
+                }
+                else {
+                    entry->Users += "+" + node.Name;
+                }
+                entry->BusyUntil = node.Last;
+                entry->LastFrame = frame;
+                node.Texture = entry->Texture;
+            }
+        }
+
+        // liberar las texturas que hace rato no se usan (cambios de tamanio, modos apagados)
+        PoolBytes = 0;
+        for (size_t e = 0; e < pool.size();) {
+            if (frame - pool[e].LastFrame > KEEP_FRAMES) {
+                releaseFramebuffers(pool[e].Texture);
+                GLState::Get().DeleteTextures(1, &pool[e].Texture);
+                pool.erase(pool.begin() + e);
+                continue;
+            }
+            PoolBytes += pool[e].Desc.Bytes();
+            ++e;
+        }
+        PersistentBytes = 0;
+        for (auto it = persistent.begin(); it != persistent.end();) {
+            if (frame - it->second.LastFrame > KEEP_FRAMES) {
+                releaseFramebuffers(it->second.Texture);
+                GLState::Get().DeleteTextures(1, &it->second.Texture);
+                it = persistent.erase(it);
+                continue;
+            }
+            PersistentBytes += it->second.Desc.Bytes();
+            ++it;
+        }
+    }
+
+    void releaseFramebuffers(unsigned int texture)
+    {
+        for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+            if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+                GLState::Get().DeleteFramebuffers(1, &it->second);
+                it = framebuffers.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    static unsigned int createTexture(const TextureDesc& desc)
+    {
+        unsigned int tex;
+        glGenTextures(1, &tex);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.InternalFormat, desc.Width, desc.Height, 0, desc.Format, desc.Type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.Filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.Filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return tex;
+    }
+
+    static size_t bytesPerPixel(GLint internalFormat)
+    {
+        switch (internalFormat) {
+        case GL_R8: return 1;
+        case GL_R16F: case GL_RG8: return 2;
+        case GL_RGBA8: case GL_RG16F: case GL_R32F: case GL_DEPTH_COMPONENT24: case GL_DEPTH24_STENCIL8: case GL_DEPTH_COMPONENT32F: return 4;
+        case GL_RGBA16F: case GL_RG32F: return 8;
+        case GL_RGBA32F: return 16;
+        default: return 4;
+        }
+    }
+};
+#endif
@@ -0,0 +1,93 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Los 6 planos de un frustum, extraidos de una matriz projection * view (Gribb-Hartmann).
+// Cada plano es (a, b, c, d) normalizado con la normal apuntando hacia adentro.
+struct Frustum
+{
+    glm::vec4 Planes[6];
+
+    static Frustum FromMatrix(const glm::mat4& m)
+    {
+        Frustum f;
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        f.Planes[0] = row3 + row0;  // left
+        f.Planes[1] = row3 - row0;  // right
+        f.Planes[2] = row3 + row1;  // bottom
+        f.Planes[3] = row3 - row1;  // top
+        f.Planes[4] = row3 + row2;  // near
+        f.Planes[5] = row3 - row2;  // far
+        for (glm::vec4& p : f.Planes)
+            p /= glm::length(glm::vec3(p.x, p.y, p.z));
+        return f;
+    }
+
+    bool SphereVisible(const glm::vec3& c, float r) const
+    {
+        for (const glm::vec4& p : Planes)
+            if (p.x * c.x + p.y * c.y + p.z * c.z + p.w < -r)
+                return false;
+        return true;
+    }
+
+    bool AabbVisible(const glm::vec3& mn, const glm::vec3& mx) const
+    {
+        // se prueba el vertice "positivo" de la caja contra cada plano
+        for (const glm::vec4& p : Planes) {
+            glm::vec3 v(p.x >= 0.0f ? mx.x : mn.x, p.y >= 0.0f ? mx.y : mn.y, p.z >= 0.0f ? mx.z : mn.z);
+            if (p.x * v.x + p.y * v.y + p.z * v.z + p.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // Culling de esferas en formato SoA: visible[i] = 1 si la esfera i toca el frustum.
+    // Procesa 4 esferas por iteracion con SSE2 (con fallback escalar).
+    void CullSpheres(const float* cx, const float* cy, const float* cz, const float* radius,
+                     uint8_t* visible, size_t begin, size_t end) const
+    {
+        size_t i = begin;
+#ifdef FRUSTUM_SSE
+        __m128 pa[6], pb[6], pc[6], pd[6];
+        for (int p = 0; p < 6; ++p) {
+            pa[p] = _mm_set1_ps(Planes[p].x);
+            pb[p] = _mm_set1_ps(Planes[p].y);
+            pc[p] = _mm_set1_ps(Planes[p].z);
+            pd[p] = _mm_set1_ps(Planes[p].w);
+        }
+        for (; i + 4 <= end; i += 4) {
+            __m128 x = _mm_loadu_ps(cx + i);
+            __m128 y = _mm_loadu_ps(cy + i);
+            __m128 z = _mm_loadu_ps(cz + i);
+            __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; ++p) {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[p], x), _mm_mul_ps(pb[p], y)),
+                                      _mm_add_ps(_mm_mul_ps(pc[p], z), pd[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+            }
+            int mask = _mm_movemask_ps(inside);
+            visible[i + 0] = (uint8_t)(mask & 1);
+            visible[i + 1] = (uint8_t)((mask >> 1) & 1);
+            visible[i + 2] = (uint8_t)((mask >> 2) & 1);
+            visible[i + 3] = (uint8_t)((mask >> 3) & 1);
+        }
+#endif
+        for (; i < end; ++i)
+            visible[i] = SphereVisible(glm::vec3(cx[i], cy[i], cz[i]), radius[i]) ? 1 : 0;
+    }
+};
+#endif
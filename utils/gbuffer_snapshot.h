@@ -0,0 +1,260 @@
+#ifndef GBUFFER_SNAPSHOT_H
+#define GBUFFER_SNAPSHOT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "utils/atomic_file.h"
+#include "utils/obj_loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Instantanea del g-buffer de un frame (.gbs) para medir los pases de SSAO aislados (--ssao-bench): lo que leen
+// SSAO, blur y lighting (gPosition, gNormal, gAlbedo y gDepth con el stencil de cobertura) tal como estaba en GL,
+// mas las matrices, el kernel, el ruido de rotacion y los parametros del frame. Al abrirla se mapea (MappedFile)
+// y las texturas se suben directo desde el mapeo, sin parsear ni copiar.
+//
+// Formato (little endian): el Header; despues cada seccion alineada a ALIGN bytes, donde dice Offset/Bytes. Las
+// secciones de imagen estan en el formato de glReadPixels (filas de abajo hacia arriba, sin padding):
+//   POSITION  RGB half            NORMAL  RG half (octaedricas) o RGB half      ALBEDO  RGBA8
+//   DEPTH     depth 24 + stencil 8 (GL_UNSIGNED_INT_24_8)
+//   KERNEL    KernelSize vec3       NOISE   NoiseSize x NoiseSize vec3
+// VERSION cambia con el layout; las de otra version se rechazan.
+class GBufferSnapshot
+{
+public:
+    enum Section { POSITION = 0, NORMAL, ALBEDO, DEPTH, KERNEL, NOISE, SECTIONS };
+    enum Flags { NORMAL_OCT = 1, SMOOTH = 2, ADAPTIVE = 4, BLUR = 8, COVERAGE = 16 };
+    static const uint32_t MAGIC = 0x4E534247;     // "GBSN"
+    static const uint32_t VERSION = 1;
+    static const uint64_t ALIGN = 4096;
+
+    // parametros del frame
+    int Width = 0, Height = 0;
+    glm::mat4 View = glm::mat4(1.0f), Projection = glm::mat4(1.0f);
+    int Samples = 16, MinSamples = 8, KernelSize = 16;      // muestras efectivas y la permutacion que las corria
+    float Radius = 0.5f, Bias = 0.01f, Intensity = 1.0f;
+    bool NormalOct = false, Smooth = false, Adaptive = false, Blur = false, Coverage = false;
+    int ExtraLights = 0; float LightsExtent = 0.0f;
+    int NoiseSize = 4;
+    std::vector<glm::vec3> Kernel;
+
+    GBufferSnapshot() {}
+    GBufferSnapshot(const GBufferSnapshot&) = delete;
+    GBufferSnapshot& operator=(const GBufferSnapshot&) = delete;
+
+    // los datos de una seccion (en el mapeo si se abrio, o en lo leido con Read)
+    const char* Data(Section section) const { return data[section]; }
+    uint64_t Bytes(Section section) const { return bytes[section]; }
+
+    // lee de GL los cuatro targets (cada framebuffer con el suyo pegado: color en GL_COLOR_ATTACHMENT0, gDepth
+    // como depth/stencil) en el rectangulo Width x Height, y la textura de ruido. Los parametros y el Kernel ya
+    // tienen que estar puestos. Es sincronico: frena el pipeline, pero es una captura puntual
+    void Read(unsigned int positionFBO, unsigned int normalFBO, unsigned int albedoFBO, unsigned int depthFBO, unsigned int noiseTexture)
+    {
+        mapped.reset();
+        KernelSize = (int)Kernel.size();
+        for (int s = 0; s < SECTIONS; ++s) {
+            owned[s].resize(sectionBytes((Section)s));
+            data[s] = owned[s].data();
+            bytes[s] = owned[s].size();
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        GLint previous = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+        auto readTarget = [&](unsigned int fbo, Section section, GLenum format, GLenum type) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+            glReadBuffer(format == GL_DEPTH_STENCIL ? GL_NONE : GL_COLOR_ATTACHMENT0);
+            glReadPixels(0, 0, Width, Height, format, type, owned[section].data());
+        };
+        readTarget(positionFBO, POSITION, GL_RGB, GL_HALF_FLOAT);
+        readTarget(normalFBO, NORMAL, NormalOct ? GL_RG : GL_RGB, GL_HALF_FLOAT);
+        readTarget(albedoFBO, ALBEDO, GL_RGBA, GL_UNSIGNED_BYTE);
+        readTarget(depthFBO, DEPTH, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        std::memcpy(owned[KERNEL].data(), Kernel.data(), owned[KERNEL].size());
+        GLint texture = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+        glBindTexture(GL_TEXTURE_2D, noiseTexture);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_FLOAT, owned[NOISE].data());
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    // crea el directorio si hace falta; con WriteFileAtomic nunca queda un .gbs a medias
+    bool Write(const std::string& path) const
+    {
+        Header header = {};
+        header.Magic = MAGIC;
+        header.Version = VERSION;
+        header.HeaderBytes = sizeof(Header);
+        header.Width = Width;
+        header.Height = Height;
+        header.Flags = (NormalOct ? NORMAL_OCT : 0) | (Smooth ? SMOOTH : 0) | (Adaptive ? ADAPTIVE : 0) | (Blur ? BLUR : 0)
+                     | (Coverage ? COVERAGE : 0);
+        std::memcpy(header.View, &View[0][0], sizeof(header.View));
+        std::memcpy(header.Projection, &Projection[0][0], sizeof(header.Projection));
+        header.Samples = Samples;
+        header.MinSamples = MinSamples;
+        header.KernelSize = KernelSize;
+        header.NoiseSize = NoiseSize;
+        header.ExtraLights = ExtraLights;
+        header.Radius = Radius;
+        header.Bias = Bias;
+        header.Intensity = Intensity;
+        header.LightsExtent = LightsExtent;
+        uint64_t offset = align(sizeof(Header));
+        for (int s = 0; s < SECTIONS; ++s) {
+            header.Offset[s] = offset;
+            header.Bytes[s] = bytes[s];
+            offset = align(offset + bytes[s]);
+        }
+
+        std::error_code ec;
+        std::filesystem::path target(path);
+        if (target.has_parent_path())
+            std::filesystem::create_directories(target.parent_path(), ec);
+        return WriteFileAtomic(path, [&](std::ofstream& out) {
+            out.write((const char*)&header, sizeof(header));
+            uint64_t written = sizeof(header);
+            static const char zeros[4096] = {};
+            for (int s = 0; s < SECTIONS; ++s) {
+                out.write(zeros, (std::streamsize)(header.Offset[s] - written));
+                out.write(data[s], (std::streamsize)bytes[s]);
+                written = header.Offset[s] + bytes[s];
+            }
+            return (bool)out;
+        });
+    }
+
+    // mapea 'path' y lee el header; false si no existe, no es una instantanea, es de otra version o esta truncada
+    bool Open(const std::string& path)
+    {
+        std::unique_ptr<MappedFile> file(new MappedFile(path));
+        if (!file->Valid() || file->Size() < sizeof(Header))
+            return false;
+        Header header;
+        std::memcpy(&header, file->Data(), sizeof(header));
+        if (header.Magic != MAGIC || header.Version != VERSION || header.HeaderBytes != sizeof(Header))
+            return false;
+        Width = header.Width;
+        Height = header.Height;
+        NormalOct = (header.Flags & NORMAL_OCT) != 0;
+        Smooth = (header.Flags & SMOOTH) != 0;
+        Adaptive = (header.Flags & ADAPTIVE) != 0;
+        Blur = (header.Flags & BLUR) != 0;
+        Coverage = (header.Flags & COVERAGE) != 0;
+        std::memcpy(&View[0][0], header.View, sizeof(header.View));
+        std::memcpy(&Projection[0][0], header.Projection, sizeof(header.Projection));
+        Samples = header.Samples;
+        MinSamples = header.MinSamples;
+        KernelSize = header.KernelSize;
+        NoiseSize = header.NoiseSize;
+        ExtraLights = header.ExtraLights;
+        Radius = header.Radius;
+        Bias = header.Bias;
+        Intensity = header.Intensity;
+        LightsExtent = header.LightsExtent;
+        if (Width <= 0 || Height <= 0 || KernelSize <= 0 || KernelSize > 64 || NoiseSize <= 0)
+            return false;
+        for (int s = 0; s < SECTIONS; ++s) {
+            if (header.Bytes[s] != sectionBytes((Section)s) || header.Offset[s] + header.Bytes[s] > file->Size())
+                return false;
+            data[s] = file->Data() + header.Offset[s];
+            bytes[s] = header.Bytes[s];
+            owned[s].clear();
+        }
+        Kernel.resize(KernelSize);
+        std::memcpy(Kernel.data(), data[KERNEL], bytes[KERNEL]);
+        mapped = std::move(file);
+        return true;
+    }
+
+    // una textura nueva con la seccion (no KERNEL), en el formato del target de donde salio. Es del que llama
+    unsigned int Upload(Section section) const
+    {
+        static const GLenum internal[] = { GL_RGBA16F, GLenum(0), GL_RGBA8, GL_DEPTH24_STENCIL8, GLenum(0), GL_RGBA32F };
+        static const GLenum formats[] = { GL_RGB, GLenum(0), GL_RGBA, GL_DEPTH_STENCIL, GLenum(0), GL_RGB };
+        static const GLenum types[] = { GL_HALF_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_BYTE, GL_UNSIGNED_INT_24_8, GLenum(0), GL_FLOAT };
+        GLenum internalFormat = section == NORMAL ? (NormalOct ? GL_RG16F : GL_RGBA16F) : internal[section];
+        GLenum format = section == NORMAL ? (NormalOct ? GL_RG : GL_RGB) : formats[section];
+        int w = section == NOISE ? NoiseSize : Width, h = section == NOISE ? NoiseSize : Height;
+
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, types[section], data[section]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // como los del frame graph: nearest y clamp; el ruido se repite sobre la pantalla
+        GLint wrap = section == NOISE ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glBindTexture(GL_TEXTURE_2D, previous);
+        return texture;
+    }
+
+    // 'path' si es un archivo; si es un directorio, sus .gbs ordenados por nombre
+    static std::vector<std::string> List(const std::string& path)
+    {
+        std::vector<std::string> files;
+        std::error_code ec;
+        if (!std::filesystem::is_directory(path, ec)) {
+            files.push_back(path);
+            return files;
+        }
+        for (std::filesystem::directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+            if (it->path().extension() == ".gbs")
+                files.push_back(it->path().string());
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+private:
+    struct Header
+    {
+        uint32_t Magic, Version, HeaderBytes;
+        int32_t Width, Height;
+        uint32_t Flags;
+        float View[16], Projection[16];
+        int32_t Samples, MinSamples, KernelSize, NoiseSize, ExtraLights;
+        float Radius, Bias, Intensity, LightsExtent;
+        uint64_t Offset[SECTIONS], Bytes[SECTIONS];
+    };
+
+    std::unique_ptr<MappedFile> mapped;
+    std::vector<char> owned[SECTIONS];
+    const char* data[SECTIONS] = { nullptr };
+    uint64_t bytes[SECTIONS] = { 0 };
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + ALIGN - 1) / ALIGN * ALIGN;
+    }
+
+    uint64_t sectionBytes(Section section) const
+    {
+        uint64_t pixels = (uint64_t)Width * Height;
+        switch (section) {
+        case POSITION: return pixels * 3 * 2;
+        case NORMAL:   return pixels * (NormalOct ? 2 : 3) * 2;
+        case ALBEDO:   return pixels * 4;
+        case DEPTH:    return pixels * 4;
+        case KERNEL:   return (uint64_t)KernelSize * sizeof(glm::vec3);
+        default:       return (uint64_t)NoiseSize * NoiseSize * sizeof(glm::vec3);
+        }
+    }
+};
+#endif
@@ -0,0 +1,268 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Cache del estado de GL que cambia entre pases: programa, VAO, framebuffers, texturas por unidad,
+// depth/stencil/blend/color mask y viewport. Cada llamada compara con lo ultimo que se mando y solo llega al
+// driver si cambia algo. Todo el codigo que toca ese estado tiene que pasar por aca (si no, la cache
+// queda desactualizada); lo que lo cambia por su cuenta, como ImGui, se cubre con Invalidate().
+// Los valores arrancan como "desconocidos", asi la primera llamada de cada tipo siempre se emite.
+class GLState
+{
+public:
+    static const int MAX_UNITS = 16;
+
+    // llamadas que llegaron al driver / que se descartaron por redundantes, en el frame actual y el anterior
+    unsigned long long Issued = 0, Filtered = 0;
+    unsigned long long LastIssued = 0, LastFiltered = 0;
+
+    static GLState& Get()
+    {
+        static GLState state;
+        return state;
+    }
+
+    void UseProgram(unsigned int program)
+    {
+        if (set(this->program, program))
+            glUseProgram(program);
+    }
+
+    void BindVertexArray(unsigned int vao)
+    {
+        if (set(vertexArray, vao))
+            glBindVertexArray(vao);
+    }
+
+    // GL_FRAMEBUFFER cambia los dos bindings, como en GL
+    void BindFramebuffer(GLenum target, unsigned int fbo)
+    {
+        if (target == GL_FRAMEBUFFER) {
+            if (readFramebuffer == fbo && drawFramebuffer == fbo) {
+                ++Filtered;
+                return;
+            }
+            readFramebuffer = drawFramebuffer = fbo;
+            ++Issued;
+            glBindFramebuffer(target, fbo);
+        }
+        else if (set(target == GL_READ_FRAMEBUFFER ? readFramebuffer : drawFramebuffer, fbo)) {
+            glBindFramebuffer(target, fbo);
+        }
+    }
+
+    void ActiveTexture(unsigned int unit)
+    {
+        if (set(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // textura en una unidad concreta (para los samplers de un pase)
+    void BindTexture(unsigned int unit, GLenum target, unsigned int texture)
+    {
+        int t = targetIndex(target);
+        if (t < 0 || unit >= MAX_UNITS) {
+            ActiveTexture(unit);
+            ++Issued;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (textures[unit][t] == texture) {
+            ++Filtered;
+            return;
+        }
+        ActiveTexture(unit);
+        textures[unit][t] = texture;
+        ++Issued;
+        glBindTexture(target, texture);
+    }
+
+    // textura en la unidad activa (para crear o subir texturas)
+    void BindTexture(GLenum target, unsigned int texture)
+    {
+        if (activeUnit == UNKNOWN)
+            ActiveTexture(0);
+        BindTexture(activeUnit, target, texture);
+    }
+
+    void Enable(GLenum cap, bool enabled)
+    {
+        int c = capIndex(cap);
+        if (c < 0) {
+            ++Issued;
+            enabled ? glEnable(cap) : glDisable(cap);
+            return;
+        }
+        if (set(caps[c], enabled ? 1u : 0u))
+            enabled ? glEnable(cap) : glDisable(cap);
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if (set(depthFunc, func))
+            glDepthFunc(func);
+    }
+
+    void DepthMask(bool write)
+    {
+        if (set(depthMask, write ? 1u : 0u))
+            glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+
+    // las cuatro componentes juntas: es lo unico que usan los pases
+    void ColorMask(bool write)
+    {
+        if (set(colorMask, write ? 1u : 0u)) {
+            GLboolean w = write ? GL_TRUE : GL_FALSE;
+            glColorMask(w, w, w, w);
+        }
+    }
+
+    void StencilFunc(GLenum func, int ref, unsigned int mask)
+    {
+        if (stencilFunc == func && stencilRef == (unsigned int)ref && stencilReadMask == mask) {
+            ++Filtered;
+            return;
+        }
+        stencilFunc = func;
+        stencilRef = (unsigned int)ref;
+        stencilReadMask = mask;
+        ++Issued;
+        glStencilFunc(func, ref, mask);
+    }
+
+    // la misma operacion para las dos caras
+    void StencilOp(GLenum stencilFail, GLenum depthFail, GLenum pass)
+    {
+        if (stencilOp[0] == stencilFail && stencilOp[1] == depthFail && stencilOp[2] == pass) {
+            ++Filtered;
+            return;
+        }
+        stencilOp[0] = stencilFail; stencilOp[1] = depthFail; stencilOp[2] = pass;
+        ++Issued;
+        glStencilOp(stencilFail, depthFail, pass);
+    }
+
+    void StencilMask(unsigned int mask)
+    {
+        if (set(stencilWriteMask, mask))
+            glStencilMask(mask);
+    }
+
+    void BlendFunc(GLenum src, GLenum dst)
+    {
+        if (blendSrc == src && blendDst == dst) {
+            ++Filtered;
+            return;
+        }
+        blendSrc = src;
+        blendDst = dst;
+        ++Issued;
+        glBlendFunc(src, dst);
+    }
+
+    void Viewport(int x, int y, int w, int h)
+    {
+        if (viewport[0] == x && viewport[1] == y && viewport[2] == w && viewport[3] == h) {
+            ++Filtered;
+            return;
+        }
+        viewport[0] = x; viewport[1] = y; viewport[2] = w; viewport[3] = h;
+        ++Issued;
+        glViewport(x, y, w, h);
+    }
+
+    // borrar objetos por aca: GL los desenlaza y un id reciclado no tiene que parecer ya enlazado
+    void DeleteTextures(int n, const unsigned int* ids)
+    {
+        for (int i = 0; i < n; ++i)
+            for (int u = 0; u < MAX_UNITS; ++u)
+                for (int t = 0; t < TARGETS; ++t)
+                    if (textures[u][t] == ids[i])
+                        textures[u][t] = 0;
+        glDeleteTextures(n, ids);
+    }
+
+    void DeleteFramebuffers(int n, const unsigned int* ids)
+    {
+        for (int i = 0; i < n; ++i) {
+            if (readFramebuffer == ids[i])
+                readFramebuffer = 0;
+            if (drawFramebuffer == ids[i])
+                drawFramebuffer = 0;
+        }
+        glDeleteFramebuffers(n, ids);
+    }
+
+    void DeleteVertexArrays(int n, const unsigned int* ids)
+    {
+        for (int i = 0; i < n; ++i)
+            if (vertexArray == ids[i])
+                vertexArray = 0;
+        glDeleteVertexArrays(n, ids);
+    }
+
+    // olvidar todo lo cacheado (despues de codigo que cambia el estado sin pasar por aca)
+    void Invalidate()
+    {
+        program = vertexArray = readFramebuffer = drawFramebuffer = activeUnit = UNKNOWN;
+        for (int u = 0; u < MAX_UNITS; ++u)
+            for (int t = 0; t < TARGETS; ++t)
+                textures[u][t] = UNKNOWN;
+        for (int c = 0; c < CAPS; ++c)
+            caps[c] = UNKNOWN;
+        depthFunc = depthMask = colorMask = blendSrc = blendDst = UNKNOWN;
+        stencilFunc = stencilRef = stencilReadMask = stencilWriteMask = UNKNOWN;
+        stencilOp[0] = stencilOp[1] = stencilOp[2] = UNKNOWN;
+        viewport[0] = viewport[1] = viewport[2] = viewport[3] = -1;
+    }
+
+    // pasa los contadores del frame a Last*
+    void EndFrame()
+    {
+        LastIssued = Issued;
+        LastFiltered = Filtered;
+        Issued = Filtered = 0;
+    }
+
+private:
+    static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+    static const int TARGETS = 3;   // GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_BUFFER
+    static const int CAPS = 4;      // GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_STENCIL_TEST
+
+    unsigned int program, vertexArray, readFramebuffer, drawFramebuffer, activeUnit;
+    unsigned int textures[MAX_UNITS][TARGETS];
+    unsigned int caps[CAPS];
+    unsigned int depthFunc, depthMask, colorMask, blendSrc, blendDst;
+    unsigned int stencilFunc, stencilRef, stencilReadMask, stencilWriteMask, stencilOp[3];
+    int viewport[4];
+
+    GLState()
+    {
+        Invalidate();
+    }
+
+    // true (y cuenta la llamada) si el valor cambio
+    bool set(unsigned int& cached, unsigned int value)
+    {
+        if (cached == value) {
+            ++Filtered;
+            return false;
+        }
+        cached = value;
+        ++Issued;
+        return true;
+    }
+
+    static int targetIndex(GLenum target)
+    {
+        return target == GL_TEXTURE_2D ? 0 : target == GL_TEXTURE_3D ? 1 : target == GL_TEXTURE_BUFFER ? 2 : -1;
+    }
+
+    static int capIndex(GLenum cap)
+    {
+        return cap == GL_DEPTH_TEST ? 0 : cap == GL_BLEND ? 1 : cap == GL_CULL_FACE ? 2 : cap == GL_STENCIL_TEST ? 3 : -1;
+    }
+};
+#endif
@@ -0,0 +1,77 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// Mide el tiempo de GPU de un tramo del frame con pares de queries GL_TIMESTAMP (se pueden anidar,
+// a diferencia de GL_TIME_ELAPSED). Usa un anillo de queries y solo lee las que ya estan disponibles,
+// asi nunca frena el pipeline. Cada medicion lleva un 'tag' para saber a que corresponde al resolverse.
+class GpuTimer
+{
+public:
+    static const int RING = 4;
+    float LastMs = 0.0f;    // ultimo tiempo resuelto (de hace 1-3 frames)
+    int LastTag = 0;        // tag de esa medicion
+
+    void Begin(int tag = 0)
+    {
+        if (queries[0][0] == 0)
+            glGenQueries(RING * 2, &queries[0][0]);
+        poll();
+        // si el slot sigue ocupado salteamos la medicion de este frame
+        active = !pending[head];
+        if (active) {
+            tags[head] = tag;
+            glQueryCounter(queries[head][0], GL_TIMESTAMP);
+        }
+    }
+
+    void End()
+    {
+        if (!active)
+            return;
+        glQueryCounter(queries[head][1], GL_TIMESTAMP);
+        pending[head] = true;
+        head = (head + 1) % RING;
+        active = false;
+    }
+
+    // devuelve true (una sola vez) cuando se resolvio una medicion nueva desde la ultima llamada
+    bool Resolved()
+    {
+        poll();
+        bool r = fresh;
+        fresh = false;
+        return r;
+    }
+
+private:
+    unsigned int queries[RING][2] = { { 0 } };
+    bool pending[RING] = { false };
+    int tags[RING] = { 0 };
+    int head = 0;
+    bool active = false;
+    bool fresh = false;
+
+    void poll()
+    {
+        // los resultados llegan en orden, empezando por el mas viejo
+        for (int i = 1; i <= RING; ++i) {
+            int slot = (head + i) % RING;
+            if (!pending[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 t0 = 0, t1 = 0;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &t0);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &t1);
+            LastMs = (t1 - t0) / 1.0e6f;
+            LastTag = tags[slot];
+            pending[slot] = false;
+            fresh = true;
+        }
+    }
+};
+#endif
@@ -0,0 +1,81 @@
+#ifndef IMPORT_ARENA_H
+#define IMPORT_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Memoria temporal de la importacion de un modelo: la conversion de cada mesh (vertices, indices, AO inicial,
+// stream de posiciones) se escribe en bloques que se reservan una vez y se reutilizan con Reset() en el mesh
+// siguiente. Asi importar N meshes no hace N x 4 reservas y liberaciones del heap: el arena crece hasta el
+// mesh mas grande y despues no vuelve a reservar. Solo para tipos triviales (no se llaman destructores).
+class ImportArena
+{
+public:
+    ImportArena(size_t blockSize = 1 << 20) : blockSize(blockSize) {}
+    ImportArena(const ImportArena&) = delete;
+    ImportArena& operator=(const ImportArena&) = delete;
+
+    // n elementos sin inicializar, alineados para T; validos hasta el proximo Reset()
+    template <typename T>
+    T* Allocate(size_t n)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "ImportArena no llama destructores");
+        size_t bytes = std::max<size_t>(n, 1) * sizeof(T);
+        size_t offset = (used + alignof(T) - 1) / alignof(T) * alignof(T);
+        if (blocks.empty() || offset + bytes > blocks[current].Size) {
+            // siguiente bloque (o uno nuevo si no entra en ninguno de los que quedan)
+            while (++current < blocks.size() && blocks[current].Size < bytes) {}
+            if (current >= blocks.size()) {
+                blocks.push_back(Block(std::max(bytes, blockSize)));
+                current = blocks.size() - 1;
+            }
+            offset = 0;
+        }
+        used = offset + bytes;
+        return reinterpret_cast<T*>(blocks[current].Data + offset);
+    }
+
+    // libera todo lo pedido. Si hizo falta mas de un bloque se reemplazan por uno solo del tamanio total,
+    // asi a partir del mesh siguiente todo sale de un bloque
+    void Reset()
+    {
+        if (blocks.size() > 1) {
+            size_t size = 0;
+            for (const Block& block : blocks)
+                size += block.Size;
+            blocks.clear();
+            blocks.push_back(Block(size));
+        }
+        current = 0;
+        used = 0;
+    }
+
+    // bytes reservados del heap
+    size_t Capacity() const
+    {
+        size_t size = 0;
+        for (const Block& block : blocks)
+            size += block.Size;
+        return size;
+    }
+
+private:
+    struct Block
+    {
+        // alineado a 16 bytes (lo maximo que pide un tipo de glm o de Vertex)
+        std::unique_ptr<std::max_align_t[]> Storage;
+        unsigned char* Data;
+        size_t Size;
+
+        Block(size_t size) : Storage(new std::max_align_t[(size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]),
+            Data(reinterpret_cast<unsigned char*>(Storage.get())), Size(size) {}
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current = 0, used = 0;     // bloque actual y bytes usados en el
+};
+#endif
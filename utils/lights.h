@@ -0,0 +1,221 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "utils/memory_stats.h"
+#include "utils/shader.h"
+#include "utils/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Luz puntual con radio de influencia: fuera de Radius no aporta nada (ver attenuation en los shaders)
+struct PointLight {
+    glm::vec3 Position;     // world-space
+    glm::vec3 Color;
+    float Radius;
+};
+
+// Clustered shading: divide el view frustum en tiles de TileSize x TileSize pixeles y Slices
+// rebanadas exponenciales en z. En CPU (ThreadPool) se arma, por cluster, la lista de luces cuya
+// esfera lo toca; el lighting pass solo recorre las luces de su cluster.
+//  - lightData:    texture buffer RGBA32F, 2 texels por luz: (posicion view-space, radio), (color, 0)
+//  - clusterGrid:  textura 3D RG32UI (offset, cantidad) en lightIndices por cluster
+//  - lightIndices: texture buffer R32UI con los indices de luces de todos los clusters
+class LightClusters
+{
+public:
+    int TileSize = 32;
+    int Slices = 16;
+    float Near = 0.1f, Far = 50.0f;
+
+    // dimensiones de la grilla del ultimo Build
+    int TilesX = 0, TilesY = 0;
+    // estadisticas del ultimo Build
+    size_t TotalIndices = 0;
+    unsigned int MaxPerCluster = 0;
+
+    // arma las listas por cluster para un viewport de width x height pixeles
+    void Build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, int width, int height)
+    {
+        TilesX = (width + TileSize - 1) / TileSize;
+        TilesY = (height + TileSize - 1) / TileSize;
+        size_t nLights = lights.size();
+
+        // 1. datos de luz en view-space y rango de clusters que toca cada una
+        lightData.resize(nLights * 8);
+        ranges.resize(nLights);
+        float logFactor = Slices / std::log(Far / Near);
+        ThreadPool::Get().ParallelFor(nLights, 64, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const PointLight& l = lights[i];
+                glm::vec3 p = glm::vec3(view * glm::vec4(l.Position, 1.0f));
+                float* d = &lightData[i * 8];
+                d[0] = p.x; d[1] = p.y; d[2] = p.z; d[3] = l.Radius;
+                d[4] = l.Color.r; d[5] = l.Color.g; d[6] = l.Color.b; d[7] = 0.0f;
+                ranges[i] = clusterRange(p, l.Radius, projection, width, height, logFactor);
+            }
+        });
+
+        // 2. por rebanada (en paralelo): listas de cada cluster de la rebanada
+        size_t tilesPerSlice = (size_t)TilesX * TilesY;
+        sliceIndices.resize(Slices);
+        sliceCounts.resize(Slices);
+        ThreadPool::Get().ParallelFor(Slices, 1, [&](size_t begin, size_t end) {
+            std::vector<std::vector<uint32_t>> perTile;
+            for (size_t z = begin; z < end; ++z) {
+                perTile.assign(tilesPerSlice, std::vector<uint32_t>());
+                for (size_t i = 0; i < nLights; ++i) {
+                    const Range& r = ranges[i];
+                    if ((int)z < r.z0 || (int)z > r.z1)
+                        continue;
+                    for (int y = r.y0; y <= r.y1; ++y)
+                        for (int x = r.x0; x <= r.x1; ++x)
+                            perTile[(size_t)y * TilesX + x].push_back((uint32_t)i);
+                }
+                // aplanar la rebanada
+                sliceIndices[z].clear();
+                sliceCounts[z].resize(tilesPerSlice);
+                for (size_t t = 0; t < tilesPerSlice; ++t) {
+                    sliceCounts[z][t] = (uint32_t)perTile[t].size();
+                    sliceIndices[z].insert(sliceIndices[z].end(), perTile[t].begin(), perTile[t].end());
+                }
+            }
+        });
+
+        // 3. concatenar rebanadas: grilla (offset, cantidad) + lista global de indices
+        grid.resize(tilesPerSlice * Slices * 2);
+        indices.clear();
+        MaxPerCluster = 0;
+        for (int z = 0; z < Slices; ++z) {
+            uint32_t offset = (uint32_t)indices.size();
+            for (size_t t = 0; t < tilesPerSlice; ++t) {
+                size_t cell = ((size_t)z * tilesPerSlice + t) * 2;
+                grid[cell] = offset;
+                grid[cell + 1] = sliceCounts[z][t];
+                offset += sliceCounts[z][t];
+                MaxPerCluster = std::max(MaxPerCluster, sliceCounts[z][t]);
+            }
+            indices.insert(indices.end(), sliceIndices[z].begin(), sliceIndices[z].end());
+        }
+        TotalIndices = indices.size();
+    }
+
+    // sube los buffers a la GPU
+    void Upload()
+    {
+        if (lightTBO == 0) {
+            glGenBuffers(1, &lightTBO);
+            glGenTextures(1, &lightTex);
+            glGenBuffers(1, &indexTBO);
+            glGenTextures(1, &indexTex);
+            glGenTextures(1, &gridTex);
+            GLState::Get().BindTexture(GL_TEXTURE_3D, gridTex);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        // un buffer vacio no es valido como texture buffer: siempre al menos un elemento
+        uploadBuffer(lightTBO, lightTex, GL_RGBA32F, lightData.data(), std::max<size_t>(lightData.size(), 8) * sizeof(float));
+        uploadBuffer(indexTBO, indexTex, GL_R32UI, indices.data(), std::max<size_t>(indices.size(), 1) * sizeof(uint32_t));
+
+        GLState::Get().BindTexture(GL_TEXTURE_3D, gridTex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RG32UI, TilesX, TilesY, Slices, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, grid.data());
+        gpuBytes = (std::max<size_t>(lightData.size(), 8) + grid.size()) * sizeof(float) + std::max<size_t>(indices.size(), 1) * sizeof(uint32_t);
+    }
+
+    // enlaza las texturas a partir de la unidad 'firstUnit' y configura los uniforms del shader (que debe estar en uso)
+    void Bind(Shader& shader, int firstUnit) const
+    {
+        GLState& state = GLState::Get();
+        state.BindTexture(firstUnit, GL_TEXTURE_BUFFER, lightTex);
+        state.BindTexture(firstUnit + 1, GL_TEXTURE_3D, gridTex);
+        state.BindTexture(firstUnit + 2, GL_TEXTURE_BUFFER, indexTex);
+
+        shader.setInt("lightData", firstUnit);
+        shader.setInt("clusterGrid", firstUnit + 1);
+        shader.setInt("lightIndices", firstUnit + 2);
+        shader.setInt("clusterTileSize", TileSize);
+        shader.setInt("clusterSlices", Slices);
+        shader.setFloat("clusterNear", Near);
+        shader.setFloat("clusterLogFactor", Slices / std::log(Far / Near));
+    }
+
+    // listas por cluster en CPU y los tres texture buffers / texturas en GPU
+    MemoryUsage Memory() const
+    {
+        size_t cpu = lightData.capacity() * sizeof(float) + ranges.capacity() * sizeof(Range) + (grid.capacity() + indices.capacity()) * sizeof(uint32_t);
+        for (const std::vector<uint32_t>& v : sliceIndices)
+            cpu += v.capacity() * sizeof(uint32_t);
+        for (const std::vector<uint32_t>& v : sliceCounts)
+            cpu += v.capacity() * sizeof(uint32_t);
+        return MemoryUsage(cpu, gpuBytes);
+    }
+
+private:
+    struct Range { int x0, x1, y0, y1, z0, z1; };
+
+    std::vector<float> lightData;
+    std::vector<Range> ranges;
+    std::vector<std::vector<uint32_t>> sliceIndices, sliceCounts;
+    std::vector<uint32_t> grid, indices;
+    unsigned int lightTBO = 0, lightTex = 0, indexTBO = 0, indexTex = 0, gridTex = 0;
+    size_t gpuBytes = 0;
+
+    static void uploadBuffer(unsigned int tbo, unsigned int tex, GLenum format, const void* data, size_t bytes)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+        glBufferData(GL_TEXTURE_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+        GLState::Get().BindTexture(GL_TEXTURE_BUFFER, tex);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, tbo);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    int sliceOf(float viewZ, float logFactor) const
+    {
+        return glm::clamp((int)std::floor(std::log(std::max(-viewZ, Near) / Near) * logFactor), 0, Slices - 1);
+    }
+
+    // rango conservador de clusters que cubre una esfera en view-space
+    Range clusterRange(const glm::vec3& c, float radius, const glm::mat4& projection, int width, int height, float logFactor) const
+    {
+        Range r = { 0, TilesX - 1, 0, TilesY - 1, 0, Slices - 1 };
+        float zMin = c.z - radius, zMax = c.z + radius;     // zMax es el punto mas cercano a la camara
+        if (zMax < -Far || zMin > -Near) {
+            // fuera del rango de profundidad: rango vacio
+            r.z0 = 1; r.z1 = 0;
+            return r;
+        }
+        r.z0 = sliceOf(zMax, logFactor);
+        r.z1 = sliceOf(zMin, logFactor);
+
+        // si la esfera cruza el near plane la proyeccion no es acotable: todos los tiles
+        if (zMax > -Near)
+            return r;
+
+        // proyectar las 8 esquinas de la caja que envuelve a la esfera
+        glm::vec2 mn(1.0f), mx(-1.0f);
+        for (int i = 0; i < 8; ++i) {
+            glm::vec3 corner(c.x + ((i & 1) ? radius : -radius), c.y + ((i & 2) ? radius : -radius), (i & 4) ? zMax : zMin);
+            glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+            glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+            mn = glm::vec2(std::min(mn.x, ndc.x), std::min(mn.y, ndc.y));
+            mx = glm::vec2(std::max(mx.x, ndc.x), std::max(mx.y, ndc.y));
+        }
+        if (mx.x < -1.0f || mn.x > 1.0f || mx.y < -1.0f || mn.y > 1.0f) {
+            r.z0 = 1; r.z1 = 0;
+            return r;
+        }
+        r.x0 = glm::clamp((int)((mn.x * 0.5f + 0.5f) * width) / TileSize, 0, TilesX - 1);
+        r.x1 = glm::clamp((int)((mx.x * 0.5f + 0.5f) * width) / TileSize, 0, TilesX - 1);
+        r.y0 = glm::clamp((int)((mn.y * 0.5f + 0.5f) * height) / TileSize, 0, TilesY - 1);
+        r.y1 = glm::clamp((int)((mx.y * 0.5f + 0.5f) * height) / TileSize, 0, TilesY - 1);
+        return r;
+    }
+};
+#endif
@@ -0,0 +1,81 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Bytes de un recurso en memoria del sistema (Cpu) y de video (Gpu). Lo de GPU es lo que se pidio al
+// driver (ancho x alto x bytes por texel, tamanio de los buffers): el driver puede agregar padding.
+struct MemoryUsage
+{
+    size_t Cpu = 0, Gpu = 0;
+
+    MemoryUsage() {}
+    MemoryUsage(size_t cpu, size_t gpu) : Cpu(cpu), Gpu(gpu) {}
+
+    MemoryUsage& operator+=(const MemoryUsage& other)
+    {
+        Cpu += other.Cpu;
+        Gpu += other.Gpu;
+        return *this;
+    }
+};
+
+// Desglose de memoria por recurso: cada subsistema agrega sus entradas (ver los Memory() de Model,
+// Scene, LightClusters, FrameGraph y FrameCapture) y la interfaz o quien consulte lo recorre.
+class MemoryReport
+{
+public:
+    struct Entry
+    {
+        std::string Category, Name;
+        MemoryUsage Usage;
+    };
+
+    std::vector<Entry> Entries;
+
+    void Add(const std::string& category, const std::string& name, const MemoryUsage& usage)
+    {
+        Entries.push_back({ category, name, usage });
+    }
+
+    // total de una categoria, o de todo si category es vacio
+    MemoryUsage Total(const std::string& category = "") const
+    {
+        MemoryUsage total;
+        for (const Entry& e : Entries)
+            if (category.empty() || e.Category == category)
+                total += e.Usage;
+        return total;
+    }
+
+    // categorias en orden de aparicion
+    std::vector<std::string> Categories() const
+    {
+        std::vector<std::string> categories;
+        for (const Entry& e : Entries) {
+            bool seen = false;
+            for (const std::string& c : categories)
+                seen = seen || c == e.Category;
+            if (!seen)
+                categories.push_back(e.Category);
+        }
+        return categories;
+    }
+
+    void Print(std::ostream& out) const
+    {
+        for (const std::string& category : Categories()) {
+            MemoryUsage total = Total(category);
+            out << category << ": " << total.Cpu / 1024 << " KB CPU, " << total.Gpu / 1024 << " KB GPU\n";
+            for (const Entry& e : Entries)
+                if (e.Category == category)
+                    out << "  " << e.Name << ": " << e.Usage.Cpu / 1024 << " KB CPU, " << e.Usage.Gpu / 1024 << " KB GPU\n";
+        }
+        MemoryUsage total = Total();
+        out << "Total: " << total.Cpu / 1024 << " KB CPU, " << total.Gpu / 1024 << " KB GPU" << std::endl;
+    }
+};
+#endif
@@ -6,6 +6,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "utils/import_arena.h"
+#include "utils/memory_stats.h"
+#include "utils/meshlets.h"
 #include "utils/shader.h"
 
 #include <string>
@@ -31,10 +34,22 @@ struct Vertex {
 	float m_Weights[MAX_BONE_INFLUENCE];
 };
 
+// per-instance data for instanced drawing (attribute locations 7-13)
+struct InstanceData {
+    // model matrix (locations 7-10)
+    glm::mat4 Model;
+    // normal matrix = transpose(inverse(mat3(Model))), stored as vec4 columns (locations 11-13)
+    glm::vec4 NormalMatrix[3];
+};
+
 struct Texture {
     unsigned int id;
-    string type;
+    // sampler prefix ("texture_diffuse", ...): points at a string literal, so copies don't allocate
+    const char* type;
+    // only set in Model::textures_loaded (the dedup list), empty in the per-mesh copies
     string path;
+    // estimated GPU size, all mip levels included
+    size_t bytes = 0;
 };
 
 class Mesh {
@@ -44,20 +59,162 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    // sizes of the GPU buffers; they stay valid after ReleaseCpuData()
+    unsigned int VertexCount = 0, IndexCount = 0;
+    // clusters of the index buffer with culling bounds (the triangles are stored meshlet by meshlet)
+    Meshlets meshlets;
 
-    // constructor
+    // constructor: the vectors are moved in (pass them with std::move to avoid copying the data)
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        VertexCount = static_cast<unsigned int>(this->vertices.size());
+        IndexCount = static_cast<unsigned int>(this->indices.size());
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        ImportArena scratch(0);
+        setupMesh(this->vertices.data(), this->indices.data(), scratch);
+    }
+
+    // constructor from data converted into an import arena: it is uploaded straight from there and only
+    // copied into the mesh (one exact-size allocation each) if keepCpuData is set
+    Mesh(const Vertex* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount,
+         vector<Texture>&& textures, ImportArena& scratch, bool keepCpuData)
+        : textures(std::move(textures)), VertexCount(vertexCount), IndexCount(indexCount)
+    {
+        if (keepCpuData)
+        {
+            this->vertices.assign(vertices, vertices + vertexCount);
+            this->indices.assign(indices, indices + indexCount);
+        }
+        setupMesh(vertices, indices, scratch);
+    }
+
+    // replaces the per-vertex baked AO (one value per vertex, see AOBaker)
+    void SetBakedAO(const vector<float>& ao)
+    {
+        if (ao.size() != VertexCount)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, aoVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, ao.size() * sizeof(float), ao.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
     // render the mesh
     void Draw(Shader &shader) 
+    {
+        bindTextures(shader);
+        
+        // draw mesh (the VAO stays bound: GLState skips the bind when the next draw uses it too)
+        GLState::Get().BindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, IndexCount, GL_UNSIGNED_INT, 0);
+    }
+
+    // render 'count' instances whose InstanceData starts at byte 'offset' of 'instanceVBO'.
+    // depthOnly uses the position-only stream and skips textures (depth pre-pass).
+    // repeat > 1 draws every instance 'repeat' times in a row (attribute divisor = repeat): the shader tells
+    // the copies apart with gl_InstanceID % repeat (one copy per view, see utils/multi_view.h)
+    void DrawInstanced(Shader &shader, unsigned int instanceVBO, size_t offset, unsigned int count, bool depthOnly = false, unsigned int repeat = 1)
+    {
+        if (count == 0 || repeat == 0)
+            return;
+        if (!depthOnly)
+            bindTextures(shader);
+
+        GLState::Get().BindVertexArray(depthOnly ? depthVAO : VAO);
+        bindInstance(instanceVBO, offset, depthOnly, repeat);
+        glDrawElementsInstanced(GL_TRIANGLES, IndexCount, GL_UNSIGNED_INT, 0, count * repeat);
+    }
+
+    // render the index ranges that survived meshlet culling, for the single instance at byte 'offset'
+    // of 'instanceVBO' (one glMultiDrawElements: GL 3.3 has no instanced multi-draw)
+    void DrawRanges(Shader &shader, unsigned int instanceVBO, size_t offset, const GLsizei* counts, const void* const* firsts, GLsizei rangeCount, bool depthOnly = false)
+    {
+        if (rangeCount == 0)
+            return;
+        if (!depthOnly)
+            bindTextures(shader);
+        GLState::Get().BindVertexArray(depthOnly ? depthVAO : VAO);
+        bindInstance(instanceVBO, offset, depthOnly);
+        glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, firsts, rangeCount);
+    }
+
+    // true while the vertices/indices are in system memory (CPU consumers such as the AO baker need them)
+    bool HasCpuData() const
+    {
+        return vertices.size() == VertexCount && indices.size() == IndexCount;
+    }
+
+    // frees the CPU copies once they live in the GPU buffers
+    void ReleaseCpuData()
+    {
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
+    }
+
+    // reads the vertices and indices back from the GPU buffers
+    void RestoreCpuData()
+    {
+        if (HasCpuData())
+            return;
+        vertices.resize(VertexCount);
+        indices.resize(IndexCount);
+        // GL_COPY_READ_BUFFER does not touch the element buffer of the bound VAO
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    // deletes the vertex arrays and buffers (textures belong to the Model, see Model::ReleaseGpuData)
+    void ReleaseGpuData()
+    {
+        unsigned int arrays[] = { VAO, depthVAO };
+        GLState::Get().DeleteVertexArrays(2, arrays);
+        unsigned int buffers[] = { VBO, EBO, aoVBO, positionVBO };
+        glDeleteBuffers(4, buffers);
+        VAO = depthVAO = VBO = EBO = aoVBO = positionVBO = 0;
+    }
+
+    // CPU copies (if kept) and GPU buffers: interleaved vertices, indices, baked AO and position-only stream
+    MemoryUsage Memory() const
+    {
+        size_t cpu = vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + textures.capacity() * sizeof(Texture)
+            + meshlets.MemoryBytes();
+        size_t gpu = (size_t)VertexCount * (sizeof(Vertex) + sizeof(float) + sizeof(glm::vec3)) + (size_t)IndexCount * sizeof(unsigned int);
+        return MemoryUsage(cpu, gpu);
+    }
+
+private:
+    // render data 
+    unsigned int VBO, EBO;
+    // baked ambient occlusion per vertex (attribute 14, 1.0 until a bake is loaded)
+    unsigned int aoVBO;
+    // position-only stream for the depth pre-pass (shares the EBO)
+    unsigned int depthVAO, positionVBO;
+
+    // points the per-instance attributes at the InstanceData at byte 'offset' of 'instanceVBO'
+    // (GL 3.3 has no base instance, so they are re-pointed for every batch)
+    void bindInstance(unsigned int instanceVBO, size_t offset, bool depthOnly, unsigned int divisor = 1)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (int i = 0; i < 4; ++i)
+        {
+            glEnableVertexAttribArray(7 + i);
+            glVertexAttribPointer(7 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, Model) + i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(7 + i, divisor);
+        }
+        for (int i = 0; i < 3 && !depthOnly; ++i)
+        {
+            glEnableVertexAttribArray(11 + i);
+            glVertexAttribPointer(11 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, NormalMatrix) + i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(11 + i, divisor);
+        }
+    }
+
+    // binds the mesh textures and points the texture_diffuseN/... samplers at them
+    void bindTextures(Shader &shader)
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -66,7 +223,6 @@ public:
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -76,46 +232,43 @@ public:
                 number = std::to_string(specularNr++); // transfer unsigned int to string
             else if(name == "texture_normal")
                 number = std::to_string(normalNr++); // transfer unsigned int to string
-             else if(name == "texture_height")
+            else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to string
 
             // now set the sampler to the correct texture unit
             glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            // and finally bind the texture to unit i (skipped if it is already there)
+            GLState::Get().BindTexture(i, GL_TEXTURE_2D, textures[i].id);
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // initializes all the buffer objects/arrays; the temporary streams are taken from 'scratch'
+    void setupMesh(const Vertex* vertices, const unsigned int* indices, ImportArena& scratch)
     {
+        // meshlets: the index buffer is uploaded in meshlet order (and the CPU copy, if kept, follows it)
+        unsigned int* ordered = scratch.Allocate<unsigned int>(IndexCount);
+        meshlets.Build(reinterpret_cast<const unsigned char*>(vertices) + offsetof(Vertex, Position), sizeof(Vertex), VertexCount,
+                       indices, IndexCount, ordered, scratch);
+        if (meshlets.Size() > 0)
+            indices = ordered;
+        if (!this->indices.empty())
+            std::copy(indices, indices + IndexCount, this->indices.begin());
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        GLState::Get().BindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        glBufferData(GL_ARRAY_BUFFER, (size_t)VertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);  
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)IndexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -140,7 +293,29 @@ private:
 		// weights
 		glEnableVertexAttribArray(6);
 		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        // baked AO: separate stream so it can be replaced without touching the vertices
+        float* unoccluded = scratch.Allocate<float>(VertexCount);
+        std::fill(unoccluded, unoccluded + VertexCount, 1.0f);
+        glGenBuffers(1, &aoVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, aoVBO);
+        glBufferData(GL_ARRAY_BUFFER, (size_t)VertexCount * sizeof(float), unoccluded, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(14);
+        glVertexAttribPointer(14, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        GLState::Get().BindVertexArray(0);
+
+        // position-only stream: the depth pre-pass fetches 12 bytes per vertex instead of sizeof(Vertex)
+        glm::vec3* positions = scratch.Allocate<glm::vec3>(VertexCount);
+        for (size_t i = 0; i < VertexCount; i++)
+            positions[i] = vertices[i].Position;
+        glGenVertexArrays(1, &depthVAO);
+        glGenBuffers(1, &positionVBO);
+        GLState::Get().BindVertexArray(depthVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glBufferData(GL_ARRAY_BUFFER, (size_t)VertexCount * sizeof(glm::vec3), positions, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        GLState::Get().BindVertexArray(0);
     }
 };
 #endif
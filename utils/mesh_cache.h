@@ -0,0 +1,212 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "utils/atomic_file.h"
+#include "utils/mesh.h"
+#include "utils/obj_loader.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Cache binaria de las mallas de un modelo (<modelo>.mesh, al lado del original): los vertices e indices ya
+// importados, listos para subir. Se lee mapeada (MappedFile) y los buffers de GL se llenan directo desde el
+// mapeo, sin parsear ni copiar; varios procesos que abren la misma cache comparten sus paginas (el page cache
+// del sistema). Las texturas se cargan igual que siempre, por ruta. La cache guarda el tamanio y la fecha del
+// original: si el modelo cambia, se ignora y se vuelve a escribir.
+//
+// Formato: "MSH1", tamanio y fecha del original, cantidad de mallas; por malla: vertices, indices, texturas
+// (tipo y ruta de cada una), y los datos alineados a 16 bytes.
+class MeshCache
+{
+public:
+    struct TextureRef
+    {
+        const char* Type;       // uno de los tipos de sampler de Mesh (literal)
+        std::string Path;       // relativa al directorio del modelo
+    };
+    struct MeshData
+    {
+        const Vertex* Vertices;
+        uint32_t VertexCount;
+        const unsigned int* Indices;
+        uint32_t IndexCount;
+        std::vector<TextureRef> Textures;
+    };
+
+    std::vector<MeshData> Meshes;
+
+    static std::string Path(const std::string& model)
+    {
+        return model + ".mesh";
+    }
+
+    // mapea la cache de 'model' si existe y corresponde al archivo actual. Meshes apunta al mapeo: vale
+    // hasta Close o el destructor
+    bool Open(const std::string& model)
+    {
+        Close();
+        uint64_t size;
+        int64_t time;
+        if (!stamp(model, size, time))
+            return false;
+        file.reset(new MappedFile(Path(model)));
+        if (!file->Valid() || file->Size() == 0) {
+            Close();
+            return false;
+        }
+        const char* base = file->Data();
+        const char* p = base;
+        const char* end = p + file->Size();
+        uint32_t magic, count;
+        uint64_t cachedSize;
+        int64_t cachedTime;
+        if (!read(p, end, magic) || magic != MAGIC || !read(p, end, cachedSize) || !read(p, end, cachedTime) || !read(p, end, count)
+            || cachedSize != size || cachedTime != time) {
+            Close();
+            return false;
+        }
+        for (uint32_t m = 0; m < count; ++m) {
+            MeshData mesh;
+            uint32_t textures;
+            if (!read(p, end, mesh.VertexCount) || !read(p, end, mesh.IndexCount) || !read(p, end, textures)) {
+                Close();
+                return false;
+            }
+            for (uint32_t t = 0; t < textures; ++t) {
+                std::string type, path;
+                if (!readString(p, end, type) || !readString(p, end, path)) {
+                    Close();
+                    return false;
+                }
+                mesh.Textures.push_back({ internType(type), path });
+            }
+            p = base + align((size_t)(p - base));
+            size_t vertexBytes = (size_t)mesh.VertexCount * sizeof(Vertex), indexBytes = (size_t)mesh.IndexCount * sizeof(unsigned int);
+            if ((size_t)(end - p) < vertexBytes + indexBytes + 16) {
+                Close();
+                return false;
+            }
+            mesh.Vertices = (const Vertex*)p;
+            p = base + align((size_t)(p - base) + vertexBytes);
+            mesh.Indices = (const unsigned int*)p;
+            p += indexBytes;
+            Meshes.push_back(std::move(mesh));
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        Meshes.clear();
+        file.reset();
+    }
+
+    // escribe la cache de 'model' (con WriteFileAtomic: otro proceso nunca la ve a medias, aunque la este
+    // escribiendo tambien, p.ej. varios workers de --shard)
+    static bool Write(const std::string& model, const std::vector<MeshData>& meshes)
+    {
+        uint64_t size;
+        int64_t time;
+        if (!stamp(model, size, time))
+            return false;
+        return WriteFileAtomic(Path(model), [&](std::ofstream& out) {
+            uint32_t magic = MAGIC, count = (uint32_t)meshes.size();
+            write(out, magic);
+            write(out, size);
+            write(out, time);
+            write(out, count);
+            for (const MeshData& mesh : meshes) {
+                uint32_t textures = (uint32_t)mesh.Textures.size();
+                write(out, mesh.VertexCount);
+                write(out, mesh.IndexCount);
+                write(out, textures);
+                for (const TextureRef& texture : mesh.Textures) {
+                    writeString(out, texture.Type);
+                    writeString(out, texture.Path);
+                }
+                pad(out);
+                out.write((const char*)mesh.Vertices, (std::streamsize)mesh.VertexCount * sizeof(Vertex));
+                pad(out);
+                out.write((const char*)mesh.Indices, (std::streamsize)mesh.IndexCount * sizeof(unsigned int));
+            }
+            pad(out);   // Open pide 16 bytes de margen detras de cada malla
+            out.write("\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 16);
+            return (bool)out;
+        });
+    }
+
+private:
+    static const uint32_t MAGIC = 0x3148534D;     // "MSH1"
+
+    std::unique_ptr<MappedFile> file;
+
+    static bool stamp(const std::string& model, uint64_t& size, int64_t& time)
+    {
+        std::error_code ec;
+        size = (uint64_t)std::filesystem::file_size(model, ec);
+        if (ec)
+            return false;
+        time = (int64_t)std::filesystem::last_write_time(model, ec).time_since_epoch().count();
+        return !ec;
+    }
+
+    static size_t align(size_t offset)
+    {
+        return (offset + 15) & ~(size_t)15;
+    }
+
+    template<class T>
+    static bool read(const char*& p, const char* end, T& value)
+    {
+        if ((size_t)(end - p) < sizeof(T))
+            return false;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    static bool readString(const char*& p, const char* end, std::string& value)
+    {
+        uint32_t length;
+        if (!read(p, end, length) || (size_t)(end - p) < length)
+            return false;
+        value.assign(p, length);
+        p += length;
+        return true;
+    }
+
+    template<class T>
+    static void write(std::ofstream& out, const T& value)
+    {
+        out.write((const char*)&value, sizeof(T));
+    }
+
+    static void writeString(std::ofstream& out, const std::string& value)
+    {
+        write(out, (uint32_t)value.size());
+        out.write(value.data(), (std::streamsize)value.size());
+    }
+
+    static void pad(std::ofstream& out)
+    {
+        size_t offset = (size_t)out.tellp();
+        static const char zeros[16] = {};
+        out.write(zeros, (std::streamsize)(align(offset) - offset));
+    }
+
+    // Texture::type apunta a un literal: los nombres leidos se llevan a los de Mesh::bindTextures
+    static const char* internType(const std::string& type)
+    {
+        static const char* const types[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+        for (const char* known : types)
+            if (type == known)
+                return known;
+        return types[0];
+    }
+};
+#endif
@@ -0,0 +1,315 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glm/glm.hpp>
+
+#include "utils/import_arena.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MESHLETS_SSE
+#include <xmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Rango de indices a dibujar (en indices, no bytes) de un mesh
+struct IndexRange
+{
+    unsigned int First, Count;
+};
+
+// Meshlets de un mesh: grupos de hasta MaxTriangles triangulos vecinos y con normales parecidas, cada uno
+// contiguo en el index buffer (Build reordena los triangulos), con esfera envolvente y cono de normales.
+// Cull descarta los que quedan fuera del frustum o que miran enteros para atras y devuelve los rangos de
+// indices que sobreviven, ya juntando los consecutivos, para un glMultiDrawElements.
+// Los bounds se guardan en SoA, rellenados a multiplo de 4, y se prueban de a 4 con SSE.
+class Meshlets
+{
+public:
+    static const unsigned int MaxTriangles = 64;
+    // coseno minimo entre la normal de un triangulo y la normal media del meshlet para sumarlo
+    static constexpr float MinNormalDot = 0.7f;
+
+    // por meshlet: primer indice y cantidad
+    std::vector<unsigned int> First, Count;
+    // esfera (espacio del modelo) y cono de normales: el meshlet mira para atras entero si
+    // dot(centro - camara, eje) >= Cutoff * |centro - camara| + radio
+    std::vector<float> CenterX, CenterY, CenterZ, Radius;
+    std::vector<float> AxisX, AxisY, AxisZ, Cutoff;
+
+    size_t Size() const
+    {
+        return First.size();
+    }
+
+    size_t MemoryBytes() const
+    {
+        return (First.capacity() + Count.capacity()) * sizeof(unsigned int)
+            + (CenterX.capacity() + CenterY.capacity() + CenterZ.capacity() + Radius.capacity()
+               + AxisX.capacity() + AxisY.capacity() + AxisZ.capacity() + Cutoff.capacity()) * sizeof(float);
+    }
+
+    // agrupa los triangulos de 'indices' y escribe en 'ordered' los mismos triangulos, meshlet por meshlet.
+    // positions tiene 'stride' bytes entre vertices. Los temporales salen de 'scratch'.
+    void Build(const unsigned char* positions, size_t stride, unsigned int vertexCount,
+               const unsigned int* indices, unsigned int indexCount, unsigned int* ordered, ImportArena& scratch)
+    {
+        clear();
+        unsigned int triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+            return;
+        auto position = [&](unsigned int v) {
+            return *reinterpret_cast<const glm::vec3*>(positions + (size_t)v * stride);
+        };
+
+        // 1. vertices soldados por posicion: los importadores que repiten vertices por cara (Assimp con OBJ)
+        // igual tienen vecinos
+        unsigned int* weld = scratch.Allocate<unsigned int>(vertexCount);
+        unsigned int tableSize = 16;
+        while (tableSize < vertexCount * 2u)
+            tableSize <<= 1;
+        unsigned int* table = scratch.Allocate<unsigned int>(tableSize);
+        std::fill(table, table + tableSize, 0xFFFFFFFFu);
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            glm::vec3 p = position(v);
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            unsigned int slot = (bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u) & (tableSize - 1);
+            while (table[slot] != 0xFFFFFFFFu && position(table[slot]) != p)
+                slot = (slot + 1) & (tableSize - 1);
+            if (table[slot] == 0xFFFFFFFFu)
+                table[slot] = v;
+            weld[v] = table[slot];
+        }
+
+        // 2. triangulos de cada vertice soldado (CSR) y normal de cada triangulo
+        unsigned int* adjacencyStart = scratch.Allocate<unsigned int>(vertexCount + 1);
+        std::fill(adjacencyStart, adjacencyStart + vertexCount + 1, 0u);
+        for (unsigned int i = 0; i < triangleCount * 3; ++i)
+            ++adjacencyStart[weld[indices[i]] + 1];
+        for (unsigned int v = 0; v < vertexCount; ++v)
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        unsigned int* adjacency = scratch.Allocate<unsigned int>(triangleCount * 3);
+        unsigned int* cursor = scratch.Allocate<unsigned int>(vertexCount);
+        std::copy(adjacencyStart, adjacencyStart + vertexCount, cursor);
+        for (unsigned int i = 0; i < triangleCount * 3; ++i)
+            adjacency[cursor[weld[indices[i]]]++] = i / 3;
+
+        glm::vec3* normals = scratch.Allocate<glm::vec3>(triangleCount);
+        for (unsigned int t = 0; t < triangleCount; ++t) {
+            glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float length = glm::length(n);
+            normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+        }
+
+        // 3. crecimiento en anchura desde una semilla; los vecinos rechazados por la normal son las semillas
+        // de los meshlets siguientes, asi los meshlets consecutivos quedan cerca
+        unsigned int* stamp = scratch.Allocate<unsigned int>(triangleCount);
+        std::fill(stamp, stamp + triangleCount, 0xFFFFFFFFu);
+        // cada triangulo entra una sola vez a la frontera de un meshlet (stamp)
+        unsigned int* frontier = scratch.Allocate<unsigned int>(triangleCount);
+        // cola circular de semillas; si se llena se descartan (queda el recorrido en orden)
+        unsigned int* seeds = scratch.Allocate<unsigned int>(triangleCount);
+        size_t seedHead = 0, seedCount = 0;
+        auto pushSeed = [&](unsigned int t) {
+            if (seedCount < triangleCount)
+                seeds[(seedHead + seedCount++) % triangleCount] = t;
+        };
+        unsigned int nextUnassigned = 0, written = 0;
+        const unsigned int ASSIGNED = 0xFFFFFFFEu;
+
+        while (written < triangleCount * 3) {
+            unsigned int seed = 0xFFFFFFFFu;
+            while (seedCount > 0 && seed == 0xFFFFFFFFu) {
+                unsigned int candidate = seeds[seedHead];
+                seedHead = (seedHead + 1) % triangleCount;
+                --seedCount;
+                if (stamp[candidate] != ASSIGNED)
+                    seed = candidate;
+            }
+            if (seed == 0xFFFFFFFFu) {
+                while (stamp[nextUnassigned] == ASSIGNED)
+                    ++nextUnassigned;
+                seed = nextUnassigned;
+            }
+            unsigned int meshlet = (unsigned int)Size();
+            unsigned int first = written, triangles = 0;
+            glm::vec3 normalSum(0.0f);
+            size_t head = 0, tail = 0;
+            frontier[tail++] = seed;
+            stamp[seed] = meshlet;
+            while (head < tail && triangles < MaxTriangles) {
+                unsigned int t = frontier[head++];
+                if (stamp[t] == ASSIGNED)
+                    continue;
+                if (triangles > 0 && glm::dot(normals[t], glm::normalize(normalSum)) < MinNormalDot) {
+                    pushSeed(t);
+                    continue;
+                }
+                stamp[t] = ASSIGNED;
+                normalSum += normals[t];
+                if (glm::dot(normalSum, normalSum) == 0.0f)
+                    normalSum = glm::vec3(0.0f, 0.0f, 1e-6f);
+                ordered[written++] = indices[t * 3];
+                ordered[written++] = indices[t * 3 + 1];
+                ordered[written++] = indices[t * 3 + 2];
+                ++triangles;
+                for (int k = 0; k < 3; ++k) {
+                    unsigned int v = weld[indices[t * 3 + k]];
+                    for (unsigned int a = adjacencyStart[v]; a < adjacencyStart[v + 1]; ++a) {
+                        unsigned int u = adjacency[a];
+                        if (stamp[u] != ASSIGNED && stamp[u] != meshlet) {
+                            stamp[u] = meshlet;
+                            frontier[tail++] = u;
+                        }
+                    }
+                }
+            }
+            // lo que quedo en la frontera tambien es vecino: semillas para despues
+            for (; head < tail; ++head)
+                if (stamp[frontier[head]] != ASSIGNED)
+                    pushSeed(frontier[head]);
+            addMeshlet(position, ordered, first, written - first);
+        }
+        pad();
+    }
+
+    // Prueba todos los meshlets contra los 6 planos del frustum y la posicion de la camara, ambos en el
+    // espacio del modelo, y agrega a 'ranges' los rangos visibles (juntando los consecutivos).
+    // Devuelve cuantos meshlets pasaron.
+    size_t Cull(const glm::vec4 planes[6], const glm::vec3& camera, std::vector<IndexRange>& ranges) const
+    {
+        size_t count = Size(), visibleCount = 0;
+        size_t padded = CenterX.size();
+        bool open = false;
+        auto emit = [&](size_t m, bool visible) {
+            if (m >= count)
+                return;
+            if (!visible) {
+                open = false;
+                return;
+            }
+            ++visibleCount;
+            if (open)
+                ranges.back().Count += Count[m];
+            else
+                ranges.push_back({ First[m], Count[m] });
+            open = true;
+        };
+
+        size_t m = 0;
+#ifdef MESHLETS_SSE
+        __m128 pa[6], pb[6], pc[6], pd[6];
+        for (int p = 0; p < 6; ++p) {
+            pa[p] = _mm_set1_ps(planes[p].x);
+            pb[p] = _mm_set1_ps(planes[p].y);
+            pc[p] = _mm_set1_ps(planes[p].z);
+            pd[p] = _mm_set1_ps(planes[p].w);
+        }
+        __m128 camX = _mm_set1_ps(camera.x), camY = _mm_set1_ps(camera.y), camZ = _mm_set1_ps(camera.z);
+        for (; m + 4 <= padded; m += 4) {
+            __m128 x = _mm_loadu_ps(&CenterX[m]), y = _mm_loadu_ps(&CenterY[m]), z = _mm_loadu_ps(&CenterZ[m]);
+            __m128 r = _mm_loadu_ps(&Radius[m]);
+            __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; ++p) {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[p], x), _mm_mul_ps(pb[p], y)), _mm_add_ps(_mm_mul_ps(pc[p], z), pd[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+            }
+            __m128 vx = _mm_sub_ps(x, camX), vy = _mm_sub_ps(y, camY), vz = _mm_sub_ps(z, camZ);
+            __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+            __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&AxisX[m])), _mm_mul_ps(vy, _mm_loadu_ps(&AxisY[m]))),
+                                      _mm_mul_ps(vz, _mm_loadu_ps(&AxisZ[m])));
+            __m128 backfacing = _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&Cutoff[m]), distance), r));
+            int mask = _mm_movemask_ps(_mm_andnot_ps(backfacing, inside));
+            for (int l = 0; l < 4; ++l)
+                emit(m + l, (mask >> l) & 1);
+        }
+#endif
+        for (; m < count; ++m) {
+            glm::vec3 c(CenterX[m], CenterY[m], CenterZ[m]);
+            bool visible = true;
+            for (int p = 0; p < 6 && visible; ++p)
+                visible = planes[p].x * c.x + planes[p].y * c.y + planes[p].z * c.z + planes[p].w >= -Radius[m];
+            glm::vec3 v = c - camera;
+            if (visible && glm::dot(v, glm::vec3(AxisX[m], AxisY[m], AxisZ[m])) >= Cutoff[m] * glm::length(v) + Radius[m])
+                visible = false;
+            emit(m, visible);
+        }
+        return visibleCount;
+    }
+
+private:
+    void clear()
+    {
+        for (std::vector<unsigned int>* v : { &First, &Count })
+            v->clear();
+        for (std::vector<float>* v : { &CenterX, &CenterY, &CenterZ, &Radius, &AxisX, &AxisY, &AxisZ, &Cutoff })
+            v->clear();
+    }
+
+    template <typename Position>
+    void addMeshlet(const Position& position, const unsigned int* ordered, unsigned int first, unsigned int count)
+    {
+        glm::vec3 mn(1e30f), mx(-1e30f), normalSum(0.0f);
+        for (unsigned int i = first; i < first + count; ++i) {
+            mn = glm::min(mn, position(ordered[i]));
+            mx = glm::max(mx, position(ordered[i]));
+        }
+        glm::vec3 center = (mn + mx) * 0.5f;
+        float radius = 0.0f;
+        for (unsigned int i = first; i < first + count; i += 3) {
+            glm::vec3 a = position(ordered[i]), b = position(ordered[i + 1]), c = position(ordered[i + 2]);
+            radius = std::max(radius, std::max(glm::length(a - center), std::max(glm::length(b - center), glm::length(c - center))));
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float length = glm::length(n);
+            if (length > 0.0f)
+                normalSum += n / length;
+        }
+        // cono: eje = normal media, apertura = el triangulo mas desviado. Si pasa de ~84 grados no se descarta nunca
+        // (Cutoff = 1: la proyeccion sobre el eje nunca supera la distancia mas el radio)
+        float axisLength = glm::length(normalSum);
+        glm::vec3 axis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+        for (unsigned int i = first; i < first + count; i += 3) {
+            glm::vec3 a = position(ordered[i]), b = position(ordered[i + 1]), c = position(ordered[i + 2]);
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float length = glm::length(n);
+            if (length > 0.0f)
+                minDot = std::min(minDot, glm::dot(n / length, axis));
+        }
+        First.push_back(first);
+        Count.push_back(count);
+        CenterX.push_back(center.x);
+        CenterY.push_back(center.y);
+        CenterZ.push_back(center.z);
+        Radius.push_back(radius);
+        AxisX.push_back(axis.x);
+        AxisY.push_back(axis.y);
+        AxisZ.push_back(axis.z);
+        // sin(apertura): con un cono de media apertura a, todo triangulo mira para atras si el angulo entre
+        // la vista y el eje es menor que 90 - a
+        Cutoff.push_back(minDot > 0.1f ? std::sqrt(1.0f - minDot * minDot) : 1.0f);
+    }
+
+    // relleno a multiplo de 4 para el loop SSE (esferas fuera de todo frustum, no se emiten)
+    void pad()
+    {
+        while (CenterX.size() % 4 != 0) {
+            CenterX.push_back(0.0f);
+            CenterY.push_back(0.0f);
+            CenterZ.push_back(0.0f);
+            Radius.push_back(-1e30f);
+            AxisX.push_back(0.0f);
+            AxisY.push_back(0.0f);
+            AxisZ.push_back(0.0f);
+            Cutoff.push_back(0.0f);
+        }
+    }
+};
+#endif
@@ -11,9 +11,17 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "utils/atomic_file.h"
+#include "utils/import_arena.h"
 #include "utils/mesh.h"
+#include "utils/mesh_cache.h"
+#include "utils/obj_loader.h"
 #include "utils/shader.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -22,7 +30,10 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const aiString& path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const aiString& path, const string &directory, bool gamma = false, size_t* bytes = nullptr);
+
+// which importer reads a model file: Auto uses the native ObjLoader for .obj files and Assimp for the rest
+enum class ModelImporter { Auto, Assimp, Obj };
 
 class Model 
 {
@@ -31,12 +42,78 @@ public:
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
     string directory;
+    string path;
     bool gammaCorrection;
+    // true once a per-vertex AO bake was loaded or assigned
+    bool bakedAO = false;
+    // axis-aligned bounds of all meshes, in model space
+    glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+    glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+
+    // read the meshes from / write them to the binary mesh cache next to the model file (see MeshCache);
+    // the default for the constructor's useMeshCache
+    inline static bool UseMeshCache = false;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // keepCpuData = false uploads the meshes without keeping vertex/index copies (RestoreCpuData reads them back)
+    // if the native OBJ loader fails the file is read with Assimp instead
+    Model(string const &path, bool gamma = false, bool keepCpuData = true, ModelImporter importer = ModelImporter::Auto,
+          bool useMeshCache = UseMeshCache)
+        : path(path), gammaCorrection(gamma)
     {
-        loadModel(path);
+        if (!useMeshCache || !loadMeshCache(path, keepCpuData))
+        {
+            bool native = importer == ModelImporter::Obj || (importer == ModelImporter::Auto && ObjLoader::IsObj(path));
+            if (!native || !loadObj(path, keepCpuData))
+                loadModel(path, keepCpuData);
+            if (useMeshCache && !meshes.empty())
+                SaveMeshCache();
+        }
+        LoadBakedAO(BakedAOPath());
+    }
+
+    // times Assimp::Importer::ReadFile (same post-processing as loadModel) against ObjLoader::Load on one file.
+    // Only the CPU side is measured: no textures or buffers are created.
+    static void BenchmarkImporters(string const &path, int repetitions, ostream &out)
+    {
+        double assimpBest = 1e30, assimpTotal = 0.0, objBest = 1e30, objTotal = 0.0;
+        size_t assimpVertices = 0, objVertices = 0;
+        ObjLoader loader;
+        bool ok = true;
+        for (int r = 0; r < repetitions && ok; r++)
+        {
+            auto start = chrono::steady_clock::now();
+            {
+                Assimp::Importer importer;
+                const aiScene* scene = importer.ReadFile(path, aiProcess_CalcTangentSpace | aiProcess_Triangulate);
+                ok = scene && scene->mRootNode && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE);
+                assimpVertices = 0;
+                for (unsigned int m = 0; ok && m < scene->mNumMeshes; m++)
+                    assimpVertices += scene->mMeshes[m]->mNumVertices;
+            }
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            assimpBest = std::min(assimpBest, ms);
+            assimpTotal += ms;
+
+            vector<ObjMesh> objMeshes;
+            start = chrono::steady_clock::now();
+            ok = ok && loader.Load(path, objMeshes);
+            ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            objBest = std::min(objBest, ms);
+            objTotal += ms;
+            objVertices = loader.Stats.Vertices;
+        }
+        if (!ok)
+        {
+            out << path << ": import failed " << loader.Error << endl;
+            return;
+        }
+        out << path << " (" << loader.Stats.Bytes / 1024 << " KB, " << loader.Stats.Triangles << " triangles)\n"
+            << "  Assimp:    best " << assimpBest << " ms, mean " << assimpTotal / repetitions << " ms, " << assimpVertices << " vertices\n"
+            << "  ObjLoader: best " << objBest << " ms, mean " << objTotal / repetitions << " ms, " << objVertices << " vertices ("
+            << loader.Stats.Chunks << " chunks: parse " << loader.Stats.ParseMs << " ms, merge " << loader.Stats.MergeMs
+            << " ms, tangents " << loader.Stats.TangentMs << " ms)\n"
+            << "  speedup x" << assimpBest / std::max(objBest, 1e-6) << endl;
     }
 
     // draws the model, and thus all its meshes
@@ -45,10 +122,241 @@ public:
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // draws 'count' instances of the model, each one 'repeat' times (see Mesh::DrawInstanced)
+    void DrawInstanced(Shader &shader, unsigned int instanceVBO, size_t offset, unsigned int count, bool depthOnly = false, unsigned int repeat = 1)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, instanceVBO, offset, count, depthOnly, repeat);
+    }
+
+    // bounding sphere enclosing the model bounds (model space)
+    glm::vec3 BoundsCenter() const
+    {
+        return (boundsMin + boundsMax) * 0.5f;
+    }
+    float BoundsRadius() const
+    {
+        return glm::length(boundsMax - boundsMin) * 0.5f;
+    }
+
+    // CPU copies of the mesh data (see Mesh::ReleaseCpuData)
+    bool HasCpuData() const
+    {
+        for (const Mesh& mesh : meshes)
+            if (!mesh.HasCpuData())
+                return false;
+        return true;
+    }
+    void ReleaseCpuData()
+    {
+        for (Mesh& mesh : meshes)
+            mesh.ReleaseCpuData();
+    }
+    void RestoreCpuData()
+    {
+        for (Mesh& mesh : meshes)
+            mesh.RestoreCpuData();
+    }
+
+    // frees the meshes' buffers and the loaded textures (the model can't be drawn afterwards); GL objects
+    // are not deleted by the destructor, so call this before dropping a model while the context lives on
+    void ReleaseGpuData()
+    {
+        for (Mesh& mesh : meshes)
+            mesh.ReleaseGpuData();
+        for (Texture& texture : textures_loaded)
+            GLState::Get().DeleteTextures(1, &texture.id);
+        textures_loaded.clear();
+    }
+
+    // adds the meshes and the textures of this model to the report
+    void Memory(MemoryReport& report, const string& name) const
+    {
+        MemoryUsage meshUsage(meshes.capacity() * sizeof(Mesh), 0), textureUsage(textures_loaded.capacity() * sizeof(Texture), 0);
+        for (const Mesh& mesh : meshes)
+            meshUsage += mesh.Memory();
+        for (const Texture& texture : textures_loaded)
+            textureUsage.Gpu += texture.bytes;
+        report.Add("Meshes", name, meshUsage);
+        report.Add("Textures", name, textureUsage);
+    }
+
+    // writes the meshes to the mesh cache (<model>.mesh); the vertices are read back from the GPU if they were released
+    bool SaveMeshCache()
+    {
+        bool restored = !HasCpuData();
+        RestoreCpuData();
+        vector<MeshCache::MeshData> data;
+        for (const Mesh& mesh : meshes)
+        {
+            MeshCache::MeshData entry = { mesh.vertices.data(), mesh.VertexCount, mesh.indices.data(), mesh.IndexCount, {} };
+            for (const Texture& texture : mesh.textures)
+                for (const Texture& loaded : textures_loaded)
+                    if (loaded.id == texture.id)
+                    {
+                        entry.Textures.push_back({ texture.type, loaded.path });
+                        break;
+                    }
+            data.push_back(std::move(entry));
+        }
+        bool saved = MeshCache::Write(path, data);
+        if (restored)
+            ReleaseCpuData();
+        return saved;
+    }
+
+    // baked AO lives next to the model file: <model>.ao
+    string BakedAOPath() const
+    {
+        return path + ".ao";
+    }
+
+    // assigns per-vertex AO to every mesh (see AOBaker)
+    void SetBakedAO(const vector<vector<float>>& ao)
+    {
+        if (ao.size() != meshes.size())
+            return;
+        for (size_t m = 0; m < meshes.size(); m++)
+            meshes[m].SetBakedAO(ao[m]);
+        bakedAO = true;
+    }
+
+    // file layout: "AOB1", mesh count, then per mesh its vertex count and one float per vertex.
+    // Written atomically: CpuModel readers in other processes never see a partial bake
+    bool SaveBakedAO(const string& file, const vector<vector<float>>& ao) const
+    {
+        return WriteFileAtomic(file, [&ao](ofstream& out) {
+            uint32_t header[2] = { AO_MAGIC, (uint32_t)ao.size() };
+            out.write((const char*)header, sizeof(header));
+            for (const vector<float>& values : ao)
+            {
+                uint32_t count = (uint32_t)values.size();
+                out.write((const char*)&count, sizeof(count));
+                out.write((const char*)values.data(), values.size() * sizeof(float));
+            }
+            return (bool)out;
+        });
+    }
+
+    // loads a bake if it exists and matches the meshes (a stale bake of an edited model is ignored)
+    bool LoadBakedAO(const string& file)
+    {
+        vector<unsigned int> counts;
+        for (const Mesh& mesh : meshes)
+            counts.push_back(mesh.VertexCount);
+        vector<vector<float>> ao;
+        if (!ReadBakedAO(file, counts, ao))
+            return false;
+        SetBakedAO(ao);
+        return true;
+    }
+
+    // reads a bake without uploading it, checked against the vertex count of each mesh (also used without
+    // a Model or a GL context; see CpuModel)
+    static bool ReadBakedAO(const string& file, const vector<unsigned int>& vertexCounts, vector<vector<float>>& ao)
+    {
+        ifstream in(file, ios::binary);
+        if (!in)
+            return false;
+        uint32_t header[2];
+        if (!in.read((char*)header, sizeof(header)) || header[0] != AO_MAGIC || header[1] != vertexCounts.size())
+            return false;
+        ao.assign(vertexCounts.size(), vector<float>());
+        for (size_t m = 0; m < vertexCounts.size(); m++)
+        {
+            uint32_t count;
+            if (!in.read((char*)&count, sizeof(count)) || count != vertexCounts[m])
+                return false;
+            ao[m].resize(count);
+            if (!in.read((char*)ao[m].data(), count * sizeof(float)))
+                return false;
+        }
+        return true;
+    }
     
 private:
+    static const uint32_t AO_MAGIC = 0x31424F41;  // "AOB1"
+
+    // native OBJ path: meshes come out of ObjLoader already triangulated, deduplicated and with tangents
+    bool loadObj(string const &path, bool keepCpuData)
+    {
+        ObjLoader loader;
+        vector<ObjMesh> objMeshes;
+        if (!loader.Load(path, objMeshes))
+        {
+            cout << "ObjLoader: " << loader.Error << ", falling back to Assimp" << endl;
+            return false;
+        }
+        directory = path.substr(0, path.find_last_of('/'));
+
+        ImportArena scratch;
+        meshes.reserve(objMeshes.size());
+        for (ObjMesh& objMesh : objMeshes)
+        {
+            for (const Vertex& vertex : objMesh.Vertices)
+            {
+                boundsMin = glm::min(boundsMin, vertex.Position);
+                boundsMax = glm::max(boundsMax, vertex.Position);
+            }
+            vector<Texture> textures;
+            if (!objMesh.DiffuseMap.empty())
+                loadTexture(aiString(objMesh.DiffuseMap), "texture_diffuse", textures);
+
+            if (keepCpuData)
+            {
+                meshes.emplace_back(std::move(objMesh.Vertices), std::move(objMesh.Indices), std::move(textures));
+                continue;
+            }
+            scratch.Reset();
+            meshes.emplace_back(objMesh.Vertices.data(), (unsigned int)objMesh.Vertices.size(), objMesh.Indices.data(),
+                                (unsigned int)objMesh.Indices.size(), std::move(textures), scratch, false);
+            vector<Vertex>().swap(objMesh.Vertices);
+            vector<unsigned int>().swap(objMesh.Indices);
+        }
+        return true;
+    }
+
+    // mesh cache path: the buffers are filled straight from the mapped file (nothing is parsed or copied)
+    bool loadMeshCache(string const &path, bool keepCpuData)
+    {
+        MeshCache cache;
+        if (!cache.Open(path) || cache.Meshes.empty())
+            return false;
+        directory = path.substr(0, path.find_last_of('/'));
+
+        ImportArena scratch;
+        meshes.reserve(cache.Meshes.size());
+        for (const MeshCache::MeshData& data : cache.Meshes)
+        {
+            for (unsigned int i = 0; i < data.VertexCount; i++)
+            {
+                boundsMin = glm::min(boundsMin, data.Vertices[i].Position);
+                boundsMax = glm::max(boundsMax, data.Vertices[i].Position);
+            }
+            vector<Texture> textures;
+            for (const MeshCache::TextureRef& texture : data.Textures)
+                loadTexture(aiString(texture.Path), texture.Type, textures);
+            scratch.Reset();
+            meshes.emplace_back(data.Vertices, data.VertexCount, data.Indices, data.IndexCount, std::move(textures), scratch, keepCpuData);
+        }
+        return true;
+    }
+
+    // state shared by the meshes of one import
+    struct Import
+    {
+        const aiScene* scene;
+        bool keepCpuData;
+        // conversion buffers, reused from mesh to mesh
+        ImportArena arena;
+        // textures of each material, resolved the first time a mesh uses it
+        vector<vector<Texture>> materialTextures;
+        vector<bool> materialLoaded;
+    };
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    void loadModel(string const &path, bool keepCpuData)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
@@ -62,46 +370,70 @@ private:
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
+        Import import;
+        import.scene = scene;
+        import.keepCpuData = keepCpuData;
+        import.materialTextures.resize(scene->mNumMaterials);
+        import.materialLoaded.resize(scene->mNumMaterials, false);
+        // one Mesh per node reference, so the vector never reallocates
+        meshes.reserve(countMeshes(scene->mRootNode));
+
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        processNode(scene->mRootNode, import);
+    }
+
+    static size_t countMeshes(const aiNode *node)
+    {
+        size_t count = node->mNumMeshes;
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+            count += countMeshes(node->mChildren[i]);
+        return count;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    void processNode(aiNode *node, Import &import)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            aiMesh* mesh = import.scene->mMeshes[node->mMeshes[i]];
+            processMesh(mesh, import);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], import);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // converts the mesh into the import arena (sized up front, no push_back) and builds the Mesh in place
+    void processMesh(aiMesh *mesh, Import &import)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        // data to fill (the previous mesh is already uploaded, so its buffers are reused)
+        import.arena.Reset();
+        unsigned int vertexCount = mesh->mNumVertices;
+        size_t indexCount = 0;
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+            indexCount += mesh->mFaces[i].mNumIndices;
+        Vertex* vertices = import.arena.Allocate<Vertex>(vertexCount);
+        unsigned int* indices = import.arena.Allocate<unsigned int>(indexCount);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
+            Vertex& vertex = vertices[i];
+            vertex = Vertex();
             glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
             vector.y = mesh->mVertices[i].y;
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
+            boundsMin = glm::min(boundsMin, vector);
+            boundsMax = glm::max(boundsMax, vector);
             // normals
             if (mesh->HasNormals())
             {
@@ -132,19 +464,32 @@ private:
             }
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
         }
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        size_t index = 0;
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
+            const aiFace& face = mesh->mFaces[i];
+            // retrieve all indices of the face and store them in the indices array
             for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);        
+                indices[index++] = face.mIndices[j];
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
+
+        // return a mesh object created from the extracted mesh data (constructed in place, nothing is copied)
+        meshes.emplace_back(vertices, vertexCount, indices, (unsigned int)indexCount, materialTextures(mesh->mMaterialIndex, import),
+                            import.arena, import.keepCpuData);
+    }
+
+    // textures of a material; the list is built once per material and each mesh gets its own copy
+    vector<Texture> materialTextures(unsigned int index, Import &import)
+    {
+        if (index >= import.materialTextures.size())
+            return vector<Texture>();
+        if (import.materialLoaded[index])
+            return import.materialTextures[index];
+        import.materialLoaded[index] = true;
+        vector<Texture>& textures = import.materialTextures[index];
+        aiMaterial* material = import.scene->mMaterials[index];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
         // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
         // Same applies to other texture as the following list summarizes:
@@ -153,58 +498,57 @@ private:
         // normal: texture_normalN
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
         // 2. specular maps
-        //vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        //textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        //loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
         //// 3. normal maps
-        //std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        //textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        //loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
         //// 4. height maps
-        //std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        //textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-        
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        //loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", textures);
+        return textures;
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // the required info is appended to 'textures' as Texture structs (typeName must be a string literal).
+    void loadMaterialTextures(aiMaterial *mat, aiTextureType type, const char* typeName, vector<Texture>& textures)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            loadTexture(str, typeName, textures);
+        }
+    }
+
+    // appends the texture at 'str' (relative to the model directory), loading it only the first time
+    void loadTexture(const aiString &str, const char* typeName, vector<Texture>& textures)
+    {
+        // check if texture was loaded before and if so, skip loading a new texture
+        bool skip = false;
+        for(unsigned int j = 0; j < textures_loaded.size(); j++)
+        {
+            if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str, this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
+                Texture texture = { textures_loaded[j].id, textures_loaded[j].type, string(), textures_loaded[j].bytes };
                 textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+                skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
+                break;
             }
         }
-        return textures;
+        if(!skip)
+        {   // if texture hasn't been loaded already, load it
+            Texture texture;
+            texture.id = TextureFromFile(str, this->directory, false, &texture.bytes);
+            texture.type = typeName;
+            textures.push_back(texture);
+            texture.path = str.C_Str();
+            textures_loaded.push_back(std::move(texture));  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        }
     }
 };
 
 
-unsigned int TextureFromFile(const aiString& str, const string &directory, bool gamma)
+unsigned int TextureFromFile(const aiString& str, const string &directory, bool gamma, size_t* bytes)
 {
     const char* path = str.C_Str();
 
@@ -230,9 +574,12 @@ unsigned int TextureFromFile(const aiString& str, const string &directory, bool
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        // the driver usually pads RGB to 4 bytes per texel; the mip chain adds about a third
+        if (bytes)
+            *bytes = (size_t)width * height * (nrComponents == 3 ? 4 : nrComponents) * 4 / 3;
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
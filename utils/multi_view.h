@@ -0,0 +1,177 @@
+#ifndef MULTI_VIEW_H
+#define MULTI_VIEW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "utils/gl_state.h"
+#include "utils/memory_stats.h"
+#include "utils/shader.h"
+
+#include <iostream>
+#include <vector>
+
+// Targets para renderizar varias vistas en lote (turntables, thumbnails): g-buffer, oclusion y color son
+// arreglos 2D con una capa por vista, y las matrices de cada vista van en un uniform buffer (bloque Views).
+// Cada pase es un solo draw para todas las vistas: la geometria se dibuja instanciada (cada instancia de la
+// escena se repite una vez por vista, ver Mesh::DrawInstanced) y los pases de pantalla completa dibujan un
+// quad por vista; un geometry shader manda cada primitiva a la capa de su vista con gl_Layer (GL 3.3 no
+// permite escribirlo en el vertex shader). Los shaders son los de siempre con la permutacion MULTIVIEW.
+class MultiViewTargets
+{
+public:
+    static const int MAX_VIEWS = 32;       // igual que en multiview.glsl / gbuffer.vert
+    static const int VIEWS_BINDING = 0;     // punto de enlace del bloque Views
+
+    int Width = 0, Height = 0, Layers = 0;
+
+    MultiViewTargets() {}
+    MultiViewTargets(const MultiViewTargets&) = delete;
+    MultiViewTargets& operator=(const MultiViewTargets&) = delete;
+
+    ~MultiViewTargets()
+    {
+        Clear();
+    }
+
+    // realoca los arreglos si cambia el tamanio o el formato de las normales, o si faltan capas (un lote
+    // mas chico usa las primeras)
+    void Resize(int width, int height, int layers, bool octahedral)
+    {
+        layers = std::min(std::max(layers, 1), MAX_VIEWS);
+        if (width == Width && height == Height && layers <= Layers && octahedral == normalOct && position != 0)
+            return;
+        Clear();
+        Width = width;
+        Height = height;
+        Layers = layers;
+        normalOct = octahedral;
+
+        position = createArray(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        normal = octahedral ? createArray(GL_RG16F, GL_RG, GL_FLOAT) : createArray(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        albedo = createArray(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        depth = createArray(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+        occlusion[0] = createArray(GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+        occlusion[1] = createArray(GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+        color = createArray(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+        geometryFBO = createFramebuffer({ position, normal, albedo }, depth);
+        occlusionFBO[0] = createFramebuffer({ occlusion[0] }, 0);
+        occlusionFBO[1] = createFramebuffer({ occlusion[1] }, 0);
+        colorFBO = createFramebuffer({ color }, 0);
+        glGenFramebuffers(1, &layerFBO);
+        GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenBuffers(1, &viewsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, viewsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, 2 * MAX_VIEWS * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // matrices de las vistas (std140: mat4 viewMatrices[MAX_VIEWS]; mat4 projectionMatrices[MAX_VIEWS])
+    void SetViews(const std::vector<glm::mat4>& views, const std::vector<glm::mat4>& projections)
+    {
+        size_t n = std::min(std::min(views.size(), projections.size()), (size_t)MAX_VIEWS);
+        glBindBuffer(GL_UNIFORM_BUFFER, viewsUBO);
+        if (n > 0) {
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, n * sizeof(glm::mat4), views.data());
+            glBufferSubData(GL_UNIFORM_BUFFER, MAX_VIEWS * sizeof(glm::mat4), n * sizeof(glm::mat4), projections.data());
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, VIEWS_BINDING, viewsUBO);
+    }
+
+    // enlaza el bloque Views de un programa MULTIVIEW (para el setup de ShaderPermutations)
+    static void BindViews(Shader& shader)
+    {
+        unsigned int block = glGetUniformBlockIndex(shader.ID, "Views");
+        if (block != GL_INVALID_INDEX)
+            glUniformBlockBinding(shader.ID, block, VIEWS_BINDING);
+    }
+
+    // framebuffers en capas: el geometry shader elige la capa de cada primitiva
+    unsigned int GeometryFramebuffer() const { return geometryFBO; }
+    unsigned int OcclusionFramebuffer(bool blurred) const { return occlusionFBO[blurred ? 1 : 0]; }
+    unsigned int ColorFramebuffer() const { return colorFBO; }
+
+    // arreglos (GL_TEXTURE_2D_ARRAY)
+    unsigned int Position() const { return position; }
+    unsigned int Normal() const { return normal; }
+    unsigned int Albedo() const { return albedo; }
+    unsigned int Occlusion(bool blurred) const { return occlusion[blurred ? 1 : 0]; }
+    unsigned int Color() const { return color; }
+
+    // framebuffer con una sola capa de un arreglo de color en GL_COLOR_ATTACHMENT0 (para leerla, p.ej. con FrameCapture)
+    unsigned int LayerFramebuffer(unsigned int texture, int layer)
+    {
+        GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, layerFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, 0, layer);
+        return layerFBO;
+    }
+
+    MemoryUsage Memory() const
+    {
+        size_t texels = (size_t)Width * Height * Layers;
+        size_t perTexel = 8 + (normalOct ? 4 : 8) + 4 + 4 + 1 + 1 + 4;
+        return MemoryUsage(0, position != 0 ? texels * perTexel + 2 * MAX_VIEWS * sizeof(glm::mat4) : 0);
+    }
+
+    void Clear()
+    {
+        GLState& gl = GLState::Get();
+        unsigned int textures[] = { position, normal, albedo, depth, occlusion[0], occlusion[1], color };
+        for (unsigned int texture : textures)
+            if (texture != 0)
+                gl.DeleteTextures(1, &texture);
+        unsigned int framebuffers[] = { geometryFBO, occlusionFBO[0], occlusionFBO[1], colorFBO, layerFBO };
+        for (unsigned int fbo : framebuffers)
+            if (fbo != 0)
+                gl.DeleteFramebuffers(1, &fbo);
+        if (viewsUBO != 0)
+            glDeleteBuffers(1, &viewsUBO);
+        position = normal = albedo = depth = occlusion[0] = occlusion[1] = color = 0;
+        geometryFBO = occlusionFBO[0] = occlusionFBO[1] = colorFBO = layerFBO = viewsUBO = 0;
+        Width = Height = Layers = 0;
+    }
+
+private:
+    bool normalOct = false;
+    unsigned int position = 0, normal = 0, albedo = 0, depth = 0, occlusion[2] = { 0, 0 }, color = 0;
+    unsigned int geometryFBO = 0, occlusionFBO[2] = { 0, 0 }, colorFBO = 0, layerFBO = 0;
+    unsigned int viewsUBO = 0;
+
+    unsigned int createArray(GLint internalFormat, GLenum format, GLenum type) const
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        // GL_TEXTURE_2D_ARRAY no esta en la cache de GLState: el bind se emite siempre
+        GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, Width, Height, Layers, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    // glFramebufferTexture (sin capa) pega el arreglo entero: el framebuffer queda en capas
+    unsigned int createFramebuffer(const std::vector<unsigned int>& colors, unsigned int depthArray) const
+    {
+        unsigned int fbo;
+        glGenFramebuffers(1, &fbo);
+        GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, fbo);
+        std::vector<unsigned int> drawBuffers;
+        for (unsigned int texture : colors) {
+            unsigned int attachment = GL_COLOR_ATTACHMENT0 + (unsigned int)drawBuffers.size();
+            glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture, 0);
+            drawBuffers.push_back(attachment);
+        }
+        if (depthArray != 0)
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Multi-view framebuffer not complete!" << std::endl;
+        return fbo;
+    }
+};
+#endif
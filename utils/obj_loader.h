@@ -0,0 +1,775 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include "utils/mesh.h"
+#include "utils/thread_pool.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OBJ_LOADER_SSE
+#include <xmmintrin.h>
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Archivo mapeado en memoria, solo lectura
+class MappedFile
+{
+public:
+    MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+            return;
+        bytes = (size_t)size.QuadPart;
+        valid = true;
+        if (bytes == 0)
+            return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr)
+            data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        valid = data != nullptr;
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+            return;
+        bytes = (size_t)info.st_size;
+        valid = true;
+        if (bytes == 0)
+            return;
+        void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            data = (const char*)p;
+            madvise(p, bytes, MADV_SEQUENTIAL);
+        }
+        valid = data != nullptr;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (data)
+            munmap((void*)data, bytes);
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Valid() const { return valid; }
+    const char* Data() const { return data; }
+    size_t Size() const { return bytes; }
+
+private:
+    const char* data = nullptr;
+    size_t bytes = 0;
+    bool valid = false;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// Un mesh del .obj por material, listo para subir: vertices sin repetir (posicion/uv/normal), indices de
+// triangulos, tangentes y bitangentes. DiffuseMap es el map_Kd del .mtl, relativo al directorio del .obj
+struct ObjMesh
+{
+    std::vector<Vertex> Vertices;
+    std::vector<unsigned int> Indices;
+    std::string Material, DiffuseMap;
+};
+
+// Cargador de Wavefront OBJ/MTL como alternativa a Assimp para los modelos del proyecto.
+// El archivo se mapea en memoria y se corta en bloques alineados a lineas que se parsean en paralelo en el
+// ThreadPool (los floats con un parser propio, sin locale ni strtod). Despues se juntan los streams de cada
+// bloque (los indices negativos de OBJ se resuelven con la cantidad de elementos de los bloques anteriores),
+// se triangulan las caras en abanico, se agrupan por material y se arman los vertices sin repetir. Las
+// tangentes se calculan de a 4 triangulos con SSE (o con el mismo codigo escalar si no hay SSE).
+// Soporta v, vt, vn, f, usemtl y mtllib; lo demas (o, g, s, l, p...) se ignora.
+class ObjLoader
+{
+public:
+    struct Statistics
+    {
+        size_t Bytes = 0, Chunks = 0, Positions = 0, Triangles = 0, Vertices = 0;
+        double ParseMs = 0.0, MergeMs = 0.0, TangentMs = 0.0;
+    };
+
+    Statistics Stats;
+    std::string Error;
+
+    // bloques de al menos este tamanio (archivos mas chicos se parsean en un solo hilo)
+    size_t MinChunkBytes = 64 * 1024;
+
+    static bool IsObj(const std::string& path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos)
+            return false;
+        std::string ext = path.substr(dot + 1);
+        for (char& c : ext)
+            c = (char)tolower((unsigned char)c);
+        return ext == "obj";
+    }
+
+    bool Load(const std::string& path, std::vector<ObjMesh>& meshes)
+    {
+        Stats = Statistics();
+        Error.clear();
+        meshes.clear();
+        auto start = std::chrono::steady_clock::now();
+
+        MappedFile file(path);
+        if (!file.Valid()) {
+            Error = "cannot open " + path;
+            return false;
+        }
+        Stats.Bytes = file.Size();
+
+        // 1. bloques alineados a lineas, parseados en paralelo
+        std::vector<Chunk> chunks = split(file.Data(), file.Size());
+        Stats.Chunks = chunks.size();
+        ThreadPool::Get().ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c)
+                parse(chunks[c]);
+        });
+        for (const Chunk& chunk : chunks)
+            if (!chunk.Error.empty()) {
+                Error = chunk.Error;
+                return false;
+            }
+        auto parsed = std::chrono::steady_clock::now();
+
+        // 2. streams de atributos concatenados y caras resueltas a indices absolutos
+        Streams streams;
+        if (!merge(chunks, streams))
+            return false;
+
+        // 3. un mesh por material, en orden de aparicion
+        std::vector<std::vector<unsigned int>> faceMaterial;    // id de material de cada cara, por bloque
+        std::vector<std::string> materialNames;
+        assignMaterials(chunks, faceMaterial, materialNames);
+        std::vector<std::vector<Corner>> triangles(materialNames.size());
+        triangulate(chunks, faceMaterial, triangles);
+        chunks.clear();
+
+        std::map<std::string, std::string> diffuseMaps = loadMaterials(path, streams.Libraries);
+        for (size_t m = 0; m < triangles.size(); ++m) {
+            if (triangles[m].empty())
+                continue;
+            ObjMesh mesh;
+            mesh.Material = materialNames[m];
+            auto found = diffuseMaps.find(mesh.Material);
+            if (found != diffuseMaps.end())
+                mesh.DiffuseMap = found->second;
+            meshes.push_back(std::move(mesh));
+            triangles[meshes.size() - 1].swap(triangles[m]);
+        }
+        triangles.resize(meshes.size());
+        // sin caras no hay nada que cargar (archivo vacio, solo puntos o lineas...): que lo intente Assimp
+        if (meshes.empty()) {
+            Error = "no triangles in " + path;
+            return false;
+        }
+
+        // vertices de cada mesh (cada uno en su hilo)
+        std::vector<char> hasTexCoords(meshes.size(), 0);
+        ThreadPool::Get().ParallelFor(meshes.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t m = begin; m < end; ++m)
+                hasTexCoords[m] = build(streams, triangles[m], meshes[m]);
+        });
+        auto merged = std::chrono::steady_clock::now();
+
+        // 4. tangentes (como aiProcess_CalcTangentSpace: solo si hay coordenadas de textura)
+        for (size_t m = 0; m < meshes.size(); ++m) {
+            if (hasTexCoords[m])
+                computeTangents(meshes[m]);
+            Stats.Vertices += meshes[m].Vertices.size();
+            Stats.Triangles += meshes[m].Indices.size() / 3;
+        }
+        auto done = std::chrono::steady_clock::now();
+
+        Stats.Positions = streams.Positions.size() / 3;
+        Stats.ParseMs = std::chrono::duration<double, std::milli>(parsed - start).count();
+        Stats.MergeMs = std::chrono::duration<double, std::milli>(merged - parsed).count();
+        Stats.TangentMs = std::chrono::duration<double, std::milli>(done - merged).count();
+        return true;
+    }
+
+private:
+    static const int MISSING = 0;     // indice ausente (f v//vn): OBJ empieza en 1
+
+    // esquina de una cara: indices de posicion, uv y normal. Al parsear quedan como en el archivo (base 1)
+    // o, si eran negativos, relativos al bloque (bits de Relative); merge() los pasa a absolutos base 0 (-1 = no hay)
+    struct Corner
+    {
+        int V = MISSING, T = MISSING, N = MISSING;
+        int Relative = 0;
+    };
+
+    struct MaterialUse
+    {
+        size_t Face;        // primera cara del bloque que lo usa
+        std::string Name;
+    };
+
+    struct Chunk
+    {
+        const char* Begin;
+        const char* End;
+        std::vector<float> Positions, TexCoords, Normals;   // 3, 2 y 3 floats por elemento
+        std::vector<Corner> Corners;
+        std::vector<unsigned int> FaceEnds;                 // fin (exclusivo) de cada cara en Corners
+        std::vector<MaterialUse> Materials;
+        std::vector<std::string> Libraries;
+        std::string Error;
+        size_t PositionBase = 0, TexCoordBase = 0, NormalBase = 0;
+    };
+
+    struct Streams
+    {
+        std::vector<float> Positions, TexCoords, Normals;
+        std::vector<std::string> Libraries;
+    };
+
+    std::vector<Chunk> split(const char* data, size_t size)
+    {
+        size_t threads = ThreadPool::Get().Size();
+        size_t count = std::max<size_t>(1, std::min(threads * 4, size / std::max<size_t>(MinChunkBytes, 1)));
+        std::vector<Chunk> chunks;
+        const char* end = data + size;
+        const char* begin = data;
+        for (size_t c = 0; c < count && begin < end; ++c) {
+            const char* cut = c + 1 == count ? end : data + size * (c + 1) / count;
+            if (cut < begin)
+                cut = begin;
+            // cortar despues del proximo salto de linea
+            const char* newline = cut < end ? (const char*)memchr(cut, '\n', end - cut) : nullptr;
+            cut = newline ? newline + 1 : end;
+            Chunk chunk;
+            chunk.Begin = begin;
+            chunk.End = cut;
+            chunks.push_back(std::move(chunk));
+            begin = cut;
+        }
+        return chunks;
+    }
+
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p))
+            ++p;
+        return p;
+    }
+
+    // float decimal con signo, parte fraccionaria y exponente opcionales
+    static const char* parseFloat(const char* p, const char* end, float& out)
+    {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        p = skipSpaces(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        const char* start = p;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+            }
+            else {
+                ++exponent;
+            }
+        }
+        if (p < end && *p == '.') {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits += mantissa != 0;
+                    --exponent;
+                }
+            }
+        }
+        if (p == start)
+            return nullptr;
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+'))
+                negativeExponent = *p++ == '-';
+            int e = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p)
+                e = std::min(e * 10 + (*p - '0'), 1000);
+            exponent += negativeExponent ? -e : e;
+        }
+        double value = (double)mantissa;
+        if (exponent < 0)
+            value = -exponent <= 22 ? value / powers[-exponent] : value * std::pow(10.0, exponent);
+        else if (exponent > 0)
+            value = exponent <= 22 ? value * powers[exponent] : value * std::pow(10.0, exponent);
+        out = (float)(negative ? -value : value);
+        return p;
+    }
+
+    static const char* parseInt(const char* p, const char* end, int& out)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        const char* start = p;
+        long long value = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+            value = std::min(value * 10 + (*p - '0'), 0x7FFFFFFFll);
+        if (p == start)
+            return nullptr;
+        out = (int)(negative ? -value : value);
+        return p;
+    }
+
+    static std::string restOfLine(const char* p, const char* end)
+    {
+        p = skipSpaces(p, end);
+        while (end > p && isSpace(end[-1]))
+            --end;
+        return std::string(p, end);
+    }
+
+    static bool keyword(const char* p, const char* end, const char* word, size_t length)
+    {
+        return (size_t)(end - p) > length && std::memcmp(p, word, length) == 0 && isSpace(p[length]);
+    }
+
+    // corre en un hilo del pool
+    static void parse(Chunk& chunk)
+    {
+        const char* p = chunk.Begin;
+        while (p < chunk.End) {
+            const char* lineEnd = (const char*)memchr(p, '\n', chunk.End - p);
+            if (!lineEnd)
+                lineEnd = chunk.End;
+            const char* lineStart = p = skipSpaces(p, lineEnd);
+            bool ok = true;
+            if (p + 1 < lineEnd && p[0] == 'v') {
+                float values[3] = { 0.0f, 0.0f, 0.0f };
+                if (isSpace(p[1])) {
+                    for (int i = 0; i < 3 && ok; ++i)
+                        ok = (p = parseFloat(p + (i == 0 ? 1 : 0), lineEnd, values[i])) != nullptr;
+                    chunk.Positions.insert(chunk.Positions.end(), values, values + 3);
+                }
+                else if (p[1] == 't' && p + 2 < lineEnd && isSpace(p[2])) {
+                    ok = (p = parseFloat(p + 2, lineEnd, values[0])) != nullptr;
+                    // la v es opcional
+                    if (ok && skipSpaces(p, lineEnd) < lineEnd)
+                        ok = (p = parseFloat(p, lineEnd, values[1])) != nullptr;
+                    chunk.TexCoords.insert(chunk.TexCoords.end(), values, values + 2);
+                }
+                else if (p[1] == 'n' && p + 2 < lineEnd && isSpace(p[2])) {
+                    p += 2;
+                    for (int i = 0; i < 3 && ok; ++i)
+                        ok = (p = parseFloat(p, lineEnd, values[i])) != nullptr;
+                    chunk.Normals.insert(chunk.Normals.end(), values, values + 3);
+                }
+            }
+            else if (p + 1 < lineEnd && p[0] == 'f' && isSpace(p[1])) {
+                ok = parseFace(chunk, p + 1, lineEnd);
+            }
+            else if (keyword(p, lineEnd, "usemtl", 6)) {
+                chunk.Materials.push_back({ chunk.FaceEnds.size(), restOfLine(p + 6, lineEnd) });
+            }
+            else if (keyword(p, lineEnd, "mtllib", 6)) {
+                chunk.Libraries.push_back(restOfLine(p + 6, lineEnd));
+            }
+            if (!ok) {
+                chunk.Error = "malformed line: " + restOfLine(lineStart, lineEnd);
+                return;
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    // "f v v v...", "f v/vt ...", "f v//vn ...", "f v/vt/vn ..."
+    static bool parseFace(Chunk& chunk, const char* p, const char* end)
+    {
+        size_t first = chunk.Corners.size();
+        int positions = (int)(chunk.Positions.size() / 3), texCoords = (int)(chunk.TexCoords.size() / 2), normals = (int)(chunk.Normals.size() / 3);
+        for (;;) {
+            p = skipSpaces(p, end);
+            if (p >= end)
+                break;
+            Corner corner;
+            int* fields[3] = { &corner.V, &corner.T, &corner.N };
+            int counts[3] = { positions, texCoords, normals };
+            for (int f = 0; f < 3; ++f) {
+                if (f > 0) {
+                    if (p >= end || *p != '/')
+                        break;
+                    ++p;
+                    if (p < end && (*p == '/' || isSpace(*p)))
+                        continue;   // campo vacio
+                }
+                int value = 0;
+                p = parseInt(p, end, value);
+                if (!p || value == 0)
+                    return false;
+                if (value < 0) {
+                    // relativo a lo leido hasta aca: indice local al bloque, base 0 (puede ser negativo)
+                    *fields[f] = counts[f] + value;
+                    corner.Relative |= 1 << f;
+                }
+                else {
+                    *fields[f] = value;
+                }
+            }
+            chunk.Corners.push_back(corner);
+        }
+        if (chunk.Corners.size() - first < 3) {
+            chunk.Corners.resize(first);    // punto o linea suelta: no es un triangulo
+            return true;
+        }
+        chunk.FaceEnds.push_back((unsigned int)chunk.Corners.size());
+        return true;
+    }
+
+    bool merge(std::vector<Chunk>& chunks, Streams& streams)
+    {
+        size_t positions = 0, texCoords = 0, normals = 0;
+        for (Chunk& chunk : chunks) {
+            chunk.PositionBase = positions;
+            chunk.TexCoordBase = texCoords;
+            chunk.NormalBase = normals;
+            positions += chunk.Positions.size() / 3;
+            texCoords += chunk.TexCoords.size() / 2;
+            normals += chunk.Normals.size() / 3;
+            streams.Libraries.insert(streams.Libraries.end(), chunk.Libraries.begin(), chunk.Libraries.end());
+        }
+        streams.Positions.resize(positions * 3);
+        streams.TexCoords.resize(texCoords * 2);
+        streams.Normals.resize(normals * 3);
+
+        std::vector<char> valid(chunks.size(), 1);
+        ThreadPool::Get().ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                Chunk& chunk = chunks[c];
+                std::copy(chunk.Positions.begin(), chunk.Positions.end(), streams.Positions.begin() + chunk.PositionBase * 3);
+                std::copy(chunk.TexCoords.begin(), chunk.TexCoords.end(), streams.TexCoords.begin() + chunk.TexCoordBase * 2);
+                std::copy(chunk.Normals.begin(), chunk.Normals.end(), streams.Normals.begin() + chunk.NormalBase * 3);
+                std::vector<float>().swap(chunk.Positions);
+                std::vector<float>().swap(chunk.TexCoords);
+                std::vector<float>().swap(chunk.Normals);
+                for (Corner& corner : chunk.Corners) {
+                    valid[c] &= resolve(corner.V, corner.Relative & 1, chunk.PositionBase, positions);
+                    valid[c] &= resolve(corner.T, corner.Relative & 2, chunk.TexCoordBase, texCoords);
+                    valid[c] &= resolve(corner.N, corner.Relative & 4, chunk.NormalBase, normals);
+                    valid[c] &= corner.V >= 0;
+                }
+            }
+        });
+        for (char ok : valid)
+            if (!ok) {
+                Error = "face index out of range";
+                return false;
+            }
+        return true;
+    }
+
+    // a indice absoluto base 0; -1 si no habia
+    static char resolve(int& index, int relative, size_t base, size_t count)
+    {
+        if (!relative && index == MISSING) {
+            index = -1;
+            return 1;
+        }
+        long long absolute = relative ? (long long)base + index : (long long)index - 1;
+        if (absolute < 0 || absolute >= (long long)count)
+            return 0;
+        index = (int)absolute;
+        return 1;
+    }
+
+    // material activo en cada cara; sin usemtl las caras van al material ""
+    static void assignMaterials(const std::vector<Chunk>& chunks, std::vector<std::vector<unsigned int>>& faceMaterial, std::vector<std::string>& names)
+    {
+        std::map<std::string, unsigned int> ids;
+        auto id = [&](const std::string& name) {
+            auto found = ids.find(name);
+            if (found != ids.end())
+                return found->second;
+            names.push_back(name);
+            return ids[name] = (unsigned int)names.size() - 1;
+        };
+        unsigned int current = id("");
+        faceMaterial.resize(chunks.size());
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            const Chunk& chunk = chunks[c];
+            faceMaterial[c].resize(chunk.FaceEnds.size());
+            size_t use = 0;
+            for (size_t f = 0; f < chunk.FaceEnds.size(); ++f) {
+                while (use < chunk.Materials.size() && chunk.Materials[use].Face <= f)
+                    current = id(chunk.Materials[use++].Name);
+                faceMaterial[c][f] = current;
+            }
+            while (use < chunk.Materials.size())
+                current = id(chunk.Materials[use++].Name);
+        }
+    }
+
+    // triangulos en abanico (v0, vi, vi+1), agrupados por material respetando el orden del archivo
+    static void triangulate(const std::vector<Chunk>& chunks, const std::vector<std::vector<unsigned int>>& faceMaterial, std::vector<std::vector<Corner>>& triangles)
+    {
+        std::vector<size_t> sizes(triangles.size(), 0);
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            unsigned int begin = 0;
+            for (size_t f = 0; f < chunks[c].FaceEnds.size(); ++f) {
+                sizes[faceMaterial[c][f]] += (chunks[c].FaceEnds[f] - begin - 2) * 3;
+                begin = chunks[c].FaceEnds[f];
+            }
+        }
+        for (size_t m = 0; m < triangles.size(); ++m)
+            triangles[m].reserve(sizes[m]);
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            const Chunk& chunk = chunks[c];
+            unsigned int begin = 0;
+            for (size_t f = 0; f < chunk.FaceEnds.size(); ++f) {
+                std::vector<Corner>& out = triangles[faceMaterial[c][f]];
+                for (unsigned int i = begin + 1; i + 1 < chunk.FaceEnds[f]; ++i) {
+                    out.push_back(chunk.Corners[begin]);
+                    out.push_back(chunk.Corners[i]);
+                    out.push_back(chunk.Corners[i + 1]);
+                }
+                begin = chunk.FaceEnds[f];
+            }
+        }
+    }
+
+    // vertices sin repetir (tabla hash abierta sobre la terna v/vt/vn) e indices. Devuelve si hay uvs
+    static bool build(const Streams& streams, const std::vector<Corner>& corners, ObjMesh& mesh)
+    {
+        size_t capacity = 16;
+        while (capacity < corners.size() * 2)
+            capacity <<= 1;
+        std::vector<unsigned int> table(capacity, 0xFFFFFFFFu);
+        std::vector<Corner> keys;
+        keys.reserve(corners.size());
+        mesh.Vertices.reserve(corners.size() / 2);
+        mesh.Indices.resize(corners.size());
+
+        bool hasNormals = true, hasTexCoords = false;
+        for (size_t i = 0; i < corners.size(); ++i) {
+            const Corner& c = corners[i];
+            uint32_t hash = (uint32_t)c.V * 73856093u ^ (uint32_t)c.T * 19349663u ^ (uint32_t)c.N * 83492791u;
+            size_t slot = hash & (capacity - 1);
+            while (table[slot] != 0xFFFFFFFFu) {
+                const Corner& k = keys[table[slot]];
+                if (k.V == c.V && k.T == c.T && k.N == c.N)
+                    break;
+                slot = (slot + 1) & (capacity - 1);
+            }
+            if (table[slot] == 0xFFFFFFFFu) {
+                table[slot] = (unsigned int)keys.size();
+                keys.push_back(c);
+                Vertex vertex = Vertex();
+                vertex.Position = glm::vec3(streams.Positions[c.V * 3], streams.Positions[c.V * 3 + 1], streams.Positions[c.V * 3 + 2]);
+                if (c.T >= 0) {
+                    vertex.TexCoords = glm::vec2(streams.TexCoords[c.T * 2], streams.TexCoords[c.T * 2 + 1]);
+                    hasTexCoords = true;
+                }
+                if (c.N >= 0)
+                    vertex.Normal = glm::vec3(streams.Normals[c.N * 3], streams.Normals[c.N * 3 + 1], streams.Normals[c.N * 3 + 2]);
+                else
+                    hasNormals = false;
+                mesh.Vertices.push_back(vertex);
+            }
+            mesh.Indices[i] = table[slot];
+        }
+        if (!hasNormals)
+            computeNormals(mesh);
+        return hasTexCoords;
+    }
+
+    // normales suavizadas (ponderadas por area) para los vertices que no traen vn
+    static void computeNormals(ObjMesh& mesh)
+    {
+        std::vector<glm::vec3> sum(mesh.Vertices.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+            unsigned int a = mesh.Indices[i], b = mesh.Indices[i + 1], c = mesh.Indices[i + 2];
+            glm::vec3 n = glm::cross(mesh.Vertices[b].Position - mesh.Vertices[a].Position, mesh.Vertices[c].Position - mesh.Vertices[a].Position);
+            sum[a] += n;
+            sum[b] += n;
+            sum[c] += n;
+        }
+        for (size_t v = 0; v < mesh.Vertices.size(); ++v)
+            if (mesh.Vertices[v].Normal == glm::vec3(0.0f) && glm::dot(sum[v], sum[v]) > 0.0f)
+                mesh.Vertices[v].Normal = glm::normalize(sum[v]);
+    }
+
+    // 4 floats en paralelo: SSE si esta disponible, si no el mismo codigo en escalar
+#ifdef OBJ_LOADER_SSE
+    struct Lanes
+    {
+        __m128 v;
+        Lanes() : v(_mm_setzero_ps()) {}
+        Lanes(__m128 v) : v(v) {}
+        static Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+        void Store(float* p) const { _mm_storeu_ps(p, v); }
+        Lanes operator+(const Lanes& o) const { return _mm_add_ps(v, o.v); }
+        Lanes operator-(const Lanes& o) const { return _mm_sub_ps(v, o.v); }
+        Lanes operator*(const Lanes& o) const { return _mm_mul_ps(v, o.v); }
+        // 1 / x, o 0 donde |x| es casi 0 (uvs degenerados)
+        Lanes SafeReciprocal() const
+        {
+            __m128 absolute = _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+            __m128 usable = _mm_cmpgt_ps(absolute, _mm_set1_ps(1e-20f));
+            return _mm_and_ps(usable, _mm_div_ps(_mm_set1_ps(1.0f), v));
+        }
+    };
+#else
+    struct Lanes
+    {
+        float v[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        static Lanes Load(const float* p) { Lanes l; std::memcpy(l.v, p, sizeof(l.v)); return l; }
+        void Store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+        Lanes operator+(const Lanes& o) const { Lanes r; for (int i = 0; i < 4; ++i) r.v[i] = v[i] + o.v[i]; return r; }
+        Lanes operator-(const Lanes& o) const { Lanes r; for (int i = 0; i < 4; ++i) r.v[i] = v[i] - o.v[i]; return r; }
+        Lanes operator*(const Lanes& o) const { Lanes r; for (int i = 0; i < 4; ++i) r.v[i] = v[i] * o.v[i]; return r; }
+        Lanes SafeReciprocal() const { Lanes r; for (int i = 0; i < 4; ++i) r.v[i] = std::fabs(v[i]) > 1e-20f ? 1.0f / v[i] : 0.0f; return r; }
+    };
+#endif
+
+    // tangente y bitangente por triangulo (de a 4, en SoA), acumuladas por vertice y ortogonalizadas contra la normal
+    static void computeTangents(ObjMesh& mesh)
+    {
+        std::vector<Vertex>& vertices = mesh.Vertices;
+        const std::vector<unsigned int>& indices = mesh.Indices;
+        std::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f)), bitangents(vertices.size(), glm::vec3(0.0f));
+        size_t triangleCount = indices.size() / 3;
+
+        for (size_t first = 0; first < triangleCount; first += 4) {
+            // SoA: por componente, los 4 triangulos del grupo (los que sobran repiten el ultimo y no se acumulan)
+            alignas(16) float e1[3][4], e2[3][4], du1[4], dv1[4], du2[4], dv2[4];
+            size_t lanes = std::min<size_t>(4, triangleCount - first);
+            for (size_t l = 0; l < 4; ++l) {
+                size_t t = first + std::min(l, lanes - 1);
+                const Vertex& a = vertices[indices[t * 3]];
+                const Vertex& b = vertices[indices[t * 3 + 1]];
+                const Vertex& c = vertices[indices[t * 3 + 2]];
+                for (int k = 0; k < 3; ++k) {
+                    e1[k][l] = b.Position[k] - a.Position[k];
+                    e2[k][l] = c.Position[k] - a.Position[k];
+                }
+                du1[l] = b.TexCoords.x - a.TexCoords.x;
+                dv1[l] = b.TexCoords.y - a.TexCoords.y;
+                du2[l] = c.TexCoords.x - a.TexCoords.x;
+                dv2[l] = c.TexCoords.y - a.TexCoords.y;
+            }
+            Lanes U1 = Lanes::Load(du1), V1 = Lanes::Load(dv1), U2 = Lanes::Load(du2), V2 = Lanes::Load(dv2);
+            Lanes r = (U1 * V2 - U2 * V1).SafeReciprocal();
+            alignas(16) float tangent[3][4], bitangent[3][4];
+            for (int k = 0; k < 3; ++k) {
+                Lanes E1 = Lanes::Load(e1[k]), E2 = Lanes::Load(e2[k]);
+                ((E1 * V2 - E2 * V1) * r).Store(tangent[k]);
+                ((E2 * U1 - E1 * U2) * r).Store(bitangent[k]);
+            }
+            for (size_t l = 0; l < lanes; ++l) {
+                glm::vec3 t(tangent[0][l], tangent[1][l], tangent[2][l]), b(bitangent[0][l], bitangent[1][l], bitangent[2][l]);
+                for (int corner = 0; corner < 3; ++corner) {
+                    unsigned int v = indices[(first + l) * 3 + corner];
+                    tangents[v] += t;
+                    bitangents[v] += b;
+                }
+            }
+        }
+
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            glm::vec3 n = vertices[v].Normal;
+            glm::vec3 t = tangents[v] - n * glm::dot(n, tangents[v]);
+            if (glm::dot(t, t) < 1e-12f) {
+                // sin uvs utiles: cualquier perpendicular a la normal
+                t = glm::cross(std::fabs(n.x) > 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f), n);
+                if (glm::dot(t, t) < 1e-12f)
+                    t = glm::vec3(1.0f, 0.0f, 0.0f);
+            }
+            t = glm::normalize(t);
+            glm::vec3 b = bitangents[v] - n * glm::dot(n, bitangents[v]) - t * glm::dot(t, bitangents[v]);
+            b = glm::dot(b, b) < 1e-12f ? glm::cross(n, t) : glm::normalize(b);
+            vertices[v].Tangent = t;
+            vertices[v].Bitangent = b;
+        }
+    }
+
+    // newmtl -> map_Kd de las bibliotecas mtllib (relativas al .obj)
+    static std::map<std::string, std::string> loadMaterials(const std::string& objPath, const std::vector<std::string>& libraries)
+    {
+        std::map<std::string, std::string> diffuseMaps;
+        size_t slash = objPath.find_last_of("/\\");
+        std::string directory = slash == std::string::npos ? "" : objPath.substr(0, slash + 1);
+        for (const std::string& library : libraries) {
+            std::ifstream in(directory + library);
+            std::string line, current;
+            while (std::getline(in, line)) {
+                const char* p = line.data();
+                const char* end = p + line.size();
+                p = skipSpaces(p, end);
+                if (keyword(p, end, "newmtl", 6)) {
+                    current = restOfLine(p + 6, end);
+                }
+                else if (keyword(p, end, "map_Kd", 6)) {
+                    // las opciones (-s, -o, ...) van antes del nombre: se toma la ultima palabra
+                    std::string value = restOfLine(p + 6, end);
+                    size_t space = value.find_last_of(" \t");
+                    diffuseMaps[current] = space == std::string::npos ? value : value.substr(space + 1);
+                }
+            }
+        }
+        return diffuseMaps;
+    }
+};
+#endif
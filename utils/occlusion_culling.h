@@ -0,0 +1,305 @@
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "utils/gl_state.h"
+#include "utils/memory_stats.h"
+#include "utils/scene.h"
+#include "utils/shader.h"
+
+#include <algorithm>
+#include <vector>
+
+// Occlusion culling en dos fases contra un Hi-Z, todo en la GPU (la CPU nunca lee que es visible):
+//   1. Early: un pase de transform feedback con un punto por instancia visible por el frustum copia la
+//      InstanceData de las que se vieron el frame anterior (mapa de visibilidad) y anula la del resto;
+//      la escena se dibuja con ese buffer
+//   2. Late: arma el Hi-Z (piramide con la profundidad mas lejana de cada bloque) del gDepth de la fase 1
+//      y prueba contra el la esfera de cada instancia. Las visibles marcan su texel en el mapa del proximo
+//      frame y, si no se dibujaron en la fase 1, pasan al buffer de la fase tardia, que se dibuja despues.
+//      Asi lo que aparece de atras de un oclusor se dibuja en el mismo frame, sin popping
+// GL 3.3 no tiene compute ni glMultiDrawElementsIndirect: en vez de compactar comandos indirectos, cada fase
+// escribe un VBO de InstanceData con los mismos slots que el de la escena (los draws instanciados no
+// cambian) y las instancias descartadas llevan la matriz nula, que gbuffer.vert manda fuera del clip volume.
+// Se ahorra el raster y la escritura del g-buffer; los vertices de las descartadas se siguen procesando.
+class OcclusionCulling
+{
+public:
+    static const int RING = 4;
+    static const int MAP_WIDTH = 256;   // ancho del mapa de visibilidad (un texel por instancia)
+
+    bool Enabled = false;
+
+    // instancias probadas / visibles segun el Hi-Z, de hace 1-3 frames (queries GL_SAMPLES_PASSED: cada
+    // visible escribe un texel del mapa). Solo para la interfaz: no se usan para decidir nada
+    unsigned int Tested = 0, Visible = 0;
+
+    OcclusionCulling() {}
+    OcclusionCulling(const OcclusionCulling&) = delete;
+    OcclusionCulling& operator=(const OcclusionCulling&) = delete;
+
+    // fase 1: va despues de Scene::Upload(list) y antes de dibujar con EarlyBuffer()
+    void Early(const Scene& scene, const Scene::DrawList& list)
+    {
+        init();
+        slots = list.PackedSource.size();
+        resizeMap(list.InstanceCount);
+
+        // esfera e indice de instancia de cada slot del VBO de la escena
+        inputs.resize(slots);
+        for (size_t s = 0; s < slots; ++s) {
+            inputs[s].Sphere = list.Spheres[s];
+            inputs[s].Instance = (int)list.PackedSource[s];
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, inputVBO);
+        glBufferData(GL_ARRAY_BUFFER, inputs.size() * sizeof(CullInput), NULL, GL_STREAM_DRAW);
+        if (!inputs.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, 0, inputs.size() * sizeof(CullInput), inputs.data());
+        for (unsigned int buffer : { earlyVBO, lateVBO }) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, slots * sizeof(InstanceData), NULL, GL_STREAM_COPY);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (slots == 0)
+            return;
+
+        bindInputs(scene.InstanceBuffer());
+        cull.use();
+        cull.setInt("phase", 0);
+        GLState::Get().BindTexture(0, GL_TEXTURE_2D, visibility[current ^ 1]);
+        GLState::Get().Enable(GL_RASTERIZER_DISCARD, true);
+        capture(earlyVBO);
+        GLState::Get().Enable(GL_RASTERIZER_DISCARD, false);
+    }
+
+    // fase 2: Hi-Z del gDepth (del tamanio de la ventana, con la resolucion interna en la esquina inferior
+    // izquierda) y prueba. Cambia el framebuffer y el viewport: hay que volver a enlazar los del g-buffer
+    void Late(const Scene& scene, unsigned int depthTexture, glm::ivec2 windowSize, glm::ivec2 renderSize,
+        const glm::mat4& view, const glm::mat4& projection, float nearPlane)
+    {
+        if (slots == 0)
+            return;
+        GLState& gl = GLState::Get();
+        buildHiZ(depthTexture, windowSize);
+
+        gl.BindFramebuffer(GL_FRAMEBUFFER, mapFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, visibility[current], 0);
+        gl.Viewport(0, 0, MAP_WIDTH, mapHeight);
+        gl.Enable(GL_DEPTH_TEST, false);
+        gl.Enable(GL_BLEND, false);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        bindInputs(scene.InstanceBuffer());
+        cull.use();
+        cull.setInt("phase", 1);
+        cull.setInt("hiZLevels", hiZLevels);
+        cull.setVec2("renderSize", glm::vec2(renderSize));
+        cull.setFloat("nearPlane", nearPlane);
+        cull.setMat4("view", view);
+        cull.setMat4("projection", projection);
+        gl.BindTexture(0, GL_TEXTURE_2D, visibility[current ^ 1]);
+        gl.BindTexture(1, GL_TEXTURE_2D, hiZ);
+
+        poll();
+        bool measure = !pending[head];
+        if (measure)
+            glBeginQuery(GL_SAMPLES_PASSED, queries[head]);
+        capture(lateVBO);
+        if (measure) {
+            glEndQuery(GL_SAMPLES_PASSED);
+            tested[head] = (unsigned int)slots;
+            pending[head] = true;
+            head = (head + 1) % RING;
+        }
+        current ^= 1;
+    }
+
+    // InstanceData de cada fase, con los mismos slots que Scene::InstanceBuffer (para Scene::Draw)
+    unsigned int EarlyBuffer() const
+    {
+        return earlyVBO;
+    }
+
+    unsigned int LateBuffer() const
+    {
+        return lateVBO;
+    }
+
+    MemoryUsage Memory() const
+    {
+        size_t gpu = slots * (2 * sizeof(InstanceData) + sizeof(CullInput)) + 2 * (size_t)MAP_WIDTH * mapHeight;
+        for (int l = 0, w = hiZSize.x, h = hiZSize.y; l < hiZLevels; ++l, w = std::max(1, w / 2), h = std::max(1, h / 2))
+            gpu += (size_t)w * h * sizeof(float);
+        return MemoryUsage(inputs.capacity() * sizeof(CullInput), gpu);
+    }
+
+private:
+    // lo que el pase de culling lee por slot, ademas de la InstanceData
+    struct CullInput
+    {
+        glm::vec4 Sphere;
+        int Instance;
+    };
+
+    Shader cull, downsample;
+    unsigned int cullVAO = 0, emptyVAO = 0;
+    unsigned int inputVBO = 0, earlyVBO = 0, lateVBO = 0;
+    std::vector<CullInput> inputs;
+    size_t slots = 0;
+
+    // mapa de visibilidad por indice de instancia: se lee el del frame anterior y se escribe el otro
+    unsigned int visibility[2] = { 0, 0 };
+    unsigned int mapFBO = 0;
+    int mapHeight = 0, current = 0;
+
+    // Hi-Z: nivel 0 a la mitad del gDepth, hasta 1x1
+    unsigned int hiZ = 0, hiZFBO = 0;
+    glm::ivec2 hiZSize = glm::ivec2(0);
+    int hiZLevels = 0;
+
+    unsigned int queries[RING] = { 0 };
+    unsigned int tested[RING] = { 0 };
+    bool pending[RING] = { false };
+    int head = 0;
+
+    void init()
+    {
+        if (cullVAO != 0)
+            return;
+        cull = Shader::TransformFeedback("occlusion_cull.vert", "occlusion_cull.frag", { "InstanceModel0", "InstanceModel1",
+            "InstanceModel2", "InstanceModel3", "InstanceNormal0", "InstanceNormal1", "InstanceNormal2" });
+        cull.use();
+        cull.setInt("lastVisible", 0);
+        cull.setInt("hiZ", 1);
+        downsample = Shader("hiz_downsample.vert", "hiz_downsample.frag");
+        downsample.use();
+        downsample.setInt("source", 0);
+
+        glGenVertexArrays(1, &cullVAO);
+        glGenVertexArrays(1, &emptyVAO);
+        glGenBuffers(1, &inputVBO);
+        glGenBuffers(1, &earlyVBO);
+        glGenBuffers(1, &lateVBO);
+        glGenFramebuffers(1, &mapFBO);
+        glGenFramebuffers(1, &hiZFBO);
+        glGenQueries(RING, queries);
+    }
+
+    // un texel R8 por instancia; los mapas nuevos arrancan en 0 (la primera vez todo va a la fase tardia)
+    void resizeMap(size_t instances)
+    {
+        int height = std::max(1, (int)((instances + MAP_WIDTH - 1) / MAP_WIDTH));
+        if (height == mapHeight)
+            return;
+        mapHeight = height;
+        std::vector<unsigned char> zero((size_t)MAP_WIDTH * mapHeight, 0);
+        for (unsigned int& map : visibility) {
+            if (map == 0)
+                glGenTextures(1, &map);
+            GLState::Get().BindTexture(GL_TEXTURE_2D, map);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, MAP_WIDTH, mapHeight, 0, GL_RED, GL_UNSIGNED_BYTE, zero.data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+    }
+
+    // InstanceData de la escena en las locations 0-6 y CullInput en 7-8, un punto por slot (sin divisor)
+    void bindInputs(unsigned int instanceVBO)
+    {
+        GLState::Get().BindVertexArray(cullVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (int i = 0; i < 4; ++i) {
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, Model) + i * sizeof(glm::vec4)));
+        }
+        for (int i = 0; i < 3; ++i) {
+            glEnableVertexAttribArray(4 + i);
+            glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, NormalMatrix) + i * sizeof(glm::vec4)));
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, inputVBO);
+        glEnableVertexAttribArray(7);
+        glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(CullInput), (void*)offsetof(CullInput, Sphere));
+        glEnableVertexAttribArray(8);
+        glVertexAttribIPointer(8, 1, GL_INT, sizeof(CullInput), (void*)offsetof(CullInput, Instance));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // dibuja los puntos capturando la InstanceData resultante en 'output'
+    void capture(unsigned int output)
+    {
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, output);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)slots);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    }
+
+    void buildHiZ(unsigned int depthTexture, glm::ivec2 windowSize)
+    {
+        GLState& gl = GLState::Get();
+        glm::ivec2 size(std::max(1, windowSize.x / 2), std::max(1, windowSize.y / 2));
+        if (size != hiZSize) {
+            hiZSize = size;
+            hiZLevels = 1;
+            while ((std::max(size.x, size.y) >> hiZLevels) > 0)
+                ++hiZLevels;
+            if (hiZ != 0)
+                gl.DeleteTextures(1, &hiZ);
+            glGenTextures(1, &hiZ);
+            gl.BindTexture(GL_TEXTURE_2D, hiZ);
+            for (int l = 0, w = size.x, h = size.y; l < hiZLevels; ++l, w = std::max(1, w / 2), h = std::max(1, h / 2))
+                glTexImage2D(GL_TEXTURE_2D, l, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, hiZLevels - 1);
+        }
+
+        // cada nivel lee el anterior: mientras tanto la textura se limita a ese nivel, asi el que se escribe
+        // no queda al alcance del sampler (no hay feedback loop)
+        gl.BindFramebuffer(GL_FRAMEBUFFER, hiZFBO);
+        gl.Enable(GL_DEPTH_TEST, false);
+        gl.Enable(GL_BLEND, false);
+        gl.BindVertexArray(emptyVAO);
+        downsample.use();
+        for (int l = 0, w = size.x, h = size.y; l < hiZLevels; ++l, w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hiZ, l);
+            gl.Viewport(0, 0, w, h);
+            if (l == 0) {
+                gl.BindTexture(0, GL_TEXTURE_2D, depthTexture);
+                downsample.setInt("sourceLevel", 0);
+            }
+            else {
+                gl.BindTexture(0, GL_TEXTURE_2D, hiZ);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, l - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, l - 1);
+                downsample.setInt("sourceLevel", l - 1);
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        gl.BindTexture(0, GL_TEXTURE_2D, hiZ);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, hiZLevels - 1);
+    }
+
+    // resultados en orden, empezando por el mas viejo (como GpuTimer)
+    void poll()
+    {
+        for (int i = 1; i <= RING; ++i) {
+            int slot = (head + i) % RING;
+            if (!pending[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint samples = 0;
+            glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT, &samples);
+            Visible = samples;
+            Tested = tested[slot];
+            pending[slot] = false;
+        }
+    }
+};
+#endif
@@ -0,0 +1,154 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include "utils/atomic_file.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Cache en disco de programas linkeados (glGetProgramBinary / glProgramBinary).
+// La clave es un hash del codigo ya preprocesado (con los #define de la permutacion) mas el string
+// del driver (vendor, renderer, version): si cambia el shader o el driver, la entrada simplemente no
+// se encuentra y se vuelve a compilar. Si el contexto no soporta program binaries no hace nada.
+class ProgramCache
+{
+public:
+    static std::string Directory()
+    {
+        return "shader_cache";
+    }
+
+    // true si el driver expone al menos un formato de program binary
+    static bool Supported()
+    {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+        static int formats = -1;
+        if (formats < 0) {
+            formats = 0;
+            if (glGetProgramBinary != nullptr && glProgramBinary != nullptr)
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        return formats > 0;
+#else
+        return false;
+#endif
+    }
+
+    // clave de cache para un programa con estas fuentes
+    static std::string Key(const std::string& source)
+    {
+        uint64_t h = hash(driverString(), hash(source));
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+        return hex;
+    }
+
+    // intenta crear el programa desde la cache; devuelve 0 si no esta o el driver lo rechaza
+    static unsigned int Load(const std::string& key)
+    {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+        if (!Supported())
+            return 0;
+        std::ifstream file(path(key), std::ios::binary);
+        if (!file)
+            return 0;
+        uint32_t header[3];     // magic, formato, bytes
+        if (!file.read((char*)header, sizeof(header)) || header[0] != MAGIC)
+            return 0;
+        std::vector<char> binary(header[2]);
+        if (!file.read(binary.data(), binary.size()))
+            return 0;
+
+        unsigned int program = glCreateProgram();
+        glProgramBinary(program, header[1], binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // binario de otra version del driver con el mismo string, o corrupto
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+#else
+        (void)key;
+        return 0;
+#endif
+    }
+
+    // pedir al driver que conserve el binario (antes de glLinkProgram)
+    static void PrepareLink(unsigned int program)
+    {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+        if (Supported())
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#else
+        (void)program;
+#endif
+    }
+
+    // guarda un programa ya linkeado
+    static void Store(const std::string& key, unsigned int program)
+    {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+        if (!Supported())
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+
+        std::error_code ec;
+        std::filesystem::create_directories(Directory(), ec);
+        // sin entradas a medias aunque varios procesos compilen la misma permutacion
+        WriteFileAtomic(path(key), [&](std::ofstream& file) {
+            uint32_t header[3] = { MAGIC, (uint32_t)format, (uint32_t)length };
+            file.write((const char*)header, sizeof(header));
+            file.write(binary.data(), length);
+            return (bool)file;
+        });
+#else
+        (void)key; (void)program;
+#endif
+    }
+
+private:
+    static const uint32_t MAGIC = 0x31425053;  // "SPB1"
+
+    static std::string path(const std::string& key)
+    {
+        return Directory() + "/" + key + ".bin";
+    }
+
+    static const std::string& driverString()
+    {
+        static std::string driver;
+        if (driver.empty()) {
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+                const GLubyte* s = glGetString(name);
+                driver += s ? (const char*)s : "?";
+                driver += '|';
+            }
+        }
+        return driver;
+    }
+
+    // FNV-1a de 64 bits
+    static uint64_t hash(const std::string& s, uint64_t h = 14695981039346656037ull)
+    {
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+};
+#endif
@@ -0,0 +1,277 @@
+#ifndef RENDER_SERVICE_H
+#define RENDER_SERVICE_H
+
+#include <glm/glm.hpp>
+
+#include "utils/atomic_file.h"
+#include "utils/model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Modo servicio (--serve <dir>): renders de AO por pedido, sin interfaz. Los trabajos son archivos de texto
+// <dir>/<nombre>.job; el servicio los toma renombrandolos a .running (el rename es atomico, asi varios
+// servicios pueden compartir el mismo directorio), y deja en <dir>/done/ la imagen y un <nombre>.txt con el
+// estado y los tiempos. El .txt se escribe al final: cuando aparece, la imagen ya esta completa.
+//
+// Formato de un .job, una clave por linea ('#' comenta):
+//   model suzanne             nombre de un modelo del programa o ruta a un archivo
+//   scale 1                   escala del modelo (los del programa usan la suya)
+//   size 512 512
+//   output lit                lit (iluminado con AO) | ao (solo la oclusion, 1 canal)
+//   eye 0 0.5 3               camara explicita (con target); sin eye se encuadra el modelo con yaw/pitch
+//   target 0 0 0
+//   yaw 30                    grados alrededor del modelo
+//   pitch 15
+//   fov 45
+//   radius 0.5 / bias 0.01 / intensity 1 / samples 16 / blur 1
+struct RenderJob
+{
+    std::string Name;           // nombre del archivo sin .job
+    std::string Model = "suzanne";
+    float Scale = 1.0f;
+    int Width = 512, Height = 512;
+    bool AOOnly = false;
+    bool ExplicitCamera = false;
+    glm::vec3 Eye = glm::vec3(0.0f, 0.0f, 3.0f), Target = glm::vec3(0.0f);
+    float Yaw = 0.0f, Pitch = 15.0f, Fov = 45.0f;
+    float Radius = 0.5f, Bias = 0.01f, Intensity = 1.0f;
+    int Samples = 16;
+    bool Blur = true;
+
+    std::chrono::steady_clock::time_point Claimed;
+
+    // lee 'text'; devuelve false (con el motivo en 'error') ante una clave desconocida o un valor invalido
+    bool Parse(const std::string& text, std::string& error)
+    {
+        std::istringstream lines(text);
+        std::string line;
+        int number = 0;
+        while (std::getline(lines, line)) {
+            ++number;
+            line = line.substr(0, line.find('#'));
+            std::istringstream in(line);
+            std::string key;
+            if (!(in >> key))
+                continue;
+            bool ok = true;
+            if (key == "model")
+                ok = static_cast<bool>(in >> Model);
+            else if (key == "scale")
+                ok = static_cast<bool>(in >> Scale) && Scale > 0.0f;
+            else if (key == "size")
+                ok = static_cast<bool>(in >> Width >> Height) && Width > 0 && Height > 0 && Width <= 8192 && Height <= 8192;
+            else if (key == "output") {
+                std::string output;
+                ok = static_cast<bool>(in >> output) && (output == "lit" || output == "ao");
+                AOOnly = output == "ao";
+            }
+            else if (key == "eye") {
+                ok = static_cast<bool>(in >> Eye.x >> Eye.y >> Eye.z);
+                ExplicitCamera = true;
+            }
+            else if (key == "target")
+                ok = static_cast<bool>(in >> Target.x >> Target.y >> Target.z);
+            else if (key == "yaw")
+                ok = static_cast<bool>(in >> Yaw);
+            else if (key == "pitch")
+                ok = static_cast<bool>(in >> Pitch);
+            else if (key == "fov")
+                ok = static_cast<bool>(in >> Fov) && Fov > 1.0f && Fov < 179.0f;
+            else if (key == "radius")
+                ok = static_cast<bool>(in >> Radius);
+            else if (key == "bias")
+                ok = static_cast<bool>(in >> Bias);
+            else if (key == "intensity")
+                ok = static_cast<bool>(in >> Intensity);
+            else if (key == "samples")
+                ok = static_cast<bool>(in >> Samples) && Samples > 0 && Samples <= 64;
+            else if (key == "blur")
+                ok = static_cast<bool>(in >> Blur);
+            else {
+                error = "line " + std::to_string(number) + ": unknown key '" + key + "'";
+                return false;
+            }
+            if (!ok) {
+                error = "line " + std::to_string(number) + ": invalid value for '" + key + "'";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // trabajos con la misma clave van en un mismo lote (una capa por trabajo): solo cambia la camara
+    std::string BatchKey() const
+    {
+        std::ostringstream key;
+        key << Model << ' ' << Scale << ' ' << Width << 'x' << Height << ' ' << AOOnly << ' ' << Radius << ' ' << Bias << ' '
+            << Intensity << ' ' << Samples << ' ' << Blur;
+        return key.str();
+    }
+};
+
+// Directorio de trabajos del modo servicio (ver RenderJob)
+class RenderSpool
+{
+public:
+    explicit RenderSpool(const std::string& directory) : directory(directory)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(directory) / "done", ec);
+    }
+
+    // toma hasta 'max' trabajos pendientes, en orden de nombre. Los que no se pueden leer se contestan
+    // con error y no se devuelven. Con varios servicios en el mismo directorio conviene pedir de a un lote:
+    // lo que queda lo toma el primero que se libera
+    std::vector<RenderJob> Claim(size_t max)
+    {
+        std::vector<std::filesystem::path> pending;
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+            if (it->path().extension() == ".job")
+                pending.push_back(it->path());
+        std::sort(pending.begin(), pending.end());
+
+        std::vector<RenderJob> jobs;
+        for (const std::filesystem::path& path : pending) {
+            if (jobs.size() >= max)
+                break;
+            std::filesystem::path running = path;
+            running.replace_extension(".running");
+            std::filesystem::rename(path, running, ec);
+            if (ec)
+                continue;   // lo tomo otro servicio
+            RenderJob job;
+            job.Name = path.stem().string();
+            job.Claimed = std::chrono::steady_clock::now();
+            std::ifstream file(running);
+            std::stringstream text;
+            text << file.rdbuf();
+            std::string error;
+            if (!file || !job.Parse(text.str(), error)) {
+                Fail(job, error.empty() ? "could not read the job" : error);
+                continue;
+            }
+            jobs.push_back(job);
+        }
+        return jobs;
+    }
+
+    // ruta de la imagen sin extension (la agrega FrameCapture)
+    std::string OutputPath(const RenderJob& job) const
+    {
+        return (std::filesystem::path(directory) / "done" / job.Name).string();
+    }
+
+    // escribe el .txt del resultado ("status ok" + 'metadata') y borra el .running
+    void Complete(const RenderJob& job, const std::string& metadata)
+    {
+        finish(job, "status ok\n" + metadata);
+    }
+
+    void Fail(const RenderJob& job, const std::string& error)
+    {
+        finish(job, "status error\nerror " + error + "\n");
+    }
+
+    // <dir>/stop pide terminar (despues del lote en curso)
+    bool StopRequested() const
+    {
+        std::error_code ec;
+        return std::filesystem::exists(std::filesystem::path(directory) / "stop", ec);
+    }
+
+private:
+    std::string directory;
+
+    void finish(const RenderJob& job, const std::string& text)
+    {
+        // quien espera el .txt nunca lo ve a medias
+        std::filesystem::path done = std::filesystem::path(directory) / "done";
+        WriteFileAtomic((done / (job.Name + ".txt")).string(), [&](std::ofstream& file) {
+            file << text;
+            return (bool)file;
+        });
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::path(directory) / (job.Name + ".running"), ec);
+    }
+};
+
+// Modelos cargados por ruta, los Capacity usados mas recientemente; al pasarse se libera el menos usado
+// (sus buffers y texturas de GL incluidos, ver Model::ReleaseGpuData). Necesita el contexto de GL.
+class ModelCache
+{
+public:
+    size_t Capacity = 4;
+    unsigned long long Hits = 0, Misses = 0;
+    double LastLoadSeconds = 0.0;   // lo que tardo la ultima carga (0 si fue un hit)
+
+    ModelCache() {}
+    ModelCache(const ModelCache&) = delete;
+    ModelCache& operator=(const ModelCache&) = delete;
+
+    ~ModelCache()
+    {
+        Clear();
+    }
+
+    // nullptr si el archivo no existe o no tiene mallas
+    Model* Get(const std::string& path, ModelImporter importer = ModelImporter::Auto, bool keepCpuData = false)
+    {
+        ++clock;
+        LastLoadSeconds = 0.0;
+        for (Entry& entry : entries)
+            if (entry.Path == path) {
+                ++Hits;
+                entry.Used = clock;
+                return entry.Loaded.get();
+            }
+        ++Misses;
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec))
+            return nullptr;
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Model> model(new Model(path, false, keepCpuData, importer));
+        LastLoadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (model->meshes.empty()) {
+            model->ReleaseGpuData();
+            return nullptr;
+        }
+        if (entries.size() >= std::max<size_t>(Capacity, 1)) {
+            auto oldest = std::min_element(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.Used < b.Used; });
+            oldest->Loaded->ReleaseGpuData();
+            entries.erase(oldest);
+        }
+        entries.push_back({ path, std::move(model), clock });
+        return entries.back().Loaded.get();
+    }
+
+    size_t Size() const
+    {
+        return entries.size();
+    }
+
+    void Clear()
+    {
+        for (Entry& entry : entries)
+            entry.Loaded->ReleaseGpuData();
+        entries.clear();
+    }
+
+private:
+    struct Entry
+    {
+        std::string Path;
+        std::unique_ptr<Model> Loaded;
+        unsigned long long Used;
+    };
+    std::vector<Entry> entries;
+    unsigned long long clock = 0;
+};
+#endif
@@ -0,0 +1,266 @@
+#ifndef RENDER_SHARDS_H
+#define RENDER_SHARDS_H
+
+#include "utils/atomic_file.h"
+#include "utils/render_service.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+// Secuencias offline repartidas entre procesos (--shard <workers> <frames> <dir>). El coordinador escribe un
+// trabajo por frame en <dir> (una vuelta de camara alrededor del modelo, y opcionalmente un parametro de SSAO
+// que varia de un extremo al otro), lanza N procesos "--serve <dir>" (cada uno con su contexto de GL) y
+// espera los resultados. Cada worker toma de a un lote de frames consecutivos (ver RenderSpool::Claim), asi
+// que los shards se reparten solos entre los que terminan antes. Al final junta, en orden de frame, las
+// imagenes y los tiempos en <dir>/sequence.txt.
+class RenderShards
+{
+public:
+    int Workers = 4;
+    int Frames = 120;
+    std::string Directory;
+    RenderJob Base;                 // modelo, tamanio y SSAO de todos los frames; la camara la pone cada frame
+    std::string SweepParam;         // "" | radius | bias | intensity | samples
+    float SweepFrom = 0.0f, SweepTo = 0.0f;
+
+    // argumentos extra para los workers (p.ej. --mesh-cache, --importer)
+    std::vector<std::string> WorkerArgs;
+
+    // estadisticas de la corrida
+    double WallSeconds = 0.0;
+    int Completed = 0, Failed = 0;
+
+    // corre la secuencia entera; 'executable' es este programa (argv[0])
+    bool Run(const std::string& executable, std::ostream& log)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(Directory) / "done", ec);
+        std::filesystem::remove(stopPath(), ec);
+        // lo que quedo de una corrida anterior (p.ej. con mas frames) lo tomarian los workers de esta
+        std::vector<std::filesystem::path> stale;
+        for (std::filesystem::directory_iterator it(Directory, ec), end; !ec && it != end; it.increment(ec))
+            if (it->path().extension() == ".job" || it->path().extension() == ".running")
+                stale.push_back(it->path());
+        for (const std::filesystem::path& path : stale)
+            std::filesystem::remove(path, ec);
+        for (int f = 0; f < Frames; ++f) {
+            std::filesystem::remove(resultPath(f), ec);
+            if (!writeJob(f)) {
+                log << "Could not write job " << frameName(f) << std::endl;
+                return false;
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        std::atomic<int> running{ Workers };
+        for (int w = 0; w < Workers; ++w)
+            workers.emplace_back([this, executable, w, &running]() {
+                std::vector<std::string> args = { executable, "--serve", Directory };
+                args.insert(args.end(), WorkerArgs.begin(), WorkerArgs.end());
+                runWorker(args, (std::filesystem::path(Directory) / ("worker_" + std::to_string(w) + ".log")).string());
+                --running;
+            });
+
+        // los workers no saben cuantos frames hay: cuando estan todos, se les pide que terminen
+        int reported = 0;
+        while (true) {
+            int done = 0;
+            for (int f = 0; f < Frames; ++f)
+                done += std::filesystem::exists(resultPath(f), ec) ? 1 : 0;
+            if (done >= reported + std::max(Frames / 10, 1) || done == Frames) {
+                log << "  " << done << "/" << Frames << " frames" << std::endl;
+                reported = done;
+            }
+            if (done == Frames)
+                break;
+            if (running == 0) {
+                log << "All workers exited with " << Frames - done << " frames left (see worker_*.log)" << std::endl;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        std::ofstream(stopPath()).put('\n');
+        for (std::thread& worker : workers)
+            worker.join();
+        std::filesystem::remove(stopPath(), ec);
+        WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return stitch(log);
+    }
+
+private:
+    std::string frameName(int frame) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06d", frame);
+        return name;
+    }
+
+    std::filesystem::path resultPath(int frame) const
+    {
+        return std::filesystem::path(Directory) / "done" / (frameName(frame) + ".txt");
+    }
+
+    std::filesystem::path stopPath() const
+    {
+        return std::filesystem::path(Directory) / "stop";
+    }
+
+    // corre args[0] con esos argumentos y la salida (stdout y stderr) en 'log', y espera a que termine. Sin shell
+    // de por medio: cada argumento llega tal cual, con espacios, comillas o $ incluidos
+    static bool runWorker(const std::vector<std::string>& args, const std::string& log)
+    {
+#ifdef _WIN32
+        // CreateProcess recibe una sola linea: cada argumento va entre comillas con las reglas de CommandLineToArgvW
+        std::string command;
+        for (const std::string& arg : args) {
+            command += command.empty() ? "\"" : " \"";
+            size_t backslashes = 0;
+            for (char c : arg) {
+                if (c == '\\') {
+                    ++backslashes;
+                    continue;
+                }
+                command.append(c == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+                backslashes = 0;
+                command += c;
+            }
+            command.append(2 * backslashes, '\\');
+            command += '"';
+        }
+        SECURITY_ATTRIBUTES security = { sizeof(security), nullptr, TRUE };
+        HANDLE output = CreateFileA(log.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &security, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        STARTUPINFOA startup = {};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        startup.hStdOutput = startup.hStdError = output;
+        PROCESS_INFORMATION process = {};
+        BOOL created = CreateProcessA(nullptr, &command[0], nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &process);
+        if (output != INVALID_HANDLE_VALUE)
+            CloseHandle(output);
+        if (!created)
+            return false;
+        WaitForSingleObject(process.hProcess, INFINITE);
+        DWORD code = 1;
+        GetExitCodeProcess(process.hProcess, &code);
+        CloseHandle(process.hThread);
+        CloseHandle(process.hProcess);
+        return code == 0;
+#else
+        std::vector<char*> argv;
+        for (const std::string& arg : args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, 1, log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        posix_spawn_file_actions_adddup2(&actions, 1, 2);
+        pid_t pid;
+        int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (error != 0)
+            return false;
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0)
+            if (errno != EINTR)
+                return false;
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+    }
+
+    // el trabajo del frame f: la camara da una vuelta entera en Frames frames
+    bool writeJob(int frame) const
+    {
+        float t = Frames > 1 ? (float)frame / (Frames - 1) : 0.0f;
+        float sweep = SweepFrom + (SweepTo - SweepFrom) * t;
+        std::ostringstream job;
+        job << "model " << Base.Model << "\n"
+            << "scale " << Base.Scale << "\n"
+            << "size " << Base.Width << " " << Base.Height << "\n"
+            << "output " << (Base.AOOnly ? "ao" : "lit") << "\n"
+            << "yaw " << 360.0f * frame / Frames << "\n"
+            << "pitch " << Base.Pitch << "\n"
+            << "fov " << Base.Fov << "\n"
+            << "radius " << (SweepParam == "radius" ? sweep : Base.Radius) << "\n"
+            << "bias " << (SweepParam == "bias" ? sweep : Base.Bias) << "\n"
+            << "intensity " << (SweepParam == "intensity" ? sweep : Base.Intensity) << "\n"
+            << "samples " << (SweepParam == "samples" ? (int)(sweep + 0.5f) : Base.Samples) << "\n"
+            << "blur " << (Base.Blur ? 1 : 0) << "\n";
+        // un worker nunca toma un .job a medias (el temporal no termina en .job)
+        std::string text = job.str();
+        return WriteFileAtomic((std::filesystem::path(Directory) / (frameName(frame) + ".job")).string(), [&](std::ofstream& out) {
+            out << text;
+            return (bool)out;
+        });
+    }
+
+    // una linea por frame, en orden, con los tiempos que informo cada worker; despues los totales
+    bool stitch(std::ostream& log)
+    {
+        std::ofstream out(std::filesystem::path(Directory) / "sequence.txt", std::ios::trunc);
+        out << "# frame status image batch render_ms batch_render_ms wait_ms write_ms\n";
+        Completed = Failed = 0;
+        double renderMs = 0.0;
+        for (int f = 0; f < Frames; ++f) {
+            std::ifstream in(resultPath(f));
+            std::string line, status = "missing", image = "-", error;
+            double values[5] = { 0, 0, 0, 0, 0 };     // batch, render_ms, batch_render_ms, wait_ms, write_ms
+            const char* keys[5] = { "batch", "render_ms", "batch_render_ms", "wait_ms", "write_ms" };
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                std::string key;
+                fields >> key;
+                if (key == "status")
+                    fields >> status;
+                else if (key == "image")
+                    fields >> image;
+                else if (key == "error")
+                    std::getline(fields, error);
+                for (int k = 0; k < 5; ++k)
+                    if (key == keys[k])
+                        fields >> values[k];
+            }
+            bool ok = status == "ok";
+            Completed += ok ? 1 : 0;
+            Failed += ok ? 0 : 1;
+            renderMs += values[1];
+            out << f << " " << status << " " << image;
+            for (double value : values)
+                out << " " << value;
+            out << "\n";
+            if (!ok)
+                log << "  " << frameName(f) << ": " << status << error << std::endl;
+        }
+        out << "# frames " << Frames << " ok " << Completed << " failed " << Failed << " workers " << Workers << " wall_s " << WallSeconds
+            << " frames_per_s " << Frames / std::max(WallSeconds, 1e-9) << " render_ms_sum " << renderMs << "\n";
+        log << Completed << "/" << Frames << " frames with " << Workers << " workers in " << WallSeconds << " s ("
+            << Frames / std::max(WallSeconds, 1e-9) << " frames/s, " << renderMs / std::max(Completed, 1) << " ms of GPU per frame)" << std::endl;
+        return Failed == 0 && (bool)out;
+    }
+};
+#endif
@@ -0,0 +1,259 @@
+#ifndef SAMPLE_SETS_H
+#define SAMPLE_SETS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Conjuntos de muestras para el SSAO.
+// Los kernels son anidados: cualquier prefijo (samplesNum < 64, las muestras gruesas del SSAO adaptativo)
+// esta bien distribuido por si solo, asi que se genera un solo kernel del tamanio maximo.
+// La textura de ruido de rotacion es blue noise por void-and-cluster y se guarda en disco porque
+// generarla cuesta O(N^4) para una textura de N x N.
+class SampleSets
+{
+public:
+    enum Distribution { RANDOM = 0, HALTON = 1, POISSON = 2 };
+
+    static std::string Directory()
+    {
+        return "noise_cache";
+    }
+
+    // kernel de n muestras en la semiesfera +z (espacio tangente), con mas densidad cerca del origen
+    static std::vector<glm::vec3> Kernel(int n, Distribution distribution)
+    {
+        std::vector<glm::vec3> samples;
+        if (distribution == RANDOM) {
+            // el kernel original: puntos uniformes en el cubo proyectados a la semiesfera, largo uniforme
+            std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
+            std::default_random_engine generator;
+            for (int i = 0; i < n; ++i) {
+                glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, randomFloats(generator));
+                samples.push_back(glm::normalize(sample) * randomFloats(generator));
+            }
+            return samples;
+        }
+
+        std::vector<glm::vec3> points;    // (u, v, w) en [0,1)^3: direccion (u, v) y distancia (w)
+        if (distribution == HALTON) {
+            // Halton en bases 2, 3, 5: cada prefijo es de baja discrepancia (Hammersley no, depende de n)
+            for (int i = 0; i < n; ++i)
+                points.push_back(glm::vec3(radicalInverse(i + 1, 2), radicalInverse(i + 1, 3), radicalInverse(i + 1, 5)));
+        }
+        else {
+            points = bestCandidate(n);
+        }
+
+        for (const glm::vec3& p : points) {
+            // direccion con distribucion coseno: menos muestras rasantes que se ocluyen con la propia superficie
+            float r = std::sqrt(p.x), phi = 6.28318530718f * p.y;
+            glm::vec3 dir(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(0.0f, 1.0f - p.x)));
+            // caida con la distancia: la distancia depende de la muestra y no del indice, asi todo prefijo
+            // tiene muestras cerca y lejos
+            float scale = 0.1f + 0.9f * p.z * p.z;
+            samples.push_back(dir * scale);
+        }
+        return samples;
+    }
+
+    // ruido de rotacion blanco de size x size (el de siempre con size = 4): vectores en el plano xy
+    static std::vector<glm::vec3> WhiteNoise(int size)
+    {
+        std::uniform_real_distribution<float> randomFloats(0.0, 360.0);
+        std::default_random_engine generator;
+        std::vector<glm::vec3> rotations;
+        for (int i = 0; i < size * size; ++i)
+            rotations.push_back(glm::vec3(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, 0.f));
+        return rotations;
+    }
+
+    // ruido de rotacion blue noise: el angulo de cada texel sale de su rango en la matriz de void-and-cluster
+    static std::vector<glm::vec3> BlueNoiseRotations(int size)
+    {
+        std::vector<float> ranks = BlueNoise(size);
+        std::vector<glm::vec3> rotations(ranks.size());
+        for (size_t i = 0; i < ranks.size(); ++i) {
+            float angle = 6.28318530718f * ranks[i];
+            rotations[i] = glm::vec3(std::cos(angle), std::sin(angle), 0.0f);
+        }
+        return rotations;
+    }
+
+    // matriz de umbrales blue noise de size x size (valores (rango + 0.5) / size^2), desde la cache o generada
+    static std::vector<float> BlueNoise(int size)
+    {
+        size = std::max(size, 2);
+        std::string file = Directory() + "/bluenoise_" + std::to_string(size) + ".bin";
+        std::vector<float> values;
+        if (load(file, size, values))
+            return values;
+        values = voidAndCluster(size);
+        save(file, size, values);
+        return values;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x315A4E42;  // "BNZ1"
+
+    static float radicalInverse(uint32_t i, uint32_t base)
+    {
+        float inv = 1.0f / base, f = inv, result = 0.0f;
+        while (i > 0) {
+            result += f * (i % base);
+            i /= base;
+            f *= inv;
+        }
+        return result;
+    }
+
+    // Poisson-disk progresivo (best candidate de Mitchell): cada punto nuevo es, entre k candidatos, el mas
+    // alejado de los anteriores. La distancia se mide en el disco proyectado (donde la distribucion coseno es
+    // uniforme) mas la coordenada de distancia al origen.
+    static std::vector<glm::vec3> bestCandidate(int n)
+    {
+        std::mt19937 generator(1234u);
+        std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
+        auto disk = [](const glm::vec3& p) {
+            float r = std::sqrt(p.x), phi = 6.28318530718f * p.y;
+            return glm::vec3(r * std::cos(phi), r * std::sin(phi), p.z);
+        };
+        std::vector<glm::vec3> points, projected;
+        for (int i = 0; i < n; ++i) {
+            int candidates = 8 + 4 * i;
+            glm::vec3 best(0.0f);
+            float bestDistance = -1.0f;
+            for (int c = 0; c < candidates; ++c) {
+                glm::vec3 p(randomFloats(generator), randomFloats(generator), randomFloats(generator));
+                glm::vec3 q = disk(p);
+                float nearest = 1e9f;
+                for (const glm::vec3& o : projected) {
+                    glm::vec3 d = q - o;
+                    nearest = std::min(nearest, glm::dot(d, d));
+                }
+                if (nearest > bestDistance) {
+                    bestDistance = nearest;
+                    best = p;
+                }
+            }
+            points.push_back(best);
+            projected.push_back(disk(best));
+        }
+        return points;
+    }
+
+    // void-and-cluster (Ulichney 1993) sobre un toro de size x size con un filtro gaussiano de sigma 1.5
+    static std::vector<float> voidAndCluster(int size)
+    {
+        int count = size * size;
+        // el filtro depende solo de la distancia toroidal, asi que se precalcula por desplazamiento
+        std::vector<float> gauss(count);
+        for (int y = 0; y < size; ++y)
+            for (int x = 0; x < size; ++x) {
+                int dx = std::min(x, size - x), dy = std::min(y, size - y);
+                gauss[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * 1.5f * 1.5f));
+            }
+
+        std::vector<char> pattern(count, 0);
+        std::vector<float> energy(count, 0.0f);
+        auto splat = [&](int p, float sign) {
+            int px = p % size, py = p / size;
+            for (int y = 0; y < size; ++y) {
+                int gy = ((y - py + size) % size) * size;
+                for (int x = 0; x < size; ++x)
+                    energy[y * size + x] += sign * gauss[gy + (x - px + size) % size];
+            }
+        };
+        // cluster mas denso entre los 1 / hueco mas grande entre los 0
+        auto tightestCluster = [&]() {
+            int best = -1;
+            for (int p = 0; p < count; ++p)
+                if (pattern[p] && (best < 0 || energy[p] > energy[best]))
+                    best = p;
+            return best;
+        };
+        auto largestVoid = [&]() {
+            int best = -1;
+            for (int p = 0; p < count; ++p)
+                if (!pattern[p] && (best < 0 || energy[p] < energy[best]))
+                    best = p;
+            return best;
+        };
+
+        // patron inicial: ~10% de puntos al azar, relajado moviendo el cluster mas denso al hueco mas grande
+        std::mt19937 generator(5678u);
+        int ones = std::max(1, count / 10);
+        for (int placed = 0; placed < ones;) {
+            int p = (int)(generator() % count);
+            if (!pattern[p]) {
+                pattern[p] = 1;
+                splat(p, 1.0f);
+                ++placed;
+            }
+        }
+        for (int iteration = 0; iteration < count; ++iteration) {
+            int cluster = tightestCluster();
+            pattern[cluster] = 0;
+            splat(cluster, -1.0f);
+            int hole = largestVoid();
+            pattern[hole] = 1;
+            splat(hole, 1.0f);
+            if (hole == cluster)
+                break;
+        }
+        std::vector<char> prototype = pattern;
+        std::vector<float> prototypeEnergy = energy;
+
+        std::vector<int> rank(count, 0);
+        // fase 1: sacar los clusters del prototipo, de rango ones-1 a 0
+        for (int r = ones - 1; r >= 0; --r) {
+            int cluster = tightestCluster();
+            pattern[cluster] = 0;
+            splat(cluster, -1.0f);
+            rank[cluster] = r;
+        }
+        // fases 2 y 3: desde el prototipo llenar los huecos hasta completar (con energia 1 - la de los 0 el
+        // cluster mas denso de ceros es el mismo pixel que el hueco mas grande de unos)
+        pattern = prototype;
+        energy = prototypeEnergy;
+        for (int r = ones; r < count; ++r) {
+            int hole = largestVoid();
+            pattern[hole] = 1;
+            splat(hole, 1.0f);
+            rank[hole] = r;
+        }
+
+        std::vector<float> values(count);
+        for (int p = 0; p < count; ++p)
+            values[p] = (rank[p] + 0.5f) / count;
+        return values;
+    }
+
+    static bool load(const std::string& file, int size, std::vector<float>& values)
+    {
+        std::ifstream in(file, std::ios::binary);
+        uint32_t header[2];     // magic, lado
+        if (!in || !in.read((char*)header, sizeof(header)) || header[0] != MAGIC || header[1] != (uint32_t)size)
+            return false;
+        values.resize((size_t)size * size);
+        return (bool)in.read((char*)values.data(), values.size() * sizeof(float));
+    }
+
+    static void save(const std::string& file, int size, const std::vector<float>& values)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(Directory(), ec);
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        uint32_t header[2] = { MAGIC, (uint32_t)size };
+        out.write((const char*)header, sizeof(header));
+        out.write((const char*)values.data(), values.size() * sizeof(float));
+    }
+};
+#endif
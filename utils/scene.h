@@ -0,0 +1,347 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "utils/model.h"
+#include "utils/frustum.h"
+#include "utils/thread_pool.h"
+
+#include <cstdint>
+#include <vector>
+
+// Escena de instancias ubicadas de un conjunto de modelos.
+// Las transformaciones se guardan como structure-of-arrays (posicion, giro en Y, escala) y por frame:
+//   1. UpdateTransforms: arma matriz de modelo, matriz normal y esfera envolvente en mundo (en paralelo)
+//   2. Cull: prueba las esferas contra el frustum con SSE, repartido en el ThreadPool; con MeshletCulling
+//      ademas prueba los meshlets de cada instancia visible (frustum y cono de normales, en espacio del modelo)
+//   3. Pack: compacta las instancias visibles agrupadas por modelo en una DrawList
+//   4. Upload: sube la DrawList al VBO de instancias
+//   5. Draw: un glDrawElementsInstanced por malla de cada modelo con instancias visibles, o con MeshletCulling
+//      un glMultiDrawElements por malla de cada instancia con los rangos de meshlets que sobrevivieron
+// 1-3 son solo CPU y corren en el hilo de update; 4-5 en el de render, con una DrawList que ya no depende
+// de la escena (mientras tanto la escena arma la del frame siguiente)
+class Scene
+{
+public:
+    // modelos registrados (la escena no es duena de los Model)
+    std::vector<Model*> Models;
+    std::vector<float> ModelScale;      // escala base de cada modelo (normaliza el tamanio de los .obj)
+
+    // instancias (SoA)
+    std::vector<int> ModelIndex;
+    std::vector<float> PosX, PosY, PosZ;
+    std::vector<float> Yaw;             // radianes, alrededor de Y
+    std::vector<float> Scale;
+
+    // descartar meshlets fuera del frustum o de espaldas a la camara (ver Meshlets). Cada instancia pasa a
+    // ser un draw propio, asi que con mas de MeshletMaxInstances visibles se vuelve al dibujo instanciado
+    bool MeshletCulling = true;
+    size_t MeshletMaxInstances = 256;
+
+    // lo que el render necesita de un frame: instancias visibles compactadas (rango de cada modelo en
+    // BatchStart, instancia de la escena y esfera de cada posicion) y los rangos de meshlets de cada una
+    struct DrawList
+    {
+        std::vector<InstanceData> Packed;
+        std::vector<size_t> BatchStart, PackedSource;
+        std::vector<glm::vec4> Spheres;
+        size_t InstanceCount = 0;
+
+        // con MeshletsActive, los rangos de la malla k de la posicion s son [MeshStart[b + k], MeshStart[b + k + 1])
+        // con b = SlotStart[s]; Counts/Firsts en formato GL
+        bool MeshletsActive = false;
+        std::vector<size_t> SlotStart;
+        std::vector<unsigned int> MeshStart;
+        std::vector<GLsizei> Counts;
+        std::vector<const void*> Firsts;
+
+        size_t MemoryBytes() const
+        {
+            return Packed.capacity() * sizeof(InstanceData) + Spheres.capacity() * sizeof(glm::vec4)
+                + (BatchStart.capacity() + PackedSource.capacity() + SlotStart.capacity()) * sizeof(size_t)
+                + MeshStart.capacity() * sizeof(unsigned int) + Counts.capacity() * sizeof(GLsizei) + Firsts.capacity() * sizeof(const void*);
+        }
+    };
+
+    // estadisticas del ultimo frame
+    size_t VisibleCount = 0;
+    size_t MeshletsTested = 0, MeshletsVisible = 0, MeshletDraws = 0;
+
+    Scene() {}
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // registra un modelo y devuelve su indice
+    int AddModel(Model* model, float baseScale = 1.0f)
+    {
+        Models.push_back(model);
+        ModelScale.push_back(baseScale);
+        return (int)Models.size() - 1;
+    }
+
+    // agrega una instancia y devuelve su indice
+    size_t AddInstance(int model, const glm::vec3& position, float yaw = 0.0f, float scale = 1.0f)
+    {
+        ModelIndex.push_back(model);
+        PosX.push_back(position.x);
+        PosY.push_back(position.y);
+        PosZ.push_back(position.z);
+        Yaw.push_back(yaw);
+        Scale.push_back(scale);
+        return ModelIndex.size() - 1;
+    }
+
+    void ClearInstances()
+    {
+        ModelIndex.clear();
+        PosX.clear(); PosY.clear(); PosZ.clear();
+        Yaw.clear();
+        Scale.clear();
+    }
+
+    size_t InstanceCount() const
+    {
+        return ModelIndex.size();
+    }
+
+    // arma matrices y esferas en mundo de todas las instancias
+    void UpdateTransforms()
+    {
+        size_t n = InstanceCount();
+        instances.resize(n);
+        sphereX.resize(n); sphereY.resize(n); sphereZ.resize(n); sphereR.resize(n);
+        visible.resize(n);
+
+        ThreadPool::Get().ParallelFor(n, 1024, [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const Model* model = Models[ModelIndex[i]];
+                float s = Scale[i] * ModelScale[ModelIndex[i]];
+                glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(PosX[i], PosY[i], PosZ[i]));
+                m = glm::rotate(m, Yaw[i], glm::vec3(0.0f, 1.0f, 0.0f));
+                m = glm::scale(m, glm::vec3(s));
+                // matriz normal precalculada (antes se invertia por vertice en gbuffer.vert)
+                glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(m)));
+                instances[i].Model = m;
+                for (int c = 0; c < 3; ++c)
+                    instances[i].NormalMatrix[c] = glm::vec4(normalMatrix[c], 0.0f);
+
+                glm::vec4 center = m * glm::vec4(model->BoundsCenter(), 1.0f);
+                sphereX[i] = center.x;
+                sphereY[i] = center.y;
+                sphereZ[i] = center.z;
+                sphereR[i] = model->BoundsRadius() * s;
+            }
+        });
+    }
+
+    // frustum culling de todas las instancias contra projection * view (y de sus meshlets, ver MeshletCulling)
+    void Cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+    {
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+        ThreadPool::Get().ParallelFor(InstanceCount(), 4096, [&](size_t begin, size_t end) {
+            frustum.CullSpheres(sphereX.data(), sphereY.data(), sphereZ.data(), sphereR.data(), visible.data(), begin, end);
+        });
+        MeshletsTested = MeshletsVisible = MeshletDraws = 0;
+        meshletsActive = false;
+        if (MeshletCulling)
+            cullMeshlets(frustum, cameraPosition);
+    }
+
+    // todas las instancias visibles y sin meshlets (vistas en lote: cada vista ve otra parte de la escena)
+    void CullAll()
+    {
+        std::fill(visible.begin(), visible.end(), (uint8_t)1);
+        MeshletsTested = MeshletsVisible = MeshletDraws = 0;
+        meshletsActive = false;
+    }
+
+    // compacta las instancias visibles en 'list', agrupadas por modelo (los vectores de 'list' se reutilizan)
+    void Pack(DrawList& list)
+    {
+        // counting sort por modelo
+        list.BatchStart.assign(Models.size() + 1, 0);
+        for (size_t i = 0; i < InstanceCount(); ++i)
+            if (visible[i])
+                ++list.BatchStart[ModelIndex[i] + 1];
+        for (size_t m = 0; m < Models.size(); ++m)
+            list.BatchStart[m + 1] += list.BatchStart[m];
+        VisibleCount = list.BatchStart[Models.size()];
+        list.InstanceCount = InstanceCount();
+
+        list.Packed.resize(VisibleCount);
+        list.PackedSource.resize(VisibleCount);
+        list.Spheres.resize(VisibleCount);
+        cursor.assign(list.BatchStart.begin(), list.BatchStart.end() - 1);
+        for (size_t i = 0; i < InstanceCount(); ++i)
+            if (visible[i]) {
+                size_t slot = cursor[ModelIndex[i]]++;
+                list.PackedSource[slot] = i;
+                list.Packed[slot] = instances[i];
+                list.Spheres[slot] = glm::vec4(sphereX[i], sphereY[i], sphereZ[i], sphereR[i]);
+            }
+
+        // rangos de meshlets de cada posicion, con los indices corridos al arreglo comun
+        list.MeshletsActive = meshletsActive;
+        list.SlotStart.clear();
+        list.MeshStart.clear();
+        list.Counts.clear();
+        list.Firsts.clear();
+        if (!meshletsActive)
+            return;
+        for (size_t slot = 0; slot < VisibleCount; ++slot) {
+            const InstanceMeshlets& d = meshletDraws[list.PackedSource[slot]];
+            list.SlotStart.push_back(list.MeshStart.size());
+            for (unsigned int start : d.MeshStart)
+                list.MeshStart.push_back((unsigned int)list.Counts.size() + start);
+            list.Counts.insert(list.Counts.end(), d.Counts.begin(), d.Counts.end());
+            list.Firsts.insert(list.Firsts.end(), d.Firsts.begin(), d.Firsts.end());
+        }
+    }
+
+    // sube las instancias de 'list' al VBO de instancias (hilo de render)
+    void Upload(const DrawList& list)
+    {
+        if (instanceVBO == 0)
+            glGenBuffers(1, &instanceVBO);
+        // orphaning: el driver nos da memoria nueva en vez de esperar al frame anterior
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, list.Packed.size() * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+        if (!list.Packed.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, 0, list.Packed.size() * sizeof(InstanceData), list.Packed.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        uploadedSlots = list.Packed.size();
+    }
+
+    // VBO de instancias visibles (InstanceData de la ultima DrawList subida)
+    unsigned int InstanceBuffer() const
+    {
+        return instanceVBO;
+    }
+
+    // memoria de las instancias, del lado de update (los modelos y las DrawList se cuentan aparte)
+    MemoryUsage Memory() const
+    {
+        size_t cpu = Models.capacity() * sizeof(Model*) + ModelIndex.capacity() * sizeof(int) + ModelScale.capacity() * sizeof(float)
+            + (PosX.capacity() + PosY.capacity() + PosZ.capacity() + Yaw.capacity() + Scale.capacity()) * sizeof(float)
+            + instances.capacity() * sizeof(InstanceData)
+            + (sphereX.capacity() + sphereY.capacity() + sphereZ.capacity() + sphereR.capacity()) * sizeof(float) + visible.capacity()
+            + (cursor.capacity() + visibleList.capacity()) * sizeof(size_t);
+        for (const InstanceMeshlets& d : meshletDraws)
+            cpu += d.Ranges.capacity() * sizeof(IndexRange) + d.Counts.capacity() * sizeof(GLsizei)
+                + d.Firsts.capacity() * sizeof(const void*) + d.MeshStart.capacity() * sizeof(unsigned int);
+        return MemoryUsage(cpu, 0);
+    }
+
+    // VBO de instancias (lado de render)
+    MemoryUsage BufferMemory() const
+    {
+        return MemoryUsage(0, uploadedSlots * sizeof(InstanceData));
+    }
+
+    // dibuja los lotes visibles de 'list', que tiene que ser la ultima subida (depthOnly: solo posiciones, para el
+    // depth pre-pass). instanceBuffer reemplaza al VBO de instancias por otro con los mismos slots (ver OcclusionCulling).
+    // views > 1 dibuja cada instancia una vez por vista (utils/multi_view.h); no se combina con meshlets
+    void Draw(const DrawList& list, Shader& shader, bool depthOnly = false, unsigned int instanceBuffer = 0, unsigned int views = 1)
+    {
+        unsigned int instances = instanceBuffer != 0 ? instanceBuffer : instanceVBO;
+        if (list.BatchStart.size() != Models.size() + 1)
+            return;
+        if (list.MeshletsActive && views == 1) {
+            for (size_t m = 0; m < Models.size(); ++m)
+                for (size_t slot = list.BatchStart[m]; slot < list.BatchStart[m + 1]; ++slot) {
+                    const unsigned int* start = list.MeshStart.data() + list.SlotStart[slot];
+                    for (size_t k = 0; k < Models[m]->meshes.size(); ++k)
+                        Models[m]->meshes[k].DrawRanges(shader, instances, slot * sizeof(InstanceData), list.Counts.data() + start[k],
+                            list.Firsts.data() + start[k], (GLsizei)(start[k + 1] - start[k]), depthOnly);
+                }
+            return;
+        }
+        for (size_t m = 0; m < Models.size(); ++m) {
+            unsigned int count = (unsigned int)(list.BatchStart[m + 1] - list.BatchStart[m]);
+            if (count > 0)
+                Models[m]->DrawInstanced(shader, instances, list.BatchStart[m] * sizeof(InstanceData), count, depthOnly, views);
+        }
+    }
+
+private:
+    // datos derivados por instancia
+    std::vector<InstanceData> instances;
+    std::vector<float> sphereX, sphereY, sphereZ, sphereR;
+    std::vector<uint8_t> visible;
+
+    // cursor del counting sort de Pack; VBO de instancias y cuantas tiene (lado de render)
+    std::vector<size_t> cursor;
+    unsigned int instanceVBO = 0;
+    size_t uploadedSlots = 0;
+
+    // rangos de indices que sobrevivieron al culling de meshlets, por instancia (los vectores se reutilizan
+    // entre frames). Los de la malla k son [MeshStart[k], MeshStart[k + 1]); Counts/Firsts en formato GL
+    struct InstanceMeshlets
+    {
+        std::vector<IndexRange> Ranges;
+        std::vector<GLsizei> Counts;
+        std::vector<const void*> Firsts;
+        std::vector<unsigned int> MeshStart;
+        size_t Tested = 0, Visible = 0;
+    };
+    std::vector<InstanceMeshlets> meshletDraws;
+    std::vector<size_t> visibleList;
+    bool meshletsActive = false;
+
+    // los meshlets se prueban en el espacio de cada instancia: se llevan ahi los planos (transpuesta de la
+    // matriz de modelo, renormalizados) y la camara (inversa), en vez de transformar cada esfera
+    void cullMeshlets(const Frustum& frustum, const glm::vec3& cameraPosition)
+    {
+        visibleList.clear();
+        for (size_t i = 0; i < InstanceCount(); ++i)
+            if (visible[i])
+                visibleList.push_back(i);
+        if (visibleList.size() > MeshletMaxInstances)
+            return;
+        meshletsActive = true;
+        if (meshletDraws.size() < InstanceCount())
+            meshletDraws.resize(InstanceCount());
+
+        ThreadPool::Get().ParallelFor(visibleList.size(), 8, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v) {
+                size_t i = visibleList[v];
+                InstanceMeshlets& d = meshletDraws[i];
+                d.Ranges.clear();
+                d.MeshStart.clear();
+                d.Tested = d.Visible = 0;
+
+                const glm::mat4& model = instances[i].Model;
+                glm::mat4 toPlanes = glm::transpose(model);
+                glm::vec4 planes[6];
+                for (int p = 0; p < 6; ++p) {
+                    planes[p] = toPlanes * frustum.Planes[p];
+                    planes[p] /= glm::length(glm::vec3(planes[p]));
+                }
+                glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+                for (const Mesh& mesh : Models[ModelIndex[i]]->meshes) {
+                    d.MeshStart.push_back((unsigned int)d.Ranges.size());
+                    d.Visible += mesh.meshlets.Cull(planes, camera, d.Ranges);
+                    d.Tested += mesh.meshlets.Size();
+                }
+                d.MeshStart.push_back((unsigned int)d.Ranges.size());
+
+                d.Counts.resize(d.Ranges.size());
+                d.Firsts.resize(d.Ranges.size());
+                for (size_t r = 0; r < d.Ranges.size(); ++r) {
+                    d.Counts[r] = (GLsizei)d.Ranges[r].Count;
+                    d.Firsts[r] = (const void*)(d.Ranges[r].First * sizeof(unsigned int));
+                }
+            }
+        });
+        for (size_t i : visibleList) {
+            MeshletsTested += meshletDraws[i].Tested;
+            MeshletsVisible += meshletDraws[i].Visible;
+            MeshletDraws += meshletDraws[i].Ranges.size();
+        }
+    }
+};
+#endif
@@ -0,0 +1,214 @@
+#ifndef SESSION_RECORDER_H
+#define SESSION_RECORDER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Graba y reproduce una sesion: por frame el estado de la camara, el giro del modelo y la escala de la
+// resolucion dinamica, mas los cambios de los parametros enlazados con Bind (flags de la interfaz, modelo
+// actual, SSAO...). El replay pisa todo eso desde el archivo y avanza con un paso de tiempo fijo, asi dos
+// corridas del mismo trace dibujan exactamente los mismos frames.
+//
+// Formato (binario, little endian): "SES1", cantidad de parametros, y por parametro tipo + nombre; despues
+// un registro por frame con los parametros que cambiaron (id, valor de 32 bits) y el estado de ese frame.
+// Los parametros se buscan por nombre al reproducir: un trace viejo sigue sirviendo si se agregan otros.
+class SessionRecorder
+{
+public:
+    // estado que se graba entero en cada frame
+    struct State
+    {
+        float DeltaTime = 0.0f;
+        glm::vec3 Position = glm::vec3(0.0f);
+        float Yaw = 0.0f, Pitch = 0.0f, Zoom = 0.0f;
+        float ModelAngle = 0.0f;
+        float RenderScale = 1.0f, SampleScale = 1.0f;
+    };
+
+    float FixedStep = 1.0f / 60.0f;     // deltaTime durante el replay
+    size_t FrameIndex = 0;              // frame grabado / reproducido
+
+    SessionRecorder() {}
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    void Bind(const std::string& name, int* value)
+    {
+        params.push_back({ name, INT, value, 0 });
+    }
+
+    void Bind(const std::string& name, float* value)
+    {
+        params.push_back({ name, FLOAT, value, 0 });
+    }
+
+    void Bind(const std::string& name, bool* value)
+    {
+        params.push_back({ name, BOOL, value, 0 });
+    }
+
+    bool Recording() const
+    {
+        return mode == RECORDING;
+    }
+
+    bool Replaying() const
+    {
+        return mode == REPLAYING;
+    }
+
+    bool StartRecording(const std::string& path)
+    {
+        Stop();
+        file.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file)
+            return false;
+        write<uint32_t>(MAGIC);
+        write<uint32_t>((uint32_t)params.size());
+        for (const Param& param : params) {
+            write<uint8_t>((uint8_t)param.Type);
+            write<uint8_t>((uint8_t)param.Name.size());
+            file.write(param.Name.data(), param.Name.size());
+        }
+        mode = RECORDING;
+        FrameIndex = 0;
+        return (bool)file;
+    }
+
+    bool StartReplay(const std::string& path)
+    {
+        Stop();
+        file.open(path, std::ios::binary | std::ios::in);
+        uint32_t magic = 0, count = 0;
+        if (!file || !read(magic) || magic != MAGIC || !read(count)) {
+            file.close();
+            return false;
+        }
+        // id del archivo -> parametro enlazado con el mismo nombre y tipo (o ninguno)
+        mapping.assign(count, -1);
+        for (uint32_t i = 0; i < count; ++i) {
+            uint8_t type = 0, length = 0;
+            std::string name;
+            if (!read(type) || !read(length)) {
+                file.close();
+                return false;
+            }
+            name.resize(length);
+            file.read(&name[0], length);
+            for (size_t p = 0; p < params.size(); ++p)
+                if (params[p].Name == name && params[p].Type == type)
+                    mapping[i] = (int)p;
+        }
+        mode = REPLAYING;
+        FrameIndex = 0;
+        return (bool)file;
+    }
+
+    void Stop()
+    {
+        if (file.is_open())
+            file.close();
+        mode = IDLE;
+    }
+
+    // una vez por frame, despues del input y antes de renderizar.
+    // Grabando escribe 'state' y los parametros que cambiaron; reproduciendo los pisa con los del archivo.
+    // Devuelve false cuando el replay llega al final (y lo detiene).
+    bool Frame(State& state)
+    {
+        if (mode == RECORDING) {
+            std::vector<std::pair<uint16_t, uint32_t>> changes;
+            for (size_t p = 0; p < params.size(); ++p) {
+                uint32_t value = get(params[p]);
+                // el primer frame lleva todos: es el estado inicial del replay
+                if (FrameIndex == 0 || value != params[p].Last)
+                    changes.push_back({ (uint16_t)p, value });
+                params[p].Last = value;
+            }
+            write<uint16_t>((uint16_t)changes.size());
+            for (const auto& change : changes) {
+                write<uint16_t>(change.first);
+                write<uint32_t>(change.second);
+            }
+            write<State>(state);
+            ++FrameIndex;
+            return true;
+        }
+        if (mode == REPLAYING) {
+            uint16_t count = 0;
+            bool ok = read(count);
+            for (uint16_t i = 0; ok && i < count; ++i) {
+                uint16_t id = 0;
+                uint32_t value = 0;
+                ok = read(id) && read(value);
+                if (ok && id < mapping.size() && mapping[id] >= 0)
+                    set(params[mapping[id]], value);
+            }
+            State recorded;
+            if (!ok || !read(recorded)) {
+                Stop();
+                return false;
+            }
+            state = recorded;
+            state.DeltaTime = FixedStep;
+            ++FrameIndex;
+        }
+        return true;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x31534553;  // "SES1"
+    enum Mode { IDLE, RECORDING, REPLAYING };
+    enum Type { INT = 0, FLOAT = 1, BOOL = 2 };
+
+    struct Param
+    {
+        std::string Name;
+        int Type;
+        void* Value;
+        uint32_t Last;
+    };
+
+    std::vector<Param> params;
+    std::vector<int> mapping;
+    std::fstream file;
+    Mode mode = IDLE;
+
+    // valor de 32 bits de un parametro (los float se guardan con sus bits, para comparar exacto)
+    static uint32_t get(const Param& param)
+    {
+        uint32_t bits = 0;
+        if (param.Type == BOOL)
+            bits = *(bool*)param.Value ? 1u : 0u;
+        else
+            std::memcpy(&bits, param.Value, 4);
+        return bits;
+    }
+
+    static void set(Param& param, uint32_t bits)
+    {
+        if (param.Type == BOOL)
+            *(bool*)param.Value = bits != 0;
+        else
+            std::memcpy(param.Value, &bits, 4);
+        param.Last = bits;
+    }
+
+    template <typename T>
+    void write(T value)
+    {
+        file.write((const char*)&value, sizeof(T));
+    }
+
+    template <typename T>
+    bool read(T& value)
+    {
+        return (bool)file.read((char*)&value, sizeof(T));
+    }
+};
+#endif
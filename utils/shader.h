@@ -4,103 +4,50 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "utils/gl_state.h"
+#include "utils/program_cache.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 class Shader
 {
 public:
-    unsigned int ID;
+    unsigned int ID = 0;
+    Shader() {}
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
-        {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        load(vertexPath, fragmentPath, geometryPath, "");
+    }
+    // permutation: the same sources compiled with a feature set of #defines,
+    // written as "NAME" or "NAME=VALUE" separated by spaces (e.g. "DEBUG_VIEW=2 USE_SSAO")
+    // ------------------------------------------------------------------------
+    static Shader Permutation(const char* vertexPath, const char* fragmentPath, const std::string& defines, const char* geometryPath = nullptr)
+    {
+        Shader shader;
+        shader.load(vertexPath, fragmentPath, geometryPath, defines);
+        return shader;
+    }
+    // transform feedback: the listed vertex shader outputs are captured, interleaved, into the buffer bound
+    // to GL_TRANSFORM_FEEDBACK_BUFFER index 0 (they have to be set before linking)
+    // ------------------------------------------------------------------------
+    static Shader TransformFeedback(const char* vertexPath, const char* fragmentPath, const std::vector<const char*>& varyings)
+    {
+        Shader shader;
+        shader.load(vertexPath, fragmentPath, nullptr, "", varyings);
+        return shader;
     }
+
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::Get().UseProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
@@ -162,9 +109,144 @@ public:
     }
 
 private:
+    void load(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::string& defines,
+        const std::vector<const char*>& varyings = std::vector<const char*>())
+    {
+        // 1. retrieve the vertex/fragment source code from filePath (resolving #include "file")
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::string geometryCode;
+        try 
+        {
+            vertexCode = readSource(vertexPath);
+            fragmentCode = readSource(fragmentPath);
+            // if geometry shader path is present, also load a geometry shader
+            if(geometryPath != nullptr)
+                geometryCode = readSource(geometryPath);
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+        }
+        // the permutation's #defines go right after #version
+        std::string header = defineBlock(defines);
+        vertexCode = injectDefines(vertexCode, header);
+        fragmentCode = injectDefines(fragmentCode, header);
+        if(geometryPath != nullptr)
+            geometryCode = injectDefines(geometryCode, header);
+
+        // 2. try the program binary cache: same sources + same driver -> no compilation at all
+        std::string source = vertexCode + '\0' + fragmentCode + '\0' + geometryCode;
+        for(const char* varying : varyings)
+            source += std::string("\0", 1) + varying;
+        std::string cacheKey = ProgramCache::Key(source);
+        ID = ProgramCache::Load(cacheKey);
+        if(ID != 0)
+            return;
+
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        // 3. compile shaders
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry;
+        if(geometryPath != nullptr)
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+        // shader Program
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        if(geometryPath != nullptr)
+            glAttachShader(ID, geometry);
+        if(!varyings.empty())
+            glTransformFeedbackVaryings(ID, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        ProgramCache::PrepareLink(ID);
+        glLinkProgram(ID);
+        if(checkCompileErrors(ID, "PROGRAM"))
+            ProgramCache::Store(cacheKey, ID);
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(geometryPath != nullptr)
+            glDeleteShader(geometry);
+    }
+    // reads a shader file, replacing #include "file" lines (relative to the including file) with their contents
+    // ------------------------------------------------------------------------
+    static std::string readSource(const std::string& path, int depth = 0)
+    {
+        std::ifstream file;
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        file.open(path);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        file.close();
+        if(depth > 8)
+            return stream.str();
+
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        std::string code, line;
+        while(std::getline(stream, line))
+        {
+            size_t pos = line.find_first_not_of(" \t");
+            if(pos != std::string::npos && line.compare(pos, 8, "#include") == 0)
+            {
+                size_t open = line.find('"', pos), close = line.find('"', open + 1);
+                if(open != std::string::npos && close != std::string::npos)
+                {
+                    code += readSource(directory + line.substr(open + 1, close - open - 1), depth + 1);
+                    continue;
+                }
+            }
+            code += line + '\n';
+        }
+        return code;
+    }
+    // "A B=2" -> "#define A\n#define B 2\n"
+    // ------------------------------------------------------------------------
+    static std::string defineBlock(const std::string& defines)
+    {
+        std::stringstream stream(defines);
+        std::string header, token;
+        while(stream >> token)
+        {
+            size_t eq = token.find('=');
+            header += "#define " + (eq == std::string::npos ? token : token.substr(0, eq) + " " + token.substr(eq + 1)) + "\n";
+        }
+        return header;
+    }
+    // ------------------------------------------------------------------------
+    static std::string injectDefines(const std::string& code, const std::string& header)
+    {
+        if(header.empty())
+            return code;
+        size_t version = code.find("#version");
+        if(version == std::string::npos)
+            return header + code;
+        size_t pos = code.find('\n', version);
+        if(pos == std::string::npos)
+            return code + "\n" + header;
+        return code.substr(0, pos + 1) + header + code.substr(pos + 1);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -186,6 +268,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
     }
 };
 #endif
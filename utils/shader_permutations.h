@@ -0,0 +1,104 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include "utils/shader.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Arma el string de #defines de una permutacion: ShaderDefines().Set("DEBUG_VIEW", 2).Flag("USE_SSAO", SSAO)
+// El orden de las llamadas tiene que ser siempre el mismo para que la clave de una permutacion sea unica.
+class ShaderDefines
+{
+public:
+    ShaderDefines() {}
+    ShaderDefines(const std::string& defines) : str(defines) {}
+
+    ShaderDefines& Flag(const char* name, bool enabled = true)
+    {
+        if (enabled)
+            append(name);
+        return *this;
+    }
+
+    ShaderDefines& Set(const char* name, int value)
+    {
+        append(std::string(name) + "=" + std::to_string(value));
+        return *this;
+    }
+
+    const std::string& Str() const
+    {
+        return str;
+    }
+
+private:
+    std::string str;
+
+    void append(const std::string& token)
+    {
+        if (!str.empty())
+            str += ' ';
+        str += token;
+    }
+};
+
+// Un pase = un par de fuentes; cada combinacion de features (#defines) se compila la primera vez que
+// se pide y queda guardada. Con la cache de program binaries (utils/program_cache.h) las siguientes
+// ejecuciones ni siquiera compilan.
+class ShaderPermutations
+{
+public:
+    // setup se llama una sola vez por permutacion recien creada, con el programa en uso
+    // (unidades de los samplers, uniforms constantes). geometryPath es opcional ("" = sin geometry shader)
+    ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath, std::function<void(Shader&)> setup = nullptr,
+        const std::string& geometryPath = "")
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath), setup(setup) {}
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    Shader& Get(const ShaderDefines& defines)
+    {
+        auto it = programs.find(defines.Str());
+        if (it == programs.end()) {
+            Shader shader = Shader::Permutation(vertexPath.c_str(), fragmentPath.c_str(), defines.Str(),
+                geometryPath.empty() ? nullptr : geometryPath.c_str());
+            shader.use();
+            if (setup)
+                setup(shader);
+            it = programs.emplace(defines.Str(), shader).first;
+        }
+        return it->second;
+    }
+
+    // compila por adelantado las permutaciones que se van a usar, para no pagarlo al cambiar de modo
+    void Precompile(const std::vector<ShaderDefines>& list)
+    {
+        for (const ShaderDefines& defines : list)
+            Get(defines);
+    }
+
+    // vuelve a correr setup en todas las permutaciones (cuando cambian los datos que sube, p.ej. el kernel)
+    void Refresh()
+    {
+        if (!setup)
+            return;
+        for (auto& program : programs) {
+            program.second.use();
+            setup(program.second);
+        }
+    }
+
+    size_t Count() const
+    {
+        return programs.size();
+    }
+
+private:
+    std::string vertexPath, fragmentPath, geometryPath;
+    std::function<void(Shader&)> setup;
+    std::map<std::string, Shader> programs;
+};
+#endif
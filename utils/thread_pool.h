@@ -0,0 +1,133 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de hilos persistente para repartir trabajo de CPU (culling, bakes, parsing...).
+// ParallelFor divide [0, count) en bloques de 'grain' elementos; el hilo que llama tambien trabaja.
+// No es reentrante: un ParallelFor lanzado desde dentro de un trabajo se ejecuta en serie.
+class ThreadPool
+{
+public:
+    // pool compartido, con un hilo por nucleo
+    static ThreadPool& Get()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    explicit ThreadPool(unsigned int threads = 0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        // el hilo que llama cuenta como uno mas
+        for (unsigned int i = 1; i < threads; ++i)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // cantidad de hilos que participan de un ParallelFor
+    unsigned int Size() const
+    {
+        return (unsigned int)workers.size() + 1;
+    }
+
+    // fn(begin, end) se llama sobre rangos disjuntos que cubren [0, count)
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+    {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        if (workers.empty() || count <= grain || insideJob) {
+            fn(0, count);
+            return;
+        }
+
+        std::lock_guard<std::mutex> dispatch(dispatchMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobCount = count;
+            jobGrain = grain;
+            next = 0;
+            busy = (int)workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+
+        runChunks();
+
+        // esperar a que todos los workers suelten el trabajo antes de que 'fn' salga de scope
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex, dispatchMutex;
+    std::condition_variable wake, done;
+    bool quit = false;
+    unsigned long long generation = 0;
+
+    // trabajo en curso
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0, jobGrain = 1;
+    std::atomic<size_t> next{ 0 };
+    int busy = 0;
+
+    static inline thread_local bool insideJob = false;
+
+    void runChunks()
+    {
+        bool wasInside = insideJob;
+        insideJob = true;
+        for (;;) {
+            size_t begin = next.fetch_add(jobGrain);
+            if (begin >= jobCount)
+                break;
+            (*job)(begin, std::min(begin + jobGrain, jobCount));
+        }
+        insideJob = wasInside;
+    }
+
+    void workerLoop()
+    {
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+            runChunks();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --busy;
+            }
+            done.notify_one();
+        }
+    }
+};
+#endif
@@ -0,0 +1,58 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Triple buffer sin locks entre un productor y un consumidor (p.ej. el hilo de update y el de render).
+// El productor llena Write() y lo publica; el consumidor toma con Acquire() lo ultimo publicado y lo lee en
+// Read() todo el tiempo que quiera. Cada uno tiene su slot propio y el tercero se intercambia con un
+// exchange atomico, asi ninguno espera al otro: si el productor publica dos veces antes de que el consumidor
+// tome, el primero se pisa. Los slots se reutilizan, asi que los vectores de T conservan su capacidad.
+template<class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() {}
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // productor: el slot que se esta llenando (tiene lo que se publico hace dos Publish)
+    T& Write()
+    {
+        return slots[back];
+    }
+
+    void Publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // consumidor: true si habia algo nuevo; despues Read() es lo ultimo publicado
+    bool Acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    T& Read()
+    {
+        return slots[front];
+    }
+
+    // hay algo publicado que el consumidor no tomo (para esperar con una condition variable)
+    bool Pending() const
+    {
+        return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+    }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;     // el slot del medio tiene algo que el consumidor no tomo
+
+    T slots[3];
+    std::atomic<int> middle{ 1 };
+    int back = 0, front = 2;
+};
+#endif
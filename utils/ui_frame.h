@@ -0,0 +1,68 @@
+#ifndef UI_FRAME_H
+#define UI_FRAME_H
+
+#include "imgui.h"
+
+#include <vector>
+
+// Copia de lo que dibuja ImGui en un frame. La interfaz se arma en el hilo de update (ahi llegan los
+// eventos de GLFW) y se dibuja en el de render, cuando ImGui ya puede estar armando el frame siguiente:
+// el ImDrawData de ImGui apunta a listas que se reutilizan, asi que se clonan con CloneOutput.
+// Capture y el destructor van en el hilo de ImGui (sus reservas pasan por el allocator de ImGui).
+class UiFrame
+{
+public:
+    UiFrame() {}
+    UiFrame(const UiFrame&) = delete;
+    UiFrame& operator=(const UiFrame&) = delete;
+
+    ~UiFrame()
+    {
+        clear();
+    }
+
+    void Capture(const ImDrawData* source)
+    {
+        clear();
+        if (source == nullptr || !source->Valid)
+            return;
+        data = *source;     // posicion, tamanio y escala del display
+        for (int i = 0; i < source->CmdListsCount; ++i)
+            lists.push_back(source->CmdLists[i]->CloneOutput());
+        setLists(data.CmdLists);
+        valid = true;
+    }
+
+    // para ImGui_ImplOpenGL3_RenderDrawData; nullptr si no hay nada que dibujar
+    ImDrawData* Data()
+    {
+        return valid ? &data : nullptr;
+    }
+
+private:
+    ImDrawData data;
+    std::vector<ImDrawList*> lists;
+    bool valid = false;
+
+    void clear()
+    {
+        for (ImDrawList* list : lists)
+            IM_DELETE(list);
+        lists.clear();
+        valid = false;
+    }
+
+    // CmdLists es ImDrawList** hasta la 1.89.7 e ImVector<ImDrawList*> desde la 1.89.8
+    void setLists(ImDrawList**& target)
+    {
+        target = lists.data();
+    }
+
+    void setLists(ImVector<ImDrawList*>& target)
+    {
+        target.resize(0);
+        for (ImDrawList* list : lists)
+            target.push_back(list);
+    }
+};
+#endif